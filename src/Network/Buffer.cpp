@@ -9,6 +9,9 @@
  */
 
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
 #include "Buffer.h"
 #include "Util/onceToken.h"
 
@@ -32,4 +35,169 @@ BufferRaw::Ptr BufferRaw::create(size_t size) {
 #endif
 }
 
+BufferChain::Ptr BufferChain::create() {
+    return std::make_shared<BufferChain>();
+}
+
+template <typename FUNC>
+void BufferChain::forEachRange(const Buffer::Ptr &buf, size_t offset, size_t len, FUNC &&func) const {
+    auto total = buf->size();
+    if (offset > total) {
+        throw std::out_of_range("BufferChain offset out of range");
+    }
+    if (len == std::string::npos || offset + len > total) {
+        len = total - offset;
+    }
+    if (!len) {
+        return;
+    }
+    auto chain = buf->getChain();
+    if (!chain) {
+        func(Slice { buf, offset, len });
+        return;
+    }
+    // 展开其他分片链的分片，避免嵌套
+    // Expand the slices of the other chain to avoid nesting
+    for (auto &slice : chain->_slices) {
+        if (offset >= slice.size) {
+            offset -= slice.size;
+            continue;
+        }
+        auto size = std::min(slice.size - offset, len);
+        func(Slice { slice.buffer, slice.offset + offset, size });
+        offset = 0;
+        len -= size;
+        if (!len) {
+            break;
+        }
+    }
+}
+
+void BufferChain::append(const Buffer::Ptr &buf, size_t offset, size_t len) {
+    forEachRange(buf, offset, len, [&](Slice slice) {
+        _size += slice.size;
+        _slices.emplace_back(std::move(slice));
+    });
+    _joined = nullptr;
+}
+
+void BufferChain::append(std::string str) {
+    append(std::make_shared<BufferString>(std::move(str)));
+}
+
+void BufferChain::prepend(const Buffer::Ptr &buf, size_t offset, size_t len) {
+    std::vector<Slice> slices;
+    forEachRange(buf, offset, len, [&](Slice slice) { slices.emplace_back(std::move(slice)); });
+    for (auto it = slices.rbegin(); it != slices.rend(); ++it) {
+        _size += it->size;
+        _slices.emplace_front(std::move(*it));
+    }
+    _joined = nullptr;
+}
+
+void BufferChain::prepend(std::string str) {
+    prepend(std::make_shared<BufferString>(std::move(str)));
+}
+
+BufferChain::Ptr BufferChain::slice(size_t offset, size_t len) const {
+    if (offset > _size) {
+        throw std::out_of_range("BufferChain::slice out of range");
+    }
+    if (len == std::string::npos || offset + len > _size) {
+        len = _size - offset;
+    }
+    auto ret = create();
+    for (auto &slice : _slices) {
+        if (!len) {
+            break;
+        }
+        if (offset >= slice.size) {
+            offset -= slice.size;
+            continue;
+        }
+        auto size = std::min(slice.size - offset, len);
+        ret->_slices.emplace_back(Slice { slice.buffer, slice.offset + offset, size });
+        ret->_size += size;
+        offset = 0;
+        len -= size;
+    }
+    return ret;
+}
+
+BufferChain::Ptr BufferChain::split(size_t pos) {
+    auto ret = slice(pos);
+    // 从尾部删除[pos, size())
+    // Remove [pos, size()) from the tail
+    auto remove = _size - std::min(pos, _size);
+    while (remove) {
+        auto &back = _slices.back();
+        if (back.size <= remove) {
+            remove -= back.size;
+            _size -= back.size;
+            _slices.pop_back();
+            continue;
+        }
+        back.size -= remove;
+        _size -= remove;
+        remove = 0;
+    }
+    _joined = nullptr;
+    return ret;
+}
+
+void BufferChain::consume(size_t n) {
+    if (n > _size) {
+        throw std::out_of_range("BufferChain::consume out of range");
+    }
+    while (n) {
+        auto &front = _slices.front();
+        if (front.size <= n) {
+            n -= front.size;
+            _size -= front.size;
+            _slices.pop_front();
+            continue;
+        }
+        front.offset += n;
+        front.size -= n;
+        _size -= n;
+        n = 0;
+    }
+    _joined = nullptr;
+}
+
+void BufferChain::clear() {
+    _slices.clear();
+    _size = 0;
+    _joined = nullptr;
+}
+
+char *BufferChain::data() const {
+    if (_slices.empty()) {
+        return nullptr;
+    }
+    if (_slices.size() == 1) {
+        return _slices.front().data();
+    }
+    if (!_joined) {
+        _joined = BufferRaw::create(_size + 1);
+        auto ptr = _joined->data();
+        for (auto &slice : _slices) {
+            memcpy(ptr, slice.data(), slice.size);
+            ptr += slice.size;
+        }
+        *ptr = '\0';
+        _joined->setSize(_size);
+    }
+    return _joined->data();
+}
+
+std::string BufferChain::toString() const {
+    std::string ret;
+    ret.reserve(_size);
+    for (auto &slice : _slices) {
+        ret.append(slice.data(), slice.size);
+    }
+    return ret;
+}
+
 }//namespace toolkit
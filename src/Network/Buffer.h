@@ -13,12 +13,14 @@
 
 #include <cassert>
 #include <memory>
+#include <deque>
 #include <string>
 #include <vector>
 #include <type_traits>
 #include <functional>
 #include "Util/util.h"
 #include "Util/ResourcePool.h"
+#include "Util/CpuTopology.h"
 
 namespace toolkit {
 
@@ -28,6 +30,8 @@ template <typename T> struct is_pointer<std::shared_ptr<T const> > : public std:
 template <typename T> struct is_pointer<T*> : public std::true_type {};
 template <typename T> struct is_pointer<const T*> : public std::true_type {};
 
+class BufferChain;
+
 //缓存基类  [AUTO-TRANSLATED:d130ab72]
 //Cache base class
 class Buffer : public noncopyable {
@@ -50,6 +54,12 @@ public:
         return size();
     }
 
+    // 非连续的缓存(BufferChain)返回其分片链，发送时可直接组成iovec而无需拷贝
+    // Non-contiguous buffers (BufferChain) return their slice chain, so sending can build iovecs directly without copying
+    virtual const BufferChain *getChain() const {
+        return nullptr;
+    }
+
 private:
     //对象个数统计  [AUTO-TRANSLATED:3b43e8c2]
     //Object count statistics
@@ -119,9 +129,7 @@ public:
     static Ptr create(size_t size = 0);
 
     ~BufferRaw() override {
-        if (_data) {
-            delete[] _data;
-        }
+        freeData();
     }
 
     //在写入数据时请确保内存是否越界  [AUTO-TRANSLATED:5602043e]
@@ -160,9 +168,15 @@ public:
                 }
             } while (false);
 
-            delete[] _data;
+            freeData();
+        }
+        // 开启NUMA内存池时从当前线程所在节点分配，否则直接new[]
+        // Allocate from the node of the current thread when the NUMA memory pool is enabled, otherwise plain new[]
+        _data = NumaMemoryPool::isEnabled() ? NumaMemoryPool::allocate(capacity) : nullptr;
+        _pooled = _data != nullptr;
+        if (!_pooled) {
+            _data = new char[capacity];
         }
-        _data = new char[capacity];
         _capacity = capacity;
     }
 
@@ -205,6 +219,16 @@ protected:
     }
 
 private:
+    void freeData() {
+        if (_pooled) {
+            NumaMemoryPool::deallocate(_data);
+        } else {
+            delete[] _data;
+        }
+    }
+
+private:
+    bool _pooled = false;
     size_t _size = 0;
     size_t _capacity = 0;
     char *_data = nullptr;
@@ -487,5 +511,100 @@ private:
     ObjectStatistic<BufferLikeString> _statistic;
 };
 
+/**
+ * 分片链式缓存，由多个共享的Buffer片段组成，不拷贝数据即可头部追加、尾部追加、截取与拆分
+ * 协议层可把报文头与共享的负载组合为一个包，Socket发送时整体作为一组iovec，无需拼接拷贝
+ * 调用data()时若有多个分片，会把数据拼接到内部缓存(有拷贝)，仅为兼容只接受连续内存的使用方
+ * 该对象不是线程安全的，交给Socket发送后不应再修改
+ * Scatter-gather buffer made of shared Buffer slices, supports prepend, append, slice and split without copying data
+ * Protocol layers can combine a header with a shared payload into one packet, Socket sends it as one batch of iovecs without joining copies
+ * data() joins multiple slices into an internal cache (with copying), only for users that require contiguous memory
+ * This object is not thread safe and should not be modified after being handed to Socket
+ */
+class BufferChain : public Buffer {
+public:
+    using Ptr = std::shared_ptr<BufferChain>;
+
+    struct Slice {
+        Buffer::Ptr buffer;
+        size_t offset;
+        size_t size;
+
+        char *data() const { return buffer->data() + offset; }
+    };
+
+    static Ptr create();
+
+    BufferChain() = default;
+    ~BufferChain() override = default;
+
+    char *data() const override;
+
+    size_t size() const override {
+        return _size;
+    }
+
+    std::string toString() const override;
+
+    const BufferChain *getChain() const override {
+        return this;
+    }
+
+    /**
+     * 尾部追加一段数据，buf本身为BufferChain时追加其分片而非嵌套
+     * @param buf 数据
+     * @param offset 从buf的该偏移开始
+     * @param len 长度，npos为到buf末尾
+     * Append data at the tail, if buf is itself a BufferChain its slices are appended instead of nesting it
+     * @param buf Data
+     * @param offset Start from this offset of buf
+     * @param len Length, npos means to the end of buf
+     */
+    void append(const Buffer::Ptr &buf, size_t offset = 0, size_t len = std::string::npos);
+    void append(std::string str);
+
+    /**
+     * 头部追加一段数据，参数同append
+     * Prepend data at the head, parameters are the same as append
+     */
+    void prepend(const Buffer::Ptr &buf, size_t offset = 0, size_t len = std::string::npos);
+    void prepend(std::string str);
+
+    /**
+     * 截取[offset, offset + len)生成新的分片链，与本对象共享数据
+     * Create a new chain of [offset, offset + len), sharing data with this object
+     */
+    Ptr slice(size_t offset, size_t len = std::string::npos) const;
+
+    /**
+     * 在pos处拆分，本对象保留[0, pos)，返回[pos, size())
+     * Split at pos, this object keeps [0, pos) and [pos, size()) is returned
+     */
+    Ptr split(size_t pos);
+
+    /**
+     * 丢弃头部n个字节
+     * Drop n bytes at the head
+     */
+    void consume(size_t n);
+
+    void clear();
+
+    const std::deque<Slice> &slices() const {
+        return _slices;
+    }
+
+private:
+    template <typename FUNC>
+    void forEachRange(const Buffer::Ptr &buf, size_t offset, size_t len, FUNC &&func) const;
+
+private:
+    size_t _size = 0;
+    std::deque<Slice> _slices;
+    // 多个分片时data()拼接的结果
+    // Result of data() joining multiple slices
+    mutable std::shared_ptr<BufferRaw> _joined;
+};
+
 }//namespace toolkit
 #endif //ZLTOOLKIT_BUFFER_H
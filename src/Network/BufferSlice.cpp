@@ -0,0 +1,82 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <new>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include "BufferSlice.h"
+#include "Util/CpuTopology.h"
+
+namespace toolkit {
+
+BufferCore *BufferCore::create(size_t capacity) {
+    // 开启NUMA内存池时从当前线程所在节点分配，否则直接new[]，与BufferRaw一致
+    // Allocate from the node of the current thread when the NUMA memory pool is enabled, otherwise plain new[], same as BufferRaw
+    auto ptr = NumaMemoryPool::isEnabled() ? NumaMemoryPool::allocate(sizeof(BufferCore) + capacity) : nullptr;
+    auto pooled = ptr != nullptr;
+    if (!pooled) {
+        ptr = new char[sizeof(BufferCore) + capacity];
+    }
+    return new (ptr) BufferCore(capacity, pooled);
+}
+
+void BufferCore::destroy() {
+    auto pooled = _pooled;
+    this->~BufferCore();
+    if (pooled) {
+        NumaMemoryPool::deallocate(reinterpret_cast<char *>(this));
+    } else {
+        delete[] reinterpret_cast<char *>(this);
+    }
+}
+
+BufferSlice BufferSlice::create(size_t capacity) {
+    if (capacity > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("BufferSlice capacity too large");
+    }
+    return BufferSlice(BufferCore::create(capacity), 0, (uint32_t)capacity);
+}
+
+BufferSlice BufferSlice::copyFrom(const char *data, size_t size) {
+    auto ret = create(size);
+    memcpy(ret.data(), data, size);
+    return ret;
+}
+
+BufferSlice BufferSlice::slice(size_t offset, size_t len) const {
+    if (offset > _size) {
+        throw std::out_of_range("BufferSlice::slice out of range");
+    }
+    if (len == std::string::npos || offset + len > _size) {
+        len = _size - offset;
+    }
+    if (_core) {
+        _core->addRef();
+    }
+    return BufferSlice(_core, _offset + (uint32_t)offset, (uint32_t)len);
+}
+
+void BufferSlice::resize(size_t size) {
+    if (size > _size) {
+        throw std::out_of_range("BufferSlice::resize can only shrink");
+    }
+    _size = (uint32_t)size;
+}
+
+Buffer::Ptr BufferSlice::toBuffer() const & {
+    return std::make_shared<BufferSliceHolder>(*this);
+}
+
+Buffer::Ptr BufferSlice::toBuffer() && {
+    return std::make_shared<BufferSliceHolder>(std::move(*this));
+}
+
+} // namespace toolkit
@@ -0,0 +1,166 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_BUFFERSLICE_H
+#define ZLTOOLKIT_BUFFERSLICE_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include "Buffer.h"
+
+namespace toolkit {
+
+/**
+ * 侵入式引用计数的缓存块，计数与数据在同一次内存分配中，数据紧跟在对象之后
+ * 由BufferSlice管理其生命周期，不直接使用
+ * Buffer block with an intrusive reference count, the count and the data share one allocation and the data follows the object
+ * Its lifetime is managed by BufferSlice, it is not used directly
+ */
+class BufferCore {
+public:
+    static BufferCore *create(size_t capacity);
+
+    char *data() { return reinterpret_cast<char *>(this + 1); }
+    size_t capacity() const { return _capacity; }
+    size_t useCount() const { return _ref.load(std::memory_order_relaxed); }
+
+    void addRef() { _ref.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() {
+        if (_ref.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            destroy();
+        }
+    }
+
+private:
+    BufferCore(size_t capacity, bool pooled) : _pooled(pooled), _capacity(capacity) {}
+    void destroy();
+
+private:
+    std::atomic<size_t> _ref { 1 };
+    // 是否由NUMA内存池分配
+    // Whether allocated by the NUMA memory pool
+    bool _pooled;
+    size_t _capacity;
+};
+
+/**
+ * 缓存切片句柄，仅包含缓存块指针、偏移与长度，拷贝与截取只增加引用计数，不分配内存
+ * 适用于把一次读取的数据拆分为大量小包再转发的场景，在需要Buffer::Ptr的接口处通过toBuffer()转换
+ * Buffer slice handle, made of only a block pointer, an offset and a length, copying and slicing only add a reference, without allocating memory
+ * Suited to splitting one read into many small packets and forwarding them, use toBuffer() where an interface needs a Buffer::Ptr
+ */
+class BufferSlice {
+public:
+    BufferSlice() = default;
+
+    /**
+     * 分配指定大小的缓存块，返回覆盖整个缓存块的切片
+     * Allocate a block of the given capacity and return a slice covering the whole block
+     */
+    static BufferSlice create(size_t capacity);
+
+    /**
+     * 拷贝一段数据生成切片
+     * Create a slice by copying data
+     */
+    static BufferSlice copyFrom(const char *data, size_t size);
+
+    BufferSlice(const BufferSlice &that) : _core(that._core), _offset(that._offset), _size(that._size) {
+        if (_core) {
+            _core->addRef();
+        }
+    }
+
+    BufferSlice(BufferSlice &&that) noexcept : _core(that._core), _offset(that._offset), _size(that._size) {
+        that._core = nullptr;
+        that._offset = that._size = 0;
+    }
+
+    BufferSlice &operator=(const BufferSlice &that) {
+        BufferSlice(that).swap(*this);
+        return *this;
+    }
+
+    BufferSlice &operator=(BufferSlice &&that) noexcept {
+        BufferSlice(std::move(that)).swap(*this);
+        return *this;
+    }
+
+    ~BufferSlice() {
+        if (_core) {
+            _core->release();
+        }
+    }
+
+    void swap(BufferSlice &that) noexcept {
+        std::swap(_core, that._core);
+        std::swap(_offset, that._offset);
+        std::swap(_size, that._size);
+    }
+
+    char *data() const { return _core ? _core->data() + _offset : nullptr; }
+    size_t size() const { return _size; }
+    bool empty() const { return !_size; }
+    explicit operator bool() const { return _core != nullptr; }
+
+    /**
+     * 截取[offset, offset + len)，与本切片共享缓存块
+     * Take [offset, offset + len), sharing the block with this slice
+     */
+    BufferSlice slice(size_t offset, size_t len = std::string::npos) const;
+
+    /**
+     * 缩短切片长度，例如读取数据后设置为实际读取的字节数
+     * Shrink the slice, for example to the number of bytes actually read
+     */
+    void resize(size_t size);
+
+    /**
+     * 转换为Buffer::Ptr，用于只接受Buffer::Ptr的接口(如Socket::send)，会分配一个包装对象
+     * Convert to a Buffer::Ptr for interfaces that only accept Buffer::Ptr (such as Socket::send), one wrapper object is allocated
+     */
+    Buffer::Ptr toBuffer() const &;
+    Buffer::Ptr toBuffer() &&;
+
+    size_t useCount() const { return _core ? _core->useCount() : 0; }
+
+    std::string toString() const { return std::string(data(), _size); }
+
+private:
+    BufferSlice(BufferCore *core, uint32_t offset, uint32_t size) : _core(core), _offset(offset), _size(size) {}
+
+private:
+    BufferCore *_core = nullptr;
+    uint32_t _offset = 0;
+    uint32_t _size = 0;
+};
+
+/**
+ * 持有BufferSlice的Buffer，由BufferSlice::toBuffer()创建
+ * Buffer holding a BufferSlice, created by BufferSlice::toBuffer()
+ */
+class BufferSliceHolder : public Buffer {
+public:
+    explicit BufferSliceHolder(BufferSlice slice) : _slice(std::move(slice)) {}
+    ~BufferSliceHolder() override = default;
+
+    char *data() const override { return _slice.data(); }
+    size_t size() const override { return _slice.size(); }
+
+    const BufferSlice &getSlice() const { return _slice; }
+
+private:
+    BufferSlice _slice;
+};
+
+} // namespace toolkit
+#endif // ZLTOOLKIT_BUFFERSLICE_H
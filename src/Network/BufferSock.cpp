@@ -84,6 +84,42 @@ socklen_t BufferSock::socklen() const {
     return _addr_len;
 }
 
+const BufferChain *BufferSock::getChain() const {
+    return _buffer->getChain();
+}
+
+/////////////////////////////////////// SocketBuf ///////////////////////////////////////
+#if defined(_WIN32)
+using SocketBuf = WSABUF;
+#else
+using SocketBuf = iovec;
+#endif
+
+static inline void setSocketBuf(SocketBuf &buf, char *data, size_t size) {
+#if !defined(_WIN32)
+    buf.iov_base = data;
+    buf.iov_len = size;
+#else
+    buf.buf = data;
+    buf.len = (ULONG)size;
+#endif
+}
+
+// 把一个包展开为一个或多个SocketBuf(BufferChain的每个分片一个)，返回SocketBuf个数
+// Expand one packet into one or more SocketBufs (one per slice of a BufferChain), returns the number of SocketBufs
+template <typename FUNC>
+static inline size_t forEachSocketBuf(const Buffer::Ptr &buffer, FUNC &&func) {
+    auto chain = buffer->getChain();
+    if (!chain) {
+        func(buffer->data(), buffer->size());
+        return 1;
+    }
+    for (auto &slice : chain->slices()) {
+        func(slice.data(), slice.size);
+    }
+    return chain->slices().size();
+}
+
 /////////////////////////////////////// BufferCallBack ///////////////////////////////////////
 
 class BufferCallBack {
@@ -124,11 +160,6 @@ protected:
 };
 
 /////////////////////////////////////// BufferSendMsg ///////////////////////////////////////
-#if defined(_WIN32)
-using SocketBuf = WSABUF;
-#else
-using SocketBuf = iovec;
-#endif
 
 class BufferSendMsg final : public BufferList, public BufferCallBack {
 public:
@@ -139,6 +170,7 @@ public:
 
     bool empty() override;
     size_t count() override;
+    size_t remainSize() override;
     ssize_t send(int fd, int flags) override;
 
 private:
@@ -149,6 +181,9 @@ private:
     size_t _iovec_off = 0;
     size_t _remain_size = 0;
     SocketBufVec _iovec;
+    // 标记每个SocketBuf是否为其所属包的最后一段
+    // Marks whether each SocketBuf is the last piece of its packet
+    std::vector<bool> _pkt_end;
 };
 
 bool BufferSendMsg::empty() {
@@ -156,7 +191,11 @@ bool BufferSendMsg::empty() {
 }
 
 size_t BufferSendMsg::count() {
-    return _iovec.size() - _iovec_off;
+    return _pkt_list.size();
+}
+
+size_t BufferSendMsg::remainSize() {
+    return _remain_size;
 }
 
 ssize_t BufferSendMsg::send_l(int fd, int flags) {
@@ -233,7 +272,9 @@ void BufferSendMsg::reOffset(size_t n) {
         if (offset < n) {
             //此包发送完毕  [AUTO-TRANSLATED:759b9f0e]
             //This package is sent
-            sendFrontSuccess();
+            if (_pkt_end[i]) {
+                sendFrontSuccess();
+            }
             continue;
         }
         _iovec_off = i;
@@ -241,7 +282,9 @@ void BufferSendMsg::reOffset(size_t n) {
             //这是末尾发送完毕的一个包  [AUTO-TRANSLATED:6a3b77e4]
             //This is the last package sent
             ++_iovec_off;
-            sendFrontSuccess();
+            if (_pkt_end[i]) {
+                sendFrontSuccess();
+            }
             break;
         }
         //这是末尾发送部分成功的一个包  [AUTO-TRANSLATED:64645cef]
@@ -259,20 +302,17 @@ void BufferSendMsg::reOffset(size_t n) {
 }
 
 BufferSendMsg::BufferSendMsg(List<std::pair<Buffer::Ptr, bool>> list, SendResult cb)
-    : BufferCallBack(std::move(list), std::move(cb))
-    , _iovec(_pkt_list.size()) {
-    auto it = _iovec.begin();
+    : BufferCallBack(std::move(list), std::move(cb)) {
+    _iovec.reserve(_pkt_list.size());
+    _pkt_end.reserve(_pkt_list.size());
     _pkt_list.for_each([&](std::pair<Buffer::Ptr, bool> &pr) {
-#if !defined(_WIN32)
-        it->iov_base = pr.first->data();
-        it->iov_len = pr.first->size();
-        _remain_size += it->iov_len;
-#else
-        it->buf = pr.first->data();
-        it->len = pr.first->size();
-        _remain_size += it->len;
-#endif
-        ++it;
+        forEachSocketBuf(pr.first, [&](char *data, size_t size) {
+            _iovec.emplace_back();
+            setSocketBuf(_iovec.back(), data, size);
+            _pkt_end.emplace_back(false);
+            _remain_size += size;
+        });
+        _pkt_end.back() = true;
     });
 }
 
@@ -284,16 +324,20 @@ public:
 
     bool empty() override;
     size_t count() override;
+    size_t remainSize() override;
     ssize_t send(int fd, int flags) override;
 
 private:
     bool _is_udp;
     size_t _offset = 0;
+    size_t _remain_size = 0;
 };
 
 BufferSendTo::BufferSendTo(List<std::pair<Buffer::Ptr, bool>> list, BufferList::SendResult cb, bool is_udp)
     : BufferCallBack(std::move(list), std::move(cb))
-    , _is_udp(is_udp) {}
+    , _is_udp(is_udp) {
+    _pkt_list.for_each([&](std::pair<Buffer::Ptr, bool> &pr) { _remain_size += pr.first->size(); });
+}
 
 bool BufferSendTo::empty() {
     return _pkt_list.empty();
@@ -303,6 +347,10 @@ size_t BufferSendTo::count() {
     return _pkt_list.size();
 }
 
+size_t BufferSendTo::remainSize() {
+    return _remain_size;
+}
+
 static inline BufferSock *getBufferSockPtr(std::pair<Buffer::Ptr, bool> &pr) {
     if (!pr.second) {
         return nullptr;
@@ -326,6 +374,7 @@ ssize_t BufferSendTo::send(int fd, int flags) {
         if (n >= 0) {
             assert(n);
             _offset += n;
+            _remain_size -= n;
             if (_offset == buffer->size()) {
                 sendFrontSuccess();
                 _offset = 0;
@@ -359,6 +408,7 @@ public:
 
     bool empty() override;
     size_t count() override;
+    size_t remainSize() override;
     ssize_t send(int fd, int flags) override;
 
 private:
@@ -379,6 +429,10 @@ size_t BufferSendMMsg::count() {
     return _hdrvec.size();
 }
 
+size_t BufferSendMMsg::remainSize() {
+    return _remain_size;
+}
+
 ssize_t BufferSendMMsg::send_l(int fd, int flags) {
     ssize_t n;
     do {
@@ -414,10 +468,14 @@ ssize_t BufferSendMMsg::send(int fd, int flags) {
 void BufferSendMMsg::reOffset(size_t n) {
     for (auto it = _hdrvec.begin(); it != _hdrvec.end();) {
         auto &hdr = *it;
-        auto &io = *(hdr.msg_hdr.msg_iov);
-        assert(hdr.msg_len <= io.iov_len);
+        auto &msg = hdr.msg_hdr;
+        size_t pkt_size = 0;
+        for (size_t i = 0; i < msg.msg_iovlen; ++i) {
+            pkt_size += msg.msg_iov[i].iov_len;
+        }
+        assert(hdr.msg_len <= pkt_size);
         _remain_size -= hdr.msg_len;
-        if (hdr.msg_len == io.iov_len) {
+        if (hdr.msg_len == pkt_size) {
             //这个udp包全部发送成功  [AUTO-TRANSLATED:fce1cc86]
             //this UDP packet sent successfully
             it = _hdrvec.erase(it);
@@ -426,34 +484,50 @@ void BufferSendMMsg::reOffset(size_t n) {
         }
         //部分发送成功  [AUTO-TRANSLATED:4c240905]
         //partially sent successfully
-        io.iov_base = (char *)io.iov_base + hdr.msg_len;
-        io.iov_len -= hdr.msg_len;
+        size_t sent = hdr.msg_len;
+        while (sent >= msg.msg_iov->iov_len) {
+            sent -= msg.msg_iov->iov_len;
+            ++msg.msg_iov;
+            --msg.msg_iovlen;
+        }
+        msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + sent;
+        msg.msg_iov->iov_len -= sent;
+        hdr.msg_len = 0;
         break;
     }
 }
 
 BufferSendMMsg::BufferSendMMsg(List<std::pair<Buffer::Ptr, bool>> list, SendResult cb)
     : BufferCallBack(std::move(list), std::move(cb))
-    , _iovec(_pkt_list.size())
     , _hdrvec(_pkt_list.size()) {
-    auto i = 0U;
+    // 先展开所有包的iovec，之后再设置指针，避免vector扩容导致指针失效
+    // Expand the iovecs of all packets first and set the pointers afterwards, so vector growth cannot invalidate them
+    std::vector<size_t> iov_count;
+    iov_count.reserve(_pkt_list.size());
+    _iovec.reserve(_pkt_list.size());
     _pkt_list.for_each([&](std::pair<Buffer::Ptr, bool> &pr) {
-        auto &io = _iovec[i];
-        io.iov_base = pr.first->data();
-        io.iov_len = pr.first->size();
-        _remain_size += io.iov_len;
+        iov_count.emplace_back(forEachSocketBuf(pr.first, [&](char *data, size_t size) {
+            _iovec.emplace_back();
+            setSocketBuf(_iovec.back(), data, size);
+            _remain_size += size;
+        }));
+    });
 
+    auto i = 0U;
+    size_t iov_index = 0;
+    _pkt_list.for_each([&](std::pair<Buffer::Ptr, bool> &pr) {
         auto ptr = getBufferSockPtr(pr);
         auto &mmsg = _hdrvec[i];
         auto &msg = mmsg.msg_hdr;
         mmsg.msg_len = 0;
         msg.msg_name = ptr ? (void *)ptr->sockaddr() : nullptr;
         msg.msg_namelen = ptr ? ptr->socklen() : 0;
-        msg.msg_iov = &io;
-        msg.msg_iovlen = 1;
+        msg.msg_iov = &_iovec[iov_index];
+        msg.msg_iovlen = iov_count[i];
         msg.msg_control = nullptr;
         msg.msg_controllen = 0;
         msg.msg_flags = 0;
+        iov_index += iov_count[i];
         ++i;
     });
 }
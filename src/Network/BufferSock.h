@@ -43,6 +43,7 @@ public:
     size_t size() const override;
     const struct sockaddr *sockaddr() const;
     socklen_t  socklen() const;
+    const BufferChain *getChain() const override;
 
 private:
     int _addr_len = 0;
@@ -60,6 +61,9 @@ public:
 
     virtual bool empty() = 0;
     virtual size_t count() = 0;
+    // 剩余未发送的字节数
+    // Remaining bytes not yet sent
+    virtual size_t remainSize() = 0;
     virtual ssize_t send(int fd, int flags) = 0;
 
     static Ptr create(List<std::pair<Buffer::Ptr, bool> > list, SendResult cb, bool is_udp);
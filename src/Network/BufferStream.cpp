@@ -0,0 +1,165 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "BufferStream.h"
+
+using namespace std;
+
+namespace toolkit {
+
+// 内存块大小为2的幂，最小4KB
+// Block sizes are powers of two, at least 4KB
+static constexpr size_t kMinBlockSize = 4 * 1024;
+
+static size_t roundUp(size_t size) {
+    size_t ret = kMinBlockSize;
+    while (ret < size) {
+        ret <<= 1;
+    }
+    return ret;
+}
+
+// 在NumaMemoryPool分档范围内的内存块从其分配，复用其线程缓存；更大或未开启时直接new[]
+// Blocks within the size classes of NumaMemoryPool come from it and reuse its thread cache; larger ones, or all of them when it is disabled, use plain new[]
+static char *allocateBlock(size_t capacity, bool &pooled) {
+    auto ret = NumaMemoryPool::isEnabled() ? NumaMemoryPool::allocate(capacity) : nullptr;
+    pooled = ret != nullptr;
+    return pooled ? ret : new char[capacity];
+}
+
+static void deallocateBlock(char *ptr, bool pooled) {
+    if (pooled) {
+        NumaMemoryPool::deallocate(ptr);
+    } else {
+        delete[] ptr;
+    }
+}
+
+BufferStream::BufferStream(size_t capacity) {
+    if (capacity) {
+        _capacity = roundUp(capacity + 1);
+        _data = allocateBlock(_capacity, _pooled);
+        terminate();
+    }
+}
+
+BufferStream::~BufferStream() {
+    release();
+}
+
+BufferStream::BufferStream(BufferStream &&that) noexcept
+    : _data(that._data)
+    , _head(that._head)
+    , _tail(that._tail)
+    , _capacity(that._capacity)
+    , _pooled(that._pooled) {
+    that._data = nullptr;
+    that._head = that._tail = that._capacity = 0;
+}
+
+BufferStream &BufferStream::operator=(BufferStream &&that) noexcept {
+    if (this != &that) {
+        release();
+        std::swap(_data, that._data);
+        std::swap(_head, that._head);
+        std::swap(_tail, that._tail);
+        std::swap(_capacity, that._capacity);
+        std::swap(_pooled, that._pooled);
+    }
+    return *this;
+}
+
+char *BufferStream::prepare(size_t len) {
+    // 末尾需要保留一个字节给'\0'
+    // One byte at the end is reserved for '\0'
+    if (_data && _tail + len < _capacity) {
+        return _data + _tail;
+    }
+    auto remain = size();
+    if (_data && remain + len < _capacity) {
+        // 尾部空间不足但总容量足够，原地把未消费数据搬到头部
+        // The tail is short of space but the total capacity is enough, move the unconsumed data to the front in place
+        memmove(_data, _data + _head, remain);
+    } else {
+        auto capacity = roundUp(remain + len + 1);
+        bool pooled;
+        auto data = allocateBlock(capacity, pooled);
+        if (remain) {
+            memcpy(data, _data + _head, remain);
+        }
+        if (_data) {
+            deallocateBlock(_data, _pooled);
+        }
+        _data = data;
+        _capacity = capacity;
+        _pooled = pooled;
+    }
+    _head = 0;
+    _tail = remain;
+    return _data + _tail;
+}
+
+void BufferStream::commit(size_t len) {
+    if (_tail + len >= _capacity) {
+        throw std::out_of_range("BufferStream::commit out of range");
+    }
+    _tail += len;
+    terminate();
+}
+
+void BufferStream::append(const char *data, size_t len) {
+    if (!len) {
+        return;
+    }
+    memcpy(prepare(len), data, len);
+    commit(len);
+}
+
+void BufferStream::consume(size_t len) {
+    if (len > size()) {
+        throw std::out_of_range("BufferStream::consume out of range");
+    }
+    _head += len;
+    if (_head == _tail) {
+        // 数据已全部消费，下次从头部写入，避免搬移
+        // All data consumed, write from the front next time so no move is needed
+        clear();
+    }
+}
+
+void BufferStream::clear() {
+    _head = _tail = 0;
+    if (_data) {
+        terminate();
+    }
+}
+
+void BufferStream::release() {
+    if (_data) {
+        deallocateBlock(_data, _pooled);
+        _data = nullptr;
+    }
+    _head = _tail = _capacity = 0;
+}
+
+string BufferStream::substr(size_t pos, size_t len) const {
+    if (pos > size()) {
+        throw std::out_of_range("BufferStream::substr out of range");
+    }
+    if (len == string::npos || pos + len > size()) {
+        len = size() - pos;
+    }
+    return string(data() + pos, len);
+}
+
+} // namespace toolkit
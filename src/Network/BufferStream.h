@@ -0,0 +1,104 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_BUFFERSTREAM_H
+#define ZLTOOLKIT_BUFFERSTREAM_H
+
+#include <string>
+#include "Buffer.h"
+
+namespace toolkit {
+
+/**
+ * 流式协议解析用的接收缓存，容量为2的幂，不超过64KB的内存块来自NumaMemoryPool(开启时)，更大的直接new[]
+ * 头部消费为O(1)，只移动读位置；仅当尾部空间不足时才在原地把未消费数据搬到头部，原地放不下才换更大的内存块
+ * 数据末尾总是保留一个'\0'，可以当作c字符串查找
+ * Receive buffer for stream protocol parsing, its capacity is a power of two and blocks up to 64KB come from NumaMemoryPool (when enabled), larger ones use plain new[]
+ * Consuming at the head is O(1) and only moves the read position; unconsumed data is moved to the front in place only when the tail runs out of space, and a bigger block is used only if it still does not fit
+ * The data is always followed by a '\0', so it can be searched as a c string
+ */
+class BufferStream : public Buffer {
+public:
+    using Ptr = std::shared_ptr<BufferStream>;
+
+    explicit BufferStream(size_t capacity = 0);
+    ~BufferStream() override;
+
+    BufferStream(BufferStream &&that) noexcept;
+    BufferStream &operator=(BufferStream &&that) noexcept;
+
+    char *data() const override {
+        return _data ? _data + _head : const_cast<char *>("");
+    }
+
+    size_t size() const override {
+        return _tail - _head;
+    }
+
+    size_t getCapacity() const override {
+        return _capacity;
+    }
+
+    bool empty() const {
+        return _tail == _head;
+    }
+
+    /**
+     * 尾部追加数据
+     * Append data at the tail
+     */
+    void append(const char *data, size_t len);
+    void append(const std::string &str) { append(str.data(), str.size()); }
+    void append(const Buffer &buf) { append(buf.data(), buf.size()); }
+
+    /**
+     * 获取至少len字节的尾部可写空间，写入后调用commit()，用于直接从socket读到缓存中
+     * Get writable tail space of at least len bytes and call commit() after writing, used to read from a socket directly into the buffer
+     */
+    char *prepare(size_t len);
+    void commit(size_t len);
+
+    /**
+     * 丢弃头部n个字节(已解析的数据)
+     * Drop n bytes at the head (data already parsed)
+     */
+    void consume(size_t len);
+
+    /**
+     * 清空数据，保留内存块
+     * Clear the data and keep the memory block
+     */
+    void clear();
+
+    /**
+     * 清空数据并释放内存块
+     * Clear the data and free the memory block
+     */
+    void release();
+
+    std::string substr(size_t pos, size_t len = std::string::npos) const;
+
+private:
+    void terminate() {
+        _data[_tail] = '\0';
+    }
+
+private:
+    char *_data = nullptr;
+    size_t _head = 0;
+    size_t _tail = 0;
+    size_t _capacity = 0;
+    // 内存块是否由NumaMemoryPool分配
+    // Whether the block was allocated by NumaMemoryPool
+    bool _pooled = false;
+};
+
+} // namespace toolkit
+#endif // ZLTOOLKIT_BUFFERSTREAM_H
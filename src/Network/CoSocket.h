@@ -0,0 +1,268 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_COSOCKET_H
+#define ZLTOOLKIT_COSOCKET_H
+
+#include "Poller/Coroutine.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#include "Socket.h"
+
+namespace toolkit {
+
+/**
+ * Socket的协程封装，提供connect/read/write/accept等可co_await的操作
+ * 该对象及其协程需在socket所属的poller线程中使用，同一时刻每种操作最多只有一个协程在等待
+ * Coroutine wrapper of Socket, providing co_await-able connect/read/write/accept operations
+ * This object and its coroutines must be used in the poller thread of the socket, at most one coroutine waits on each kind of operation at a time
+ */
+class CoSocket {
+public:
+    explicit CoSocket(const EventPoller::Ptr &poller) : CoSocket(Socket::createSocket(poller, false)) {}
+
+    /**
+     * 封装已有的socket，例如accept()得到的socket
+     * Wrap an existing socket, such as one returned by accept()
+     */
+    explicit CoSocket(Socket::Ptr sock) : _sock(std::move(sock)), _state(std::make_shared<State>(_sock->getPoller())) {
+        std::weak_ptr<State> weak_state = _state;
+        _sock->setOnRead([weak_state](Buffer::Ptr &buf, struct sockaddr *, int) {
+            auto state = weak_state.lock();
+            if (!state) {
+                return;
+            }
+            if (state->reader && state->recv_queue.empty()) {
+                // 协程正在等待，直接转移接收缓存的所有权，免去拷贝；socket在下次读取前会重新分配接收缓存
+                // A coroutine is waiting, take over the receive buffer itself without a copy; the socket allocates a new receive buffer before its next read
+                state->recv_queue.emplace_back(std::move(buf));
+            } else {
+                // 数据需要排队，接收缓存会被复用，按实际大小拷贝一份，避免排队的数据占用整个接收缓存
+                // The data has to be queued and the receive buffer is reused, copy it at its real size so queued data does not hold a whole receive buffer
+                auto copy = BufferRaw::create();
+                copy->assign(buf->data(), buf->size());
+                state->recv_queue.emplace_back(std::move(copy));
+            }
+            state->resume(state->reader);
+        });
+        _sock->setOnErr([weak_state](const SockException &err) {
+            if (auto state = weak_state.lock()) {
+                state->err = err;
+                state->resumeAll();
+            }
+        });
+        _sock->setOnFlush([weak_state]() {
+            if (auto state = weak_state.lock()) {
+                state->resume(state->writer);
+            }
+            return true;
+        });
+        _sock->setOnAccept([weak_state](Socket::Ptr &sock, std::shared_ptr<void> &) {
+            if (auto state = weak_state.lock()) {
+                state->accept_queue.emplace_back(sock);
+                state->resume(state->acceptor);
+            }
+        });
+    }
+
+    /**
+     * 销毁时仍在等待的协程(例如由其他协程销毁本对象)会以错误结束等待：read/accept返回nullptr，write返回false，connect返回错误
+     * Coroutines still waiting at destruction (for example when another coroutine destroys this object) finish their wait with an error: read/accept return nullptr, write returns false, connect returns the error
+     */
+    ~CoSocket() {
+        _sock->setOnRead(nullptr);
+        _sock->setOnErr([](const SockException &) {});
+        _sock->setOnFlush(nullptr);
+        _sock->setOnAccept([](Socket::Ptr &, std::shared_ptr<void> &) {});
+        _sock->closeSock();
+        if (!_state->err) {
+            _state->err = SockException(Err_shutdown, "CoSocket destroyed");
+        }
+        _state->recv_queue.clear();
+        _state->accept_queue.clear();
+        _state->connect_result = _state->err;
+        _state->resumeAll();
+    }
+
+    CoSocket(const CoSocket &) = delete;
+    CoSocket &operator=(const CoSocket &) = delete;
+
+    const Socket::Ptr &getSock() const { return _sock; }
+
+    /**
+     * 最近一次的错误(连接断开等)
+     * The last error (disconnection etc.)
+     */
+    const SockException &getError() const { return _state->err; }
+
+    /**
+     * 连接服务器，co_await返回连接结果
+     * Connect to the server, co_await returns the connection result
+     */
+    auto connect(const std::string &host, uint16_t port, float timeout_sec = 5) {
+        struct Awaiter {
+            Socket::Ptr sock;
+            std::shared_ptr<State> state;
+            std::string host;
+            uint16_t port;
+            float timeout_sec;
+            co_detail::ResumeGuard guard;
+
+            bool await_ready() const { return false; }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                state->err = SockException();
+                state->connector = guard.arm(handle);
+                std::weak_ptr<State> weak_state = state;
+                sock->connect(host, port, [weak_state](const SockException &err) {
+                    if (auto state = weak_state.lock()) {
+                        state->connect_result = err;
+                        state->resume(state->connector);
+                    }
+                }, timeout_sec);
+            }
+
+            SockException await_resume() { return state->connect_result; }
+        };
+        return Awaiter { _sock, _state, host, port, timeout_sec };
+    }
+
+    /**
+     * 读取数据，co_await返回收到的数据，连接断开时返回nullptr(原因见getError())
+     * 已在等待时收到的数据不拷贝，返回的是socket的接收缓存本身(容量较大，不宜长期持有)；协程未在等待时数据拷贝一份后排队
+     * Read data, co_await returns the received data, or nullptr when disconnected (see getError() for the reason)
+     * Data arriving while already waiting is not copied, the socket receive buffer itself is returned (it has a large capacity, do not hold it for long); data arriving while no coroutine waits is copied and queued
+     */
+    auto read() {
+        struct Awaiter {
+            std::shared_ptr<State> state;
+            co_detail::ResumeGuard guard;
+
+            bool await_ready() const { return !state->recv_queue.empty() || state->err; }
+            void await_suspend(std::coroutine_handle<> handle) { state->reader = guard.arm(handle); }
+
+            Buffer::Ptr await_resume() {
+                if (state->recv_queue.empty()) {
+                    return nullptr;
+                }
+                Buffer::Ptr ret = std::move(state->recv_queue.front());
+                state->recv_queue.pop_front();
+                return ret;
+            }
+        };
+        return Awaiter { _state };
+    }
+
+    /**
+     * 发送数据，发送缓存积压时挂起直到缓存清空，从而实现发送流控
+     * co_await返回是否成功
+     * Send data, suspend until the send buffer is flushed when data is backlogged, which implements send flow control
+     * co_await returns whether it succeeded
+     */
+    auto write(Buffer::Ptr buf) {
+        struct Awaiter {
+            Socket::Ptr sock;
+            std::shared_ptr<State> state;
+            Buffer::Ptr buf;
+            bool success = true;
+            co_detail::ResumeGuard guard;
+
+            bool await_ready() {
+                if (state->err || sock->send(std::move(buf)) < 0) {
+                    success = false;
+                    return true;
+                }
+                return !sock->isSocketBusy();
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) { state->writer = guard.arm(handle); }
+            bool await_resume() const { return success && !state->err; }
+        };
+        return Awaiter { _sock, _state, std::move(buf) };
+    }
+
+    auto write(std::string str) { return write(std::make_shared<BufferString>(std::move(str))); }
+
+    /**
+     * 监听端口，之后可通过accept()接收新连接
+     * Listen on a port, new connections can be received with accept() afterwards
+     */
+    bool listen(uint16_t port, const std::string &local_ip = "::", int backlog = 1024) {
+        return _sock->listen(port, local_ip, backlog);
+    }
+
+    /**
+     * 接收新连接，co_await返回新的socket，监听socket出错时返回nullptr
+     * Accept a new connection, co_await returns the new socket, or nullptr if the listening socket fails
+     */
+    auto accept() {
+        struct Awaiter {
+            std::shared_ptr<State> state;
+            co_detail::ResumeGuard guard;
+
+            bool await_ready() const { return !state->accept_queue.empty() || state->err; }
+            void await_suspend(std::coroutine_handle<> handle) { state->acceptor = guard.arm(handle); }
+
+            Socket::Ptr await_resume() {
+                if (state->accept_queue.empty()) {
+                    return nullptr;
+                }
+                auto ret = std::move(state->accept_queue.front());
+                state->accept_queue.pop_front();
+                return ret;
+            }
+        };
+        return Awaiter { _state };
+    }
+
+private:
+    // 等待状态，由本对象与挂起中的等待对象共同持有，本对象先于等待的协程销毁时仍然有效
+    // Wait state, shared by this object and the suspended awaiters, so it stays valid when this object is destroyed before the waiting coroutines
+    struct State {
+        explicit State(EventPoller::Ptr poller_in) : poller(std::move(poller_in)) {}
+
+        void resume(co_detail::ResumeToken::Ptr &token) {
+            if (!token) {
+                return;
+            }
+            // 不在socket回调中直接恢复协程，避免协程在回调中关闭socket
+            // Do not resume the coroutine inside the socket callback, so the coroutine never closes the socket from within its callback
+            co_detail::postResume(poller, std::move(token));
+            token = nullptr;
+        }
+
+        void resumeAll() {
+            resume(reader);
+            resume(writer);
+            resume(acceptor);
+            resume(connector);
+        }
+
+        EventPoller::Ptr poller;
+        SockException err;
+        SockException connect_result;
+        co_detail::ResumeToken::Ptr reader;
+        co_detail::ResumeToken::Ptr writer;
+        co_detail::ResumeToken::Ptr acceptor;
+        co_detail::ResumeToken::Ptr connector;
+        List<Buffer::Ptr> recv_queue;
+        List<Socket::Ptr> accept_queue;
+    };
+
+private:
+    Socket::Ptr _sock;
+    std::shared_ptr<State> _state;
+};
+
+} // namespace toolkit
+
+#endif // defined(__cpp_impl_coroutine)
+#endif // ZLTOOLKIT_COSOCKET_H
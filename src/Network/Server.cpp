@@ -52,35 +52,62 @@ const std::string &SessionHelper::className() const {
 
 ////////////////////////////////////////////////////////////////////////////////////
 
+SessionMap::Shard &SessionMap::getShard(const string &tag) {
+    return _shards[std::hash<string>()(tag) & (kShardCount - 1)];
+}
+
 bool SessionMap::add(const string &tag, const Session::Ptr &session) {
-    lock_guard<mutex> lck(_mtx_session);
-    return _map_session.emplace(tag, session).second;
+    auto &shard = getShard(tag);
+    lock_guard<mutex> lck(shard.mtx);
+    return shard.map.emplace(tag, session).second;
 }
 
 bool SessionMap::del(const string &tag) {
-    lock_guard<mutex> lck(_mtx_session);
-    return _map_session.erase(tag);
+    auto &shard = getShard(tag);
+    lock_guard<mutex> lck(shard.mtx);
+    return shard.map.erase(tag);
 }
 
 Session::Ptr SessionMap::get(const string &tag) {
-    lock_guard<mutex> lck(_mtx_session);
-    auto it = _map_session.find(tag);
-    if (it == _map_session.end()) {
-        return nullptr;
+    auto &shard = getShard(tag);
+    std::weak_ptr<Session> weak_session;
+    {
+        lock_guard<mutex> lck(shard.mtx);
+        auto it = shard.map.find(tag);
+        if (it == shard.map.end()) {
+            return nullptr;
+        }
+        weak_session = it->second;
     }
-    return it->second.lock();
+    // weak_ptr提升在锁外进行，缩短临界区
+    // Promote the weak_ptr outside the lock to shorten the critical section
+    return weak_session.lock();
 }
 
 void SessionMap::for_each_session(const function<void(const string &id, const Session::Ptr &session)> &cb) {
-    lock_guard<mutex> lck(_mtx_session);
-    for (auto it = _map_session.begin(); it != _map_session.end();) {
-        auto session = it->second.lock();
-        if (!session) {
-            it = _map_session.erase(it);
-            continue;
+    std::vector<std::pair<string, std::weak_ptr<Session> > > snapshot;
+    for (auto &shard : _shards) {
+        snapshot.clear();
+        {
+            // 只在拷贝快照期间持有分片锁，并顺带清理已失效的记录
+            // Only hold the shard lock while copying the snapshot, and clean up expired records along the way
+            lock_guard<mutex> lck(shard.mtx);
+            snapshot.reserve(shard.map.size());
+            for (auto it = shard.map.begin(); it != shard.map.end();) {
+                if (it->second.expired()) {
+                    it = shard.map.erase(it);
+                    continue;
+                }
+                snapshot.emplace_back(it->first, it->second);
+                ++it;
+            }
+        }
+        for (auto &pr : snapshot) {
+            auto session = pr.second.lock();
+            if (session) {
+                cb(pr.first, session);
+            }
         }
-        cb(it->first, session);
-        ++it;
     }
 }
 
@@ -11,8 +11,10 @@
 #ifndef ZLTOOLKIT_SERVER_H
 #define ZLTOOLKIT_SERVER_H
 
+#include <array>
 #include <unordered_map>
 #include "Util/mini.h"
+#include "Util/FlatHashMap.h"
 #include "Session.h"
 
 namespace toolkit {
@@ -21,6 +23,8 @@ namespace toolkit {
 //Global Session record object, convenient for later management
 // 线程安全的  [AUTO-TRANSLATED:efbca605]
 //Thread-safe
+// 内部按tag哈希分片，每个分片独立加锁，减少高频连接建立/断开时的锁竞争
+// Internally sharded by tag hash, each shard has its own lock to reduce lock contention under high connection churn
 class SessionMap : public std::enable_shared_from_this<SessionMap> {
 public:
     friend class SessionHelper;
@@ -34,6 +38,13 @@ public:
     //获取Session  [AUTO-TRANSLATED:08c6e0f2]
     //Get Session
     Session::Ptr get(const std::string &tag);
+
+    /**
+     * 遍历所有Session，回调时不持有任何锁，不会阻塞add/del
+     * 遍历的是各分片的快照，遍历期间新增的Session可能不会被遍历到
+     * Iterate all sessions, no lock is held during the callback, so add/del are not blocked
+     * Iterates a snapshot of each shard, sessions added during iteration may not be visited
+     */
     void for_each_session(const std::function<void(const std::string &id, const Session::Ptr &session)> &cb);
 
 private:
@@ -46,9 +57,27 @@ private:
     //Add Session
     bool add(const std::string &tag, const Session::Ptr &session);
 
+    // 每个分片独占缓存行，避免相邻分片的锁伪共享
+    // 没有使用写时复制的无锁查找：每次连接建立/断开都要复制整个分片，而get()临界区只是一次哈希查找
+    // Each shard owns its cache lines so neighbouring shard locks do not false-share
+    // Copy-on-write lock-free lookup is not used: every connect/disconnect would copy the whole shard, while the critical section of get() is a single hash probe
+    class Shard {
+    public:
+        std::mutex mtx;
+        FlatHashMap<std::string, std::weak_ptr<Session> > map;
+
+        // C++11的new不保证alignas(64)这类扩展对齐，改为在分片之间留出一整个缓存行，无论数组起始地址如何，相邻分片的数据都不会落在同一缓存行
+        // new does not honour extended alignment such as alignas(64) in C++11, so leave a whole cache line between shards instead, whatever the array address is the data of neighbouring shards never shares a cache line
+        char pad[64];
+    };
+
+    Shard &getShard(const std::string &tag);
+
 private:
-    std::mutex _mtx_session;
-    std::unordered_map<std::string, std::weak_ptr<Session> > _map_session;
+    // 分片个数，为2的幂次方
+    // Number of shards, must be a power of 2
+    static constexpr size_t kShardCount = 64;
+    std::array<Shard, kShardCount> _shards;
 };
 
 class Server;
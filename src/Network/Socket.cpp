@@ -271,11 +271,20 @@ bool Socket::attachEvent(const SockNum::Ptr &sock) {
                 strong_self->onAccept(sock, event);
             }
         });
-        return -1 != result;
+        if (result == -1) {
+            return false;
+        }
+        // 及时accept，避免大量连接就绪时新连接被饿死
+        // Accept in time, so new connections are not starved when many connections are ready
+        _poller->setEventPriority(sock->rawFd(), true);
+        return true;
     }
 
     // tcp客户端或udp  [AUTO-TRANSLATED:00c16e7f]
     //TCP client or UDP
+    if (_poller->isKernelBusyPoll()) {
+        SockUtil::setBusyPoll(sock->rawFd(), _poller->getBusyPollUsec());
+    }
     auto read_buffer = _poller->getSharedBuffer(sock->type() == SockNum::Sock_UDP);
     if (sock->type() == SockNum::Sock_UDP) {
         LOCK_GUARD(_mtx_sock_fd);
@@ -309,6 +318,9 @@ bool Socket::attachEvent(const SockNum::Ptr &sock) {
         LOCK_GUARD(_mtx_sock_fd);
         _udp_recv_buffer_frozen = false;
     }
+    if (result != -1 && _high_priority) {
+        _poller->setEventPriority(sock->rawFd(), true);
+    }
     return -1 != result;
 }
 
@@ -419,12 +431,29 @@ ssize_t Socket::send(Buffer::Ptr buf, struct sockaddr *addr, socklen_t addr_len,
     return send_l(std::make_shared<BufferSock>(std::move(buf), addr, addr_len), true, try_flush);
 }
 
+// 全局所有Socket待发送数据的总字节数及其上限
+// Total bytes pending to send of all sockets and its limit
+static std::atomic<size_t> s_total_send_buffer_bytes { 0 };
+static std::atomic<size_t> s_total_send_buffer_limit { 0 };
+
 ssize_t Socket::send_l(Buffer::Ptr buf, bool is_buf_sock, bool try_flush) {
     auto size = buf ? buf->size() : 0;
     if (!size) {
         return 0;
     }
 
+    auto limit = s_total_send_buffer_limit.load(std::memory_order_relaxed);
+    if (limit && _send_buf_bytes.load(std::memory_order_relaxed) && s_total_send_buffer_bytes.load(std::memory_order_relaxed) + size > limit) {
+        // 全局发送缓存超限，丢弃已有数据积压的慢速连接的数据，防止内存耗尽
+        // The global send buffer limit is exceeded, drop data of slow connections that already have a backlog to avoid running out of memory
+        LOCK_GUARD(_mtx_event);
+        if (_send_result) {
+            _send_result(buf, false);
+        }
+        return 0;
+    }
+
+    updateSendBufferBytes(size);
     {
         LOCK_GUARD(_mtx_send_buf_waiting);
         _send_buf_waiting.emplace_back(std::move(buf), is_buf_sock);
@@ -483,15 +512,25 @@ void Socket::closeSock(bool close_fd) {
     _async_con_cb = nullptr;
     _send_flush_ticker.resetTime();
 
+    size_t send_buf_bytes = 0;
+    // 先于清空二级缓存递增，正被flushData转移出的数据由其自行扣除
+    // Increased before clearing the second level cache, data moved out by a running flushData is removed by flushData itself
+    ++_send_buf_epoch;
     {
         LOCK_GUARD(_mtx_send_buf_waiting);
+        _send_buf_waiting.for_each([&](std::pair<Buffer::Ptr, bool> &pr) { send_buf_bytes += pr.first->size(); });
         _send_buf_waiting.clear();
     }
 
     {
         LOCK_GUARD(_mtx_send_buf_sending);
+        _send_buf_sending.for_each([&](BufferList::Ptr &buf) { send_buf_bytes += buf->remainSize(); });
         _send_buf_sending.clear();
     }
+    // 清空缓存不触发水位回调(可能处于析构中)
+    // Clearing the cache does not trigger the watermark callback (may be in destruction)
+    _send_buf_above_high = false;
+    updateSendBufferBytes(-(ssize_t)send_buf_bytes);
 
     {
         LOCK_GUARD(_mtx_sock_fd);
@@ -519,6 +558,76 @@ size_t Socket::getSendBufferCount() {
     return ret;
 }
 
+size_t Socket::getSendBufferBytes() const {
+    return _send_buf_bytes.load(std::memory_order_relaxed);
+}
+
+void Socket::setSendBufferWatermark(size_t high, size_t low, onSendBufferWatermark cb) {
+    LOCK_GUARD(_mtx_event);
+    _send_buf_high_watermark = high;
+    _send_buf_low_watermark = low < high ? low : high;
+    _on_send_buf_watermark = std::move(cb);
+    _send_buf_above_high = false;
+}
+
+size_t Socket::getTotalSendBufferBytes() {
+    return s_total_send_buffer_bytes.load(std::memory_order_relaxed);
+}
+
+void Socket::setTotalSendBufferLimit(size_t bytes) {
+    s_total_send_buffer_limit = bytes;
+}
+
+void Socket::updateSendBufferBytes(ssize_t delta) {
+    if (!delta) {
+        return;
+    }
+    size_t bytes = (_send_buf_bytes += delta);
+    _poller->_send_buffer_bytes += delta;
+    s_total_send_buffer_bytes += delta;
+
+    if (!_send_buf_high_watermark) {
+        return;
+    }
+    if (delta > 0) {
+        if (bytes < _send_buf_high_watermark || _send_buf_above_high.exchange(true)) {
+            return;
+        }
+        // 越过高水位，在发送数据的线程同步回调，便于生产者立即暂停
+        // Crossed the high watermark, callback synchronously in the sending thread so that the producer can pause immediately
+        LOCK_GUARD(_mtx_event);
+        try {
+            if (_on_send_buf_watermark) {
+                _on_send_buf_watermark(true);
+            }
+        } catch (std::exception &ex) {
+            ErrorL << "Exception occurred when emit on_send_buf_watermark: " << ex.what();
+        }
+        return;
+    }
+
+    if (bytes > _send_buf_low_watermark || !_send_buf_above_high.exchange(false)) {
+        return;
+    }
+    // 回落到低水位，此时可能处于flushData中，切换到poller线程回调，防止回调中继续发送数据导致乱序
+    // Fell back to the low watermark, this may happen inside flushData, so callback in the poller thread to prevent sending in the callback from reordering data
+    weak_ptr<Socket> weak_self = shared_from_this();
+    _poller->async([weak_self]() {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return;
+        }
+        LOCK_GUARD(strong_self->_mtx_event);
+        try {
+            if (strong_self->_on_send_buf_watermark) {
+                strong_self->_on_send_buf_watermark(false);
+            }
+        } catch (std::exception &ex) {
+            ErrorL << "Exception occurred when emit on_send_buf_watermark: " << ex.what();
+        }
+    }, false);
+}
+
 uint64_t Socket::elapsedTimeAfterFlushed() {
     return _send_flush_ticker.elapsedTime();
 }
@@ -580,6 +689,11 @@ bool Socket::fromSock_l(SockNum::Ptr sock) {
 void Socket::moveTo(EventPoller::Ptr poller) {
     LOCK_GUARD(_mtx_sock_fd);
     if (poller) {
+        // 待发送字节数统计随socket迁移到新的poller
+        // The pending bytes statistic moves to the new poller together with the socket
+        auto bytes = _send_buf_bytes.load();
+        _poller->_send_buffer_bytes -= bytes;
+        poller->_send_buffer_bytes += bytes;
         _poller = std::move(poller);
     }
     if (_sock_fd) {
@@ -775,7 +889,14 @@ string Socket::getIdentifier() const {
     return class_name + to_string(reinterpret_cast<uint64_t>(this));
 }
 
+static size_t remainSize(List<BufferList::Ptr> &send_buf) {
+    size_t ret = 0;
+    send_buf.for_each([&](BufferList::Ptr &buf) { ret += buf->remainSize(); });
+    return ret;
+}
+
 bool Socket::flushData(const SockNum::Ptr &sock, bool poller_thread) {
+    auto epoch = _send_buf_epoch.load();
     decltype(_send_buf_sending) send_buf_sending_tmp;
     {
         // 转移出二级缓存  [AUTO-TRANSLATED:a54264d2]
@@ -830,6 +951,7 @@ bool Socket::flushData(const SockNum::Ptr &sock, bool poller_thread) {
         auto &packet = send_buf_sending_tmp.front();
         auto n = packet->send(sock->rawFd(), _sock_flags);
         if (n > 0) {
+            updateSendBufferBytes(-n);
             // 全部或部分发送成功  [AUTO-TRANSLATED:0721ed7c]
             //All or part of the data was sent successfully
             if (packet->empty()) {
@@ -867,10 +989,14 @@ bool Socket::flushData(const SockNum::Ptr &sock, bool poller_thread) {
         if (sock->type() == SockNum::Sock_UDP) {
             // udp发送异常，把数据丢弃  [AUTO-TRANSLATED:3a7d095d]
             //UDP send exception, discard the data
+            updateSendBufferBytes(-(ssize_t)packet->remainSize());
             send_buf_sending_tmp.pop_front();
             WarnL << "Send udp socket[" << sock->rawFd() << "] failed, data ignored: " << uv_strerror(err);
             continue;
         }
+        // tcp发送失败时，未发送的数据随之丢弃，从发送缓存统计中扣除
+        // TCP send failed, the unsent data is dropped, remove it from the send buffer statistics
+        updateSendBufferBytes(-(ssize_t)remainSize(send_buf_sending_tmp));
         // tcp发送失败时，触发异常  [AUTO-TRANSLATED:06f06449]
         //TCP send failed, trigger an exception
         emitErr(toSockException(err));
@@ -882,9 +1008,18 @@ bool Socket::flushData(const SockNum::Ptr &sock, bool poller_thread) {
     if (!send_buf_sending_tmp.empty()) {
         // 有剩余数据  [AUTO-TRANSLATED:14a89b15]
         //There is remaining data
-        LOCK_GUARD(_mtx_send_buf_sending);
-        send_buf_sending_tmp.swap(_send_buf_sending);
-        _send_buf_sending.append(send_buf_sending_tmp);
+        {
+            LOCK_GUARD(_mtx_send_buf_sending);
+            if (epoch == _send_buf_epoch.load()) {
+                send_buf_sending_tmp.swap(_send_buf_sending);
+                _send_buf_sending.append(send_buf_sending_tmp);
+            }
+        }
+        if (!send_buf_sending_tmp.empty()) {
+            // 发送期间closeSock已清空发送缓存，剩余数据不再回滚，从统计中扣除
+            // closeSock cleared the send cache meanwhile, the remaining data is not rolled back, remove it from the statistics
+            updateSendBufferBytes(-(ssize_t)remainSize(send_buf_sending_tmp));
+        }
         // 二级缓存未全部发送完毕，说明该socket不可写，直接返回  [AUTO-TRANSLATED:2d7f9f2f]
         //The secondary cache has not been sent completely, indicating that the socket is not writable, return directly
         return true;
@@ -949,6 +1084,14 @@ void Socket::enableRecv(bool enabled) {
     _poller->modifyEvent(rawFD(), read_flag | send_flag | EventPoller::Event_Error);
 }
 
+void Socket::setHighPriority(bool high) {
+    _high_priority = high;
+    auto fd = rawFD();
+    if (fd != -1) {
+        _poller->setEventPriority(fd, high);
+    }
+}
+
 int Socket::rawFD() const {
     LOCK_GUARD(_mtx_sock_fd);
     if (!_sock_fd) {
@@ -336,6 +336,9 @@ public:
     //发送buffer成功与否回调  [AUTO-TRANSLATED:4db5efb8]
     //Send buffer success or failure callback
     using onSendResult = BufferList::SendResult;
+    //发送缓存字节数越过高水位(high为true)或回落到低水位(high为false)回调
+    //Callback when the send buffer bytes cross the high watermark (high is true) or fall back to the low watermark (high is false)
+    using onSendBufferWatermark = toolkit::function_safe<void(bool high)>;
 
     /**
      * 构造socket对象，尚未有实质操作
@@ -571,6 +574,16 @@ public:
      */
     void enableRecv(bool enabled);
 
+    /**
+     * 设置为高优先级socket，事件循环中其事件先于普通socket分发，适用于控制会话等对延时敏感的连接
+     * 监听socket默认即为高优先级
+     * @param high 是否为高优先级
+     * Set as a high priority socket, its events are dispatched before normal sockets in the event loop, suitable for latency-sensitive connections such as control sessions
+     * Listening sockets are high priority by default
+     * @param high Whether it is high priority
+     */
+    void setHighPriority(bool high);
+
     /**
      * 获取裸文件描述符，请勿进行close操作(因为Socket对象会管理其生命周期)
      * @return 文件描述符
@@ -702,6 +715,42 @@ public:
      */
     size_t getSendBufferCount();
 
+    /**
+     * 获取发送缓存(包括一级、二级缓存)中待发送数据的字节数
+     * Get the number of bytes pending in the send buffer (including the first and second level cache)
+     */
+    size_t getSendBufferBytes() const;
+
+    /**
+     * 设置发送缓存高低水位，待发送字节数达到高水位时回调cb(true)，之后回落到低水位时回调cb(false)
+     * 可用于暂停生产者或丢弃非关键帧数据；回调在修改发送缓存的线程中同步触发
+     * @param high 高水位字节数，0代表关闭水位回调
+     * @param low 低水位字节数，应小于高水位
+     * @param cb 水位回调
+     * Set the high/low watermark of the send buffer, cb(true) is called when the pending bytes reach the high watermark, then cb(false) when falling back to the low watermark
+     * Can be used to pause the producer or drop non-key frame data; the callback is triggered synchronously in the thread that modifies the send buffer
+     * @param high High watermark in bytes, 0 disables the watermark callback
+     * @param low Low watermark in bytes, should be less than the high watermark
+     * @param cb Watermark callback
+     */
+    void setSendBufferWatermark(size_t high, size_t low, onSendBufferWatermark cb);
+
+    /**
+     * 获取全局所有Socket发送缓存中待发送数据的总字节数
+     * Get the total bytes pending in the send buffers of all sockets
+     */
+    static size_t getTotalSendBufferBytes();
+
+    /**
+     * 设置全局发送缓存内存上限，0代表不限制
+     * 超过上限后，已有数据积压的socket(慢速连接)新发送的数据将被丢弃(send返回0，并触发发送失败回调)，发送缓存为空的socket不受影响
+     * @param bytes 上限字节数
+     * Set the global memory limit of send buffers, 0 means unlimited
+     * Once exceeded, newly sent data of sockets that already have a backlog (slow connections) is dropped (send returns 0 and the send result callback reports failure), sockets with an empty send buffer are not affected
+     * @param bytes Limit in bytes
+     */
+    static void setTotalSendBufferLimit(size_t bytes);
+
     /**
      * 获取上次socket发送缓存清空至今的毫秒数,单位毫秒
      * Gets the number of milliseconds since the last socket send buffer was cleared, in milliseconds
@@ -765,6 +814,7 @@ private:
     bool flushData(const SockNum::Ptr &sock, bool poller_thread);
     bool attachEvent(const SockNum::Ptr &sock);
     ssize_t send_l(Buffer::Ptr buf, bool is_buf_sock, bool try_flush = true);
+    void updateSendBufferBytes(ssize_t delta);
     void connect_l(const std::string &url, uint16_t port, const onErrCB &con_cb_in, float timeout_sec, const std::string &local_ip, uint16_t local_port);
     bool fromSock_l(SockNum::Ptr sock);
 private:
@@ -786,6 +836,9 @@ private:
     // 是否启用网速统计  [AUTO-TRANSLATED:c0c0e8ee]
     //Whether to enable network speed statistics
     bool _enable_speed = false;
+    // 是否为高优先级socket
+    // Whether it is a high priority socket
+    std::atomic<bool> _high_priority { false };
     // udp发送目标地址  [AUTO-TRANSLATED:cce2315a]
     //UDP send target address
     std::shared_ptr<struct sockaddr_storage> _udp_send_dst;
@@ -851,6 +904,18 @@ private:
     // 发送buffer结果回调  [AUTO-TRANSLATED:1cac46fd]
     //Send buffer result callback
     BufferList::SendResult _send_result;
+    // 一级、二级发送缓存中待发送数据的字节数
+    // Bytes pending to send in the first and second level cache
+    std::atomic<size_t> _send_buf_bytes { 0 };
+    // closeSock清空发送缓存的次数，flushData据此判断转移出的数据是否还应回滚
+    // Times closeSock cleared the send cache, flushData uses it to tell whether the data it moved out should still be rolled back
+    std::atomic<uint64_t> _send_buf_epoch { 0 };
+    // 发送缓存高低水位，高水位为0时不触发回调
+    // High and low watermark of the send buffer, no callback when the high watermark is 0
+    size_t _send_buf_high_watermark = 0;
+    size_t _send_buf_low_watermark = 0;
+    std::atomic<bool> _send_buf_above_high { false };
+    onSendBufferWatermark _on_send_buf_watermark;
     // 对象个数统计  [AUTO-TRANSLATED:f4a012d0]
     //Object count statistics
     ObjectStatistic<Socket> _statistic;
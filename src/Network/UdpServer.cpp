@@ -20,6 +20,9 @@ static const uint8_t s_in6_addr_maped[]
     = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00 };
 
 static constexpr auto kUdpDelayCloseMS = 3 * 1000;
+// 每个poller独享会话表时，每批触发onManager的会话数，批次之间让出poller处理io事件
+// Sessions whose onManager is triggered per slice when each poller owns its session table, the poller is yielded to io events between slices
+static constexpr size_t kManagerSliceSize = 1024;
 
 static UdpServer::PeerIdType makeSockId(sockaddr *addr, int) {
     UdpServer::PeerIdType ret;
@@ -65,7 +68,7 @@ UdpServer::~UdpServer() {
     _timer.reset();
     _socket.reset();
     _cloned_server.clear();
-    if (!_cloned && _session_mutex && _session_map) {
+    if ((!_cloned || _session_per_poller) && _session_mutex && _session_map) {
         lock_guard<std::recursive_mutex> lck(*_session_mutex);
         _session_map->clear();
     }
@@ -77,17 +80,15 @@ void UdpServer::start_l(uint16_t port, const std::string &host) {
     //Only the main server creates a session map, other cloned servers share it
     _session_mutex = std::make_shared<std::recursive_mutex>();
     _session_map = std::make_shared<SessionMapType>();
+    if (_session_per_poller) {
+        _peer_directory = std::make_shared<PeerDirectory>();
+    }
 
     // 新建一个定时器定时管理这些 udp 会话,这些对象只由主server做超时管理，cloned server不管理  [AUTO-TRANSLATED:d20478a2]
     //Create a timer to manage these udp sessions periodically, these objects are only managed by the main server, cloned servers do not manage them
-    std::weak_ptr<UdpServer> weak_self = std::static_pointer_cast<UdpServer>(shared_from_this());
-    _timer = std::make_shared<Timer>(2.0f, [weak_self]() -> bool {
-        if (auto strong_self = weak_self.lock()) {
-            strong_self->onManagerSession();
-            return true;
-        }
-        return false;
-    }, _poller);
+    // (开启setSessionPerPoller时，cloned server各自管理自己的会话)
+    // (When setSessionPerPoller is enabled, each cloned server manages its own sessions)
+    setupTimer();
 
     if (_multi_poller) {
         // clone server至不同线程，让udp server支持多线程  [AUTO-TRANSLATED:15a85c8f]
@@ -128,6 +129,17 @@ void UdpServer::start_l(uint16_t port, const std::string &host) {
     InfoL << "UDP server bind to [" << host << "]: " << port;
 }
 
+void UdpServer::setupTimer() {
+    std::weak_ptr<UdpServer> weak_self = std::static_pointer_cast<UdpServer>(shared_from_this());
+    _timer = std::make_shared<Timer>(2.0f, [weak_self]() -> bool {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->onManagerSession();
+            return true;
+        }
+        return false;
+    }, _poller);
+}
+
 UdpServer::Ptr UdpServer::onCreatServer(const EventPoller::Ptr &poller) {
     return Ptr(new UdpServer(poller), [poller](UdpServer *ptr) { poller->async([ptr]() { delete ptr; }); });
 }
@@ -143,9 +155,19 @@ void UdpServer::cloneFrom(const UdpServer &that) {
     _cloned = true;
     // clone callbacks
     _session_alloc = that._session_alloc;
-    _session_mutex = that._session_mutex;
-    _session_map = that._session_map;
     _multi_poller = that._multi_poller;
+    _session_per_poller = that._session_per_poller;
+    if (_session_per_poller) {
+        // 每个poller独享会话表与超时管理定时器
+        // Each poller owns its session table and timeout management timer
+        _session_mutex = std::make_shared<std::recursive_mutex>();
+        _session_map = std::make_shared<SessionMapType>();
+        _peer_directory = that._peer_directory;
+        setupTimer();
+    } else {
+        _session_mutex = that._session_mutex;
+        _session_map = that._session_map;
+    }
     // clone properties
     this->mINI::operator=(that);
 }
@@ -205,6 +227,27 @@ void UdpServer::onRead_l(bool is_server_fd, const UdpServer::PeerIdType &id, Buf
 }
 
 void UdpServer::onManagerSession() {
+    if (_session_per_poller) {
+        if (_managing) {
+            // 上一轮分批遍历尚未结束
+            // The previous sliced traversal has not finished yet
+            return;
+        }
+        // 持锁时只收集会话的弱引用，不拷贝整个map，也不在锁内回调用户代码，避免createSession与peer目录的未命中路径被onManager阻塞
+        // Only collect weak references of the sessions under the lock, without copying the whole map or calling user code inside it, so createSession and the peer directory miss path are never blocked by onManager
+        auto sessions = std::make_shared<std::vector<std::weak_ptr<SessionHelper> > >();
+        {
+            std::lock_guard<std::recursive_mutex> lock(*_session_mutex);
+            sessions->reserve(_session_map->size());
+            for (auto &pr : *_session_map) {
+                sessions->emplace_back(pr.second);
+            }
+        }
+        _managing = true;
+        manageSessionSlice(std::move(sessions), 0);
+        return;
+    }
+
     decltype(_session_map) copy_map;
     {
         std::lock_guard<std::recursive_mutex> lock(*_session_mutex);
@@ -238,6 +281,51 @@ void UdpServer::onManagerSession() {
     }
 }
 
+static void emitSessionManager(const Session::Ptr &session) {
+    try {
+        session->onManager();
+    } catch (exception &ex) {
+        WarnL << "Exception occurred when emit onManager: " << ex.what();
+    }
+}
+
+void UdpServer::manageSessionSlice(std::shared_ptr<std::vector<std::weak_ptr<SessionHelper> > > sessions, size_t offset) {
+    auto end = (std::min)(sessions->size(), offset + kManagerSliceSize);
+    for (; offset < end; ++offset) {
+        auto helper = (*sessions)[offset].lock();
+        if (!helper || !helper->enable) {
+            // 已移除或延时销毁中
+            // Removed or being destroyed with a delay
+            continue;
+        }
+        auto &session = helper->session();
+        if (!session->getPoller()->isCurrentThread()) {
+            // 自定义socket创建器可能把会话分配到了其他poller，切换到其所在线程处理
+            // A custom socket creator may have placed the session on another poller, switch to its thread
+            std::weak_ptr<Session> weak_session = session;
+            session->async([weak_session]() {
+                if (auto strong_session = weak_session.lock()) {
+                    emitSessionManager(strong_session);
+                }
+            }, false);
+            continue;
+        }
+        emitSessionManager(session);
+    }
+    if (offset == sessions->size()) {
+        _managing = false;
+        return;
+    }
+    // 还有会话未处理，排到poller任务列队末尾继续
+    // Sessions remain, continue at the tail of the poller task queue
+    std::weak_ptr<UdpServer> weak_self = std::static_pointer_cast<UdpServer>(shared_from_this());
+    _poller->async([weak_self, sessions, offset]() {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->manageSessionSlice(sessions, offset);
+        }
+    }, false);
+}
+
 SessionHelper::Ptr UdpServer::getOrCreateSession(const UdpServer::PeerIdType &id, Buffer::Ptr &buf, sockaddr *addr, int addr_len, bool &is_new) {
     {
         //减小临界区  [AUTO-TRANSLATED:3d6089d8]
@@ -248,6 +336,13 @@ SessionHelper::Ptr UdpServer::getOrCreateSession(const UdpServer::PeerIdType &id
             return it->second;
         }
     }
+    if (_peer_directory) {
+        // 该peer的数据落到了本server fd上，但会话可能已在其他poller上创建
+        // The data of this peer landed on this server fd, but its session may already exist on another poller
+        if (auto helper = _peer_directory->find(id)) {
+            return helper;
+        }
+    }
     is_new = true;
     return createSession(id, buf, addr, addr_len);
 }
@@ -255,7 +350,10 @@ SessionHelper::Ptr UdpServer::getOrCreateSession(const UdpServer::PeerIdType &id
 SessionHelper::Ptr UdpServer::createSession(const PeerIdType &id, Buffer::Ptr &buf, struct sockaddr *addr, int addr_len) {
     // 此处改成自定义获取poller对象，防止负载不均衡  [AUTO-TRANSLATED:194e8460]
     //Change to custom acquisition of poller objects to prevent load imbalance
-    auto socket = createSocket(_multi_poller ? EventPollerPool::Instance().getPoller(false) : _poller, buf, addr, addr_len);
+    // 每个poller独享会话表时，会话固定创建在收到首包的poller上，后续由connected udp socket保持在该poller
+    // When each poller owns its session table, the session is created on the poller that received the first packet and kept there by the connected udp socket
+    auto poller = (_multi_poller && !_session_per_poller) ? EventPollerPool::Instance().getPoller(false) : _poller;
+    auto socket = createSocket(poller, buf, addr, addr_len);
     if (!socket) {
         //创建socket失败，本次onRead事件收到的数据直接丢弃  [AUTO-TRANSLATED:b218d68c]
         //Socket creation failed, the data received by this onRead event is discarded
@@ -277,6 +375,15 @@ SessionHelper::Ptr UdpServer::createSession(const PeerIdType &id, Buffer::Ptr &b
         if (it != _session_map->end()) {
             return it->second;
         }
+        std::unique_lock<std::mutex> directory_lck;
+        if (_peer_directory) {
+            // 持有peer目录的分片锁直到会话登记完成，防止多个poller同时为同一peer创建会话
+            // Hold the shard lock of the peer directory until the session is registered, so several pollers never create a session for the same peer
+            directory_lck = _peer_directory->lock(id);
+            if (auto helper = _peer_directory->find_l(id)) {
+                return helper;
+            }
+        }
 
         assert(_socket);
         socket->bindUdpSock(_socket->get_local_port(), _socket->get_local_ip());
@@ -288,24 +395,32 @@ SessionHelper::Ptr UdpServer::createSession(const PeerIdType &id, Buffer::Ptr &b
         helper->session()->attachServer(*this);
 
         std::weak_ptr<SessionHelper> weak_helper = helper;
-        socket->setOnRead([weak_self, weak_helper, id](Buffer::Ptr &buf, struct sockaddr *addr, int addr_len) {
-            auto strong_self = weak_self.lock();
-            if (!strong_self) {
-                return;
-            }
-            auto new_id = makeSockId(addr, addr_len);
-            //快速判断是否为本会话的的数据, 通常应该成立  [AUTO-TRANSLATED:d5d147e4]
-            //Quickly determine if it's data for the current session, usually should be true
-            if (id == new_id) {
-                if (auto strong_helper = weak_helper.lock()) {
-                    emitSessionRecv(strong_helper, buf);
+        // peer fd已bind到同一端口并connect到对端，内核按四元组直接分流，这是已建立会话的主要收包路径
+        // 按recvmmsg批量回调，每批只提升一次会话强引用，无需查询会话表
+        // The peer fd is bound to the same port and connected to the peer, the kernel demultiplexes by 4-tuple, this is the primary receive path for established sessions
+        // Callback per recvmmsg batch, promote the session reference only once per batch, without looking up the session table
+        socket->setOnMultiRead([weak_self, weak_helper, id](Buffer::Ptr *buf, struct sockaddr_storage *addr, size_t count) {
+            auto strong_helper = weak_helper.lock();
+            for (auto i = 0u; i < count; ++i) {
+                auto peer_addr = (struct sockaddr *)(addr + i);
+                auto new_id = makeSockId(peer_addr, sizeof(struct sockaddr_storage));
+                //快速判断是否为本会话的的数据, 通常应该成立  [AUTO-TRANSLATED:d5d147e4]
+                //Quickly determine if it's data for the current session, usually should be true
+                if (id == new_id) {
+                    if (strong_helper) {
+                        emitSessionRecv(strong_helper, buf[i]);
+                    }
+                    continue;
                 }
-                return;
-            }
 
-            //收到非本peer fd的数据，让server去派发此数据到合适的session对象  [AUTO-TRANSLATED:e5f44445]
-            //Received data from a non-current peer fd, let the server dispatch this data to the appropriate session object
-            strong_self->onRead_l(false, new_id, buf, addr, addr_len);
+                // 仅在bind与connect之间的短暂窗口内可能收到其他peer的数据
+                // Data from other peers can only arrive in the short window between bind and connect
+                //收到非本peer fd的数据，让server去派发此数据到合适的session对象  [AUTO-TRANSLATED:e5f44445]
+                //Received data from a non-current peer fd, let the server dispatch this data to the appropriate session object
+                if (auto strong_self = weak_self.lock()) {
+                    strong_self->onRead_l(false, new_id, buf[i], peer_addr, sizeof(struct sockaddr_storage));
+                }
+            }
         });
         socket->setOnErr([weak_self, weak_helper, id](const SockException &err) {
             // 在本函数作用域结束时移除会话对象  [AUTO-TRANSLATED:b2ade305]
@@ -328,6 +443,12 @@ SessionHelper::Ptr UdpServer::createSession(const PeerIdType &id, Buffer::Ptr &b
                         // 从共享map中移除本session对象  [AUTO-TRANSLATED:47ecbf11]
                         //Remove the current session object from the shared map
                         lock_guard<std::recursive_mutex> lck(*strong_self->_session_mutex);
+                        if (strong_self->_peer_directory) {
+                            auto it = strong_self->_session_map->find(id);
+                            if (it != strong_self->_session_map->end()) {
+                                strong_self->_peer_directory->erase(id, it->second.get());
+                            }
+                        }
                         strong_self->_session_map->erase(id);
                     }
                     return 0;
@@ -347,6 +468,9 @@ SessionHelper::Ptr UdpServer::createSession(const PeerIdType &id, Buffer::Ptr &b
 
         auto pr = _session_map->emplace(id, std::move(helper));
         assert(pr.second);
+        if (_peer_directory) {
+            _peer_directory->add_l(id, pr.first->second);
+        }
         return pr.first->second;
     };
 
@@ -389,6 +513,48 @@ void UdpServer::setOnCreateSocket(onCreateSocket cb) {
     }
 }
 
+void UdpServer::setSessionPerPoller(bool enable) {
+    _session_per_poller = enable;
+}
+
+UdpServer::PeerDirectory::Shard &UdpServer::PeerDirectory::getShard(const PeerIdType &id) {
+    return _shards[PeerIdHash()(id) & (kShardCount - 1)];
+}
+
+std::unique_lock<std::mutex> UdpServer::PeerDirectory::lock(const PeerIdType &id) {
+    return std::unique_lock<std::mutex>(getShard(id).mtx);
+}
+
+SessionHelper::Ptr UdpServer::PeerDirectory::find_l(const PeerIdType &id) {
+    auto &shard = getShard(id);
+    auto it = shard.map.find(id);
+    return it == shard.map.end() ? nullptr : it->second.lock();
+}
+
+SessionHelper::Ptr UdpServer::PeerDirectory::find(const PeerIdType &id) {
+    auto lck = lock(id);
+    return find_l(id);
+}
+
+void UdpServer::PeerDirectory::add_l(const PeerIdType &id, const SessionHelper::Ptr &helper) {
+    // 可能覆盖已失效的旧记录
+    // May overwrite an expired old record
+    getShard(id).map[id] = helper;
+}
+
+void UdpServer::PeerDirectory::erase(const PeerIdType &id, const SessionHelper *helper) {
+    auto &shard = getShard(id);
+    lock_guard<mutex> lck(shard.mtx);
+    auto it = shard.map.find(id);
+    if (it == shard.map.end()) {
+        return;
+    }
+    auto registered = it->second.lock();
+    if (!registered || registered.get() == helper) {
+        shard.map.erase(it);
+    }
+}
+
 uint16_t UdpServer::getPort() {
     if (!_socket) {
         return 0;
@@ -97,6 +97,22 @@ public:
      */
     void setOnCreateSocket(onCreateSocket cb);
 
+    /**
+     * @brief 设置是否每个poller独立管理自己的会话表，需在start前调用
+     * 开启后cloned server不再共享主server的session map与锁，会话在收到首包的poller上创建；
+     * 依赖SO_REUSEPORT按四元组哈希以及connected udp socket的内核分流，使同一peer通常落在同一poller；
+     * 在peer socket的bind与connect之间或reuseport分组变化时，数据可能落到其他server fd上，此时通过各server共享的peer目录找到已有会话并切换线程派发，不会重复创建会话；
+     * 会话超时由各poller管理自己的会话表：持锁只收集会话引用，释放锁后分批触发onManager，批次之间让出poller
+     * @param enable 是否开启
+     * @brief Set whether each poller manages its own session table, must be called before start
+     * When enabled, cloned servers no longer share the session map and lock of the main server, sessions are created on the poller that received the first packet;
+     * Relies on SO_REUSEPORT 4-tuple hashing and kernel demultiplexing of connected udp sockets to normally keep a peer on the same poller;
+     * Between bind and connect of the peer socket, or when the reuseport group changes, data may land on another server fd, the peer directory shared by all servers then finds the existing session and dispatches across threads, so no duplicate session is created;
+     * Session timeouts are handled by each poller for its own session table: only the session references are collected under the lock, onManager is triggered in slices after releasing it, yielding the poller between slices
+     * @param enable Whether to enable
+     */
+    void setSessionPerPoller(bool enable);
+
 protected:
     virtual Ptr onCreatServer(const EventPoller::Ptr &poller);
     virtual void cloneFrom(const UdpServer &that);
@@ -109,7 +125,49 @@ private:
         size_t operator()(const PeerIdType &v) const noexcept { return std::hash<std::string> {}(v); }
 #endif
     };
-    using SessionMapType = std::unordered_map<PeerIdType, SessionHelper::Ptr, PeerIdHash>;
+    // 开放寻址扁平哈希表，避免每个peer一次节点分配以及每个包查找时的指针跳转
+    // Open addressing flat hash map, avoiding a node allocation per peer and pointer chasing on every packet lookup
+    using SessionMapType = FlatHashMap<PeerIdType, SessionHelper::Ptr, PeerIdHash>;
+
+    /**
+     * 开启setSessionPerPoller后所有server共享的peer目录，按peer分片加锁，只在本地会话表未命中时访问
+     * Peer directory shared by all servers when setSessionPerPoller is enabled, locked per peer shard, only accessed when the local session table misses
+     */
+    class PeerDirectory {
+    public:
+        SessionHelper::Ptr find(const PeerIdType &id);
+
+        /**
+         * 锁定peer所在分片，持锁期间使用find_l/add_l，用于查找与创建会话的原子化
+         * Lock the shard of the peer, use find_l/add_l while holding it, so lookup and session creation are atomic
+         */
+        std::unique_lock<std::mutex> lock(const PeerIdType &id);
+        SessionHelper::Ptr find_l(const PeerIdType &id);
+        void add_l(const PeerIdType &id, const SessionHelper::Ptr &helper);
+
+        /**
+         * 仅当登记的仍是该会话时移除
+         * Only remove it if the registered session is still this one
+         */
+        void erase(const PeerIdType &id, const SessionHelper *helper);
+
+    private:
+        class Shard {
+        public:
+            std::mutex mtx;
+            FlatHashMap<PeerIdType, std::weak_ptr<SessionHelper>, PeerIdHash> map;
+
+            // 与SessionMap的分片相同，以一整个缓存行的填充代替C++11下不可靠的alignas(64)
+            // Same as the SessionMap shards, a whole cache line of padding replaces alignas(64) which is unreliable with new in C++11
+            char pad[64];
+        };
+
+        Shard &getShard(const PeerIdType &id);
+
+    private:
+        static constexpr size_t kShardCount = 16;
+        std::array<Shard, kShardCount> _shards;
+    };
 
     /**
      * @brief 开始udp server
@@ -131,6 +189,12 @@ private:
      */
     void onManagerSession();
 
+    /**
+     * 对收集到的会话从offset开始触发一批onManager，未处理完时投递到poller继续
+     * Trigger onManager for one slice of the collected sessions starting at offset, posting the rest to the poller when not finished
+     */
+    void manageSessionSlice(std::shared_ptr<std::vector<std::weak_ptr<SessionHelper> > > sessions, size_t offset);
+
     void onRead(Buffer::Ptr &buf, struct sockaddr *addr, int addr_len);
 
     /**
@@ -176,17 +240,27 @@ private:
     Socket::Ptr createSocket(const EventPoller::Ptr &poller, const Buffer::Ptr &buf = nullptr, struct sockaddr *addr = nullptr, int addr_len = 0);
 
     void setupEvent();
+    void setupTimer();
 
 private:
     bool _cloned = false;
     bool _multi_poller;
+    bool _session_per_poller = false;
+    //开启setSessionPerPoller后，是否正在分批触发会话的onManager
+    //Whether onManager of the sessions is being triggered in slices when setSessionPerPoller is enabled
+    bool _managing = false;
     Socket::Ptr _socket;
     std::shared_ptr<Timer> _timer;
     onCreateSocket _on_create_socket;
     //cloned server共享主server的session map，防止数据在不同server间漂移  [AUTO-TRANSLATED:9a149e52]
     //Cloned server shares the session map with the main server, preventing data drift between different servers
+    //开启setSessionPerPoller后，每个server独享自己的session map
+    //When setSessionPerPoller is enabled, each server owns its own session map
     std::shared_ptr<std::recursive_mutex> _session_mutex;
     std::shared_ptr<SessionMapType> _session_map;
+    //开启setSessionPerPoller后，主server与cloned server共享的peer目录
+    //Peer directory shared by the main server and cloned servers when setSessionPerPoller is enabled
+    std::shared_ptr<PeerDirectory> _peer_directory;
     //主server持有cloned server的引用  [AUTO-TRANSLATED:04a6403a]
     //Main server holds a reference to the cloned server
     std::unordered_map<EventPoller *, Ptr> _cloned_server;
@@ -169,6 +169,18 @@ int SockUtil::setNoDelay(int fd, bool on) {
     return ret;
 }
 
+int SockUtil::setBusyPoll(int fd, int usec) {
+#if defined(SO_BUSY_POLL)
+    int ret = setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, (char *) &usec, static_cast<socklen_t>(sizeof(usec)));
+    if (ret == -1) {
+        TraceL << "setsockopt SO_BUSY_POLL failed";
+    }
+    return ret;
+#else
+    return -1;
+#endif
+}
+
 int SockUtil::setReuseable(int fd, bool on, bool reuse_port) {
     int opt = on ? 1 : 0;
     int ret = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (char *) &opt, static_cast<socklen_t>(sizeof(opt)));
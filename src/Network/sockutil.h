@@ -178,6 +178,20 @@ public:
      */
     static int setNoSigpipe(int fd);
 
+    /**
+     * 设置SO_BUSY_POLL，阻塞读时内核在网卡队列上忙轮询指定微秒，仅Linux有效
+     * 超过net.core.busy_read的值需要CAP_NET_ADMIN权限
+     * @param fd socket fd号
+     * @param usec 忙轮询时长(微秒)
+     * @return 0代表成功，-1为失败
+     * Set SO_BUSY_POLL, the kernel busy polls the NIC queue for the given microseconds on blocking reads, Linux only
+     * Values larger than net.core.busy_read require the CAP_NET_ADMIN capability
+     * @param fd socket fd number
+     * @param usec Busy poll time (microseconds)
+     * @return 0 represents success, -1 represents failure
+     */
+    static int setBusyPoll(int fd, int usec);
+
     /**
      * 设置读写socket是否阻塞
      * @param fd socket fd号
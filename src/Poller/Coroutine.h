@@ -0,0 +1,402 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_COROUTINE_H
+#define ZLTOOLKIT_COROUTINE_H
+
+/**
+ * 可选的C++20协程层，仅当使用方以C++20(支持协程)编译时生效，库本身仍以C++11编译
+ * 协程默认惰性启动，通过coSpawn在指定EventPoller上运行，或在其他协程中co_await
+ * Optional C++20 coroutine layer, only enabled when the user compiles with C++20 (coroutine support), the library itself is still built with C++11
+ * Coroutines start lazily, they run on a given EventPoller via coSpawn, or are co_awaited by other coroutines
+ */
+#if defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include "EventPoller.h"
+
+namespace toolkit {
+
+/**
+ * 协程帧内存池，按64字节分档缓存已释放的协程帧
+ * 缓存为线程局部的(并非按poller管理)：协程帧释放到执行释放的线程的缓存中，例如通过co_await poller切换过线程的协程，其帧会归还到结束时所在线程
+ * Coroutine frame pool, freed frames are cached in 64 bytes size classes
+ * The cache is thread local (not managed per poller): a frame is returned to the cache of the thread that frees it, for example the frame of a coroutine that switched threads with co_await poller goes to the thread it finished on
+ */
+class CoFramePool {
+public:
+    static void *allocate(size_t size) {
+        auto index = sizeClass(size);
+        if (index < kClassCount) {
+            auto &cache = getCache();
+            if (auto node = cache.heads[index]) {
+                cache.heads[index] = node->next;
+                --cache.counts[index];
+                return node;
+            }
+            return ::operator new((index + 1) * kAlign);
+        }
+        return ::operator new(size);
+    }
+
+    static void deallocate(void *ptr, size_t size) {
+        auto index = sizeClass(size);
+        if (index < kClassCount) {
+            auto &cache = getCache();
+            if (cache.counts[index] < kMaxCached) {
+                auto node = static_cast<Node *>(ptr);
+                node->next = cache.heads[index];
+                cache.heads[index] = node;
+                ++cache.counts[index];
+                return;
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+private:
+    static constexpr size_t kAlign = 64;
+    static constexpr size_t kClassCount = 32;
+    static constexpr size_t kMaxCached = 256;
+
+    struct Node {
+        Node *next;
+    };
+
+    struct Cache {
+        Node *heads[kClassCount] = {};
+        size_t counts[kClassCount] = {};
+
+        ~Cache() {
+            for (auto head : heads) {
+                while (head) {
+                    auto next = head->next;
+                    ::operator delete(head);
+                    head = next;
+                }
+            }
+        }
+    };
+
+    static size_t sizeClass(size_t size) { return (size + kAlign - 1) / kAlign - 1; }
+
+    static Cache &getCache() {
+        static thread_local Cache s_cache;
+        return s_cache;
+    }
+};
+
+template <typename T = void>
+class CoTask;
+
+namespace co_detail {
+
+class PromiseBase {
+public:
+    static void *operator new(size_t size) { return CoFramePool::allocate(size); }
+    static void operator delete(void *ptr, size_t size) { CoFramePool::deallocate(ptr, size); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            // 执行完毕后直接切换回等待者(对称转移)，不经过任务列队
+            // Transfer straight back to the awaiter when done (symmetric transfer), without going through the task queue
+            auto continuation = handle.promise()._continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { _exception = std::current_exception(); }
+
+    void rethrowIfNeed() {
+        if (_exception) {
+            std::rethrow_exception(_exception);
+        }
+    }
+
+    std::coroutine_handle<> _continuation;
+    std::exception_ptr _exception;
+};
+
+template <typename T>
+class Promise : public PromiseBase {
+public:
+    CoTask<T> get_return_object();
+
+    template <typename U>
+    void return_value(U &&value) { _value.emplace(std::forward<U>(value)); }
+
+    T result() {
+        rethrowIfNeed();
+        return std::move(*_value);
+    }
+
+private:
+    std::optional<T> _value;
+};
+
+template <>
+class Promise<void> : public PromiseBase {
+public:
+    CoTask<void> get_return_object();
+
+    void return_void() {}
+
+    void result() { rethrowIfNeed(); }
+};
+
+} // namespace co_detail
+
+/**
+ * 协程任务，返回值类型为T，惰性启动，只可移动
+ * 被co_await时才开始执行，执行完毕后恢复等待者；异常会传递给等待者
+ * Coroutine task with result type T, lazily started and move-only
+ * It starts running when co_awaited and resumes the awaiter when done; exceptions are propagated to the awaiter
+ */
+template <typename T>
+class CoTask {
+public:
+    using promise_type = co_detail::Promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    CoTask() = default;
+    explicit CoTask(handle_type handle) : _handle(handle) {}
+    CoTask(CoTask &&that) noexcept : _handle(std::exchange(that._handle, nullptr)) {}
+
+    CoTask &operator=(CoTask &&that) noexcept {
+        if (this != &that) {
+            destroy();
+            _handle = std::exchange(that._handle, nullptr);
+        }
+        return *this;
+    }
+
+    CoTask(const CoTask &) = delete;
+    CoTask &operator=(const CoTask &) = delete;
+
+    ~CoTask() { destroy(); }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            handle_type handle;
+
+            bool await_ready() noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+                handle.promise()._continuation = awaiter;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().result(); }
+        };
+        return Awaiter { _handle };
+    }
+
+private:
+    void destroy() {
+        if (_handle) {
+            _handle.destroy();
+            _handle = nullptr;
+        }
+    }
+
+private:
+    handle_type _handle;
+};
+
+template <typename T>
+CoTask<T> co_detail::Promise<T>::get_return_object() {
+    return CoTask<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline CoTask<void> co_detail::Promise<void>::get_return_object() {
+    return CoTask<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+namespace co_detail {
+
+/**
+ * 挂起中的协程句柄，用于投递到poller中的异步恢复
+ * 等待对象随协程帧一同析构时调用cancel()，之后已投递的恢复任务不再恢复该协程；同一句柄最多被恢复一次
+ * Handle of a suspended coroutine, used for resumes posted to a poller
+ * The awaiter calls cancel() when it is destroyed together with the coroutine frame, afterwards a posted resume no longer resumes the coroutine; a handle is resumed at most once
+ */
+class ResumeToken {
+public:
+    using Ptr = std::shared_ptr<ResumeToken>;
+
+    explicit ResumeToken(std::coroutine_handle<> handle) : _handle(handle) {}
+
+    void resume() {
+        if (auto handle = _handle.exchange(nullptr)) {
+            handle.resume();
+        }
+    }
+
+    void cancel() { _handle = nullptr; }
+
+private:
+    std::atomic<std::coroutine_handle<>> _handle;
+};
+
+/**
+ * 等待对象的恢复令牌持有者，析构时取消尚未执行的恢复
+ * Owner of the resume token of an awaiter, cancels the pending resume when destroyed
+ */
+class ResumeGuard {
+public:
+    ResumeGuard() = default;
+    ResumeGuard(ResumeGuard &&that) noexcept : _token(std::move(that._token)) {}
+    ResumeGuard(const ResumeGuard &) = delete;
+    ResumeGuard &operator=(const ResumeGuard &) = delete;
+
+    ~ResumeGuard() {
+        if (_token) {
+            _token->cancel();
+        }
+    }
+
+    const ResumeToken::Ptr &arm(std::coroutine_handle<> handle) {
+        _token = std::make_shared<ResumeToken>(handle);
+        return _token;
+    }
+
+private:
+    ResumeToken::Ptr _token;
+};
+
+inline void postResume(const EventPoller::Ptr &poller, ResumeToken::Ptr token) {
+    poller->post([token]() { token->resume(); }, false);
+}
+
+} // namespace co_detail
+
+/**
+ * 切换到指定poller线程执行，已在该线程时不挂起；也可直接co_await poller
+ * Switch to the given poller thread, no suspension if already in that thread; co_await poller directly also works
+ */
+class CoSwitch {
+public:
+    explicit CoSwitch(EventPoller::Ptr poller) : _poller(std::move(poller)) {}
+
+    bool await_ready() const { return _poller->isCurrentThread(); }
+    void await_suspend(std::coroutine_handle<> handle) { co_detail::postResume(_poller, _guard.arm(handle)); }
+    void await_resume() const {}
+
+private:
+    EventPoller::Ptr _poller;
+    co_detail::ResumeGuard _guard;
+};
+
+inline CoSwitch operator co_await(const EventPoller::Ptr &poller) {
+    return CoSwitch(poller);
+}
+
+/**
+ * 让出执行权，待poller处理完其他任务后再继续
+ * Yield, continue after the poller has handled other tasks
+ */
+class CoYield {
+public:
+    explicit CoYield(EventPoller::Ptr poller) : _poller(std::move(poller)) {}
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { co_detail::postResume(_poller, _guard.arm(handle)); }
+    void await_resume() const {}
+
+private:
+    EventPoller::Ptr _poller;
+    co_detail::ResumeGuard _guard;
+};
+
+/**
+ * 休眠指定毫秒后在poller线程中继续
+ * Sleep for the given milliseconds and then continue in the poller thread
+ */
+class CoSleep {
+public:
+    CoSleep(EventPoller::Ptr poller, uint64_t delay_ms) : _delay_ms(delay_ms), _poller(std::move(poller)) {}
+
+    bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        auto token = _guard.arm(handle);
+        _poller->doDelayTask(_delay_ms, [token]() {
+            token->resume();
+            return 0;
+        });
+    }
+
+    void await_resume() const {}
+
+private:
+    uint64_t _delay_ms;
+    EventPoller::Ptr _poller;
+    co_detail::ResumeGuard _guard;
+};
+
+inline CoYield coYield(EventPoller::Ptr poller) {
+    return CoYield(std::move(poller));
+}
+
+inline CoSleep coSleep(EventPoller::Ptr poller, uint64_t delay_ms) {
+    return CoSleep(std::move(poller), delay_ms);
+}
+
+namespace co_detail {
+
+class Detached {
+public:
+    class promise_type : public PromiseBase {
+    public:
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() {}
+    };
+};
+
+inline Detached runDetached(CoTask<void> task) {
+    try {
+        co_await std::move(task);
+    } catch (std::exception &ex) {
+        WarnL << "Uncaught exception in coroutine: " << ex.what();
+    }
+}
+
+} // namespace co_detail
+
+/**
+ * 在poller线程中启动协程，协程结束后自动销毁，未捕获的异常会被打印
+ * 协程挂起期间poller被销毁时，该协程帧不会再被恢复
+ * Start a coroutine in the poller thread, it is destroyed automatically when done, uncaught exceptions are logged
+ * If the poller is destroyed while the coroutine is suspended, the coroutine frame will never be resumed
+ */
+inline void coSpawn(const EventPoller::Ptr &poller, CoTask<void> task) {
+    poller->post([task = std::move(task)]() mutable { co_detail::runDetached(std::move(task)); });
+}
+
+} // namespace toolkit
+
+#endif // defined(__cpp_impl_coroutine)
+#endif // ZLTOOLKIT_COROUTINE_H
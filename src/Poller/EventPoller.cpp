@@ -8,12 +8,14 @@
  * may be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <chrono>
 #include "SelectWrap.h"
 #include "EventPoller.h"
 #include "Util/util.h"
 #include "Util/uv_errno.h"
 #include "Util/TimeTicker.h"
 #include "Util/NoticeCenter.h"
+#include "Util/CpuTopology.h"
 #include "Network/sockutil.h"
 
 #if defined(HAS_EPOLL)
@@ -25,6 +27,21 @@
 
 #define EPOLL_SIZE 1024
 
+#if defined(__linux__) || defined(__linux)
+#include <sys/ioctl.h>
+// epoll忙轮询参数，Linux 6.9起支持，旧版本头文件中没有定义
+// epoll busy poll parameters, supported since Linux 6.9, not defined in older headers
+#if !defined(EPIOCSPARAMS)
+struct epoll_params {
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t __pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+#endif
+
 //防止epoll惊群  [AUTO-TRANSLATED:ad53c775]
 //Prevent epoll thundering
 #ifndef EPOLLEXCLUSIVE
@@ -64,14 +81,14 @@ EventPoller &EventPoller::Instance() {
 }
 
 void EventPoller::addEventPipe() {
-    SockUtil::setNoBlocked(_pipe.readFD());
-    SockUtil::setNoBlocked(_pipe.writeFD());
-
     // 添加内部管道事件  [AUTO-TRANSLATED:6a72e39a]
     //Add internal pipe event
-    if (addEvent(_pipe.readFD(), EventPoller::Event_Read, [this](int event) { onPipeEvent(); }) == -1) {
+    if (addEvent(_wakeup.readFD(), EventPoller::Event_Read, [this](int event) { onPipeEvent(); }) == -1) {
         throw std::runtime_error("Add pipe fd to poller failed");
     }
+    // 异步任务优先于普通io事件执行
+    // Async tasks run before normal io events
+    _event_priority.emplace(_wakeup.readFD());
 }
 
 EventPoller::EventPoller(std::string name) {
@@ -185,6 +202,7 @@ int EventPoller::delEvent(int fd, PollCompleteCB cb) {
     }
 
     if (isCurrentThread()) {
+        _event_priority.erase(fd);
 #if defined(HAS_EPOLL)
         int ret = -1;
         if (_event_map.erase(fd)) {
@@ -283,18 +301,31 @@ Task::Ptr EventPoller::async_l(TaskIn task, bool may_sync, bool first) {
     }
 
     auto ret = std::make_shared<Task>(std::move(task));
+    post_l([ret]() { (*ret)(); }, first);
+    return ret;
+}
+
+void EventPoller::post(InlineTask task, bool may_sync) {
+    if (may_sync && isCurrentThread()) {
+        task();
+        return;
+    }
+    post_l(std::move(task), false);
+}
+
+void EventPoller::post_l(InlineTask task, bool first) {
+    auto now = LatencyHistogram::now();
     {
         lock_guard<mutex> lck(_mtx_task);
         if (first) {
-            _list_task.emplace_front(ret);
+            _list_task_first.emplace_back(QueuedTask { std::move(task), now });
         } else {
-            _list_task.emplace_back(ret);
+            _list_task.emplace_back(QueuedTask { std::move(task), now });
         }
     }
     //写数据到管道,唤醒主线程  [AUTO-TRANSLATED:2ead8182]
     //Write data to the pipe and wake up the main thread
-    _pipe.write("", 1);
-    return ret;
+    _wakeup.wakeup();
 }
 
 bool EventPoller::isCurrentThread() {
@@ -302,44 +333,145 @@ bool EventPoller::isCurrentThread() {
 }
 
 inline void EventPoller::onPipeEvent(bool flush) {
-    char buf[1024];
-    int err = 0;
-    if (!flush) {
-       for (;;) {
-         if ((err = _pipe.read(buf, sizeof(buf))) > 0) {
-             // 读到管道数据,继续读,直到读空为止  [AUTO-TRANSLATED:47bd325c]
-             //Read data from the pipe, continue reading until it's empty
-             continue;
-         }
-         if (err == 0 || get_uv_error(true) != UV_EAGAIN) {
-             // 收到eof或非EAGAIN(无更多数据)错误,说明管道无效了,重新打开管道  [AUTO-TRANSLATED:5f7a013d]
-             //Received eof or non-EAGAIN (no more data) error, indicating that the pipe is invalid, reopen the pipe
-             ErrorL << "Invalid pipe fd of event poller, reopen it";
-             delEvent(_pipe.readFD());
-             _pipe.reOpen();
-             addEventPipe();
-         }
-         break;
-      }
-    }
-
-    decltype(_list_task) _list_swap;
-    {
-        lock_guard<mutex> lck(_mtx_task);
-        _list_swap.swap(_list_task);
+    if (!flush && !_wakeup.drain()) {
+        // 收到eof或非EAGAIN(无更多数据)错误,说明管道无效了,重新打开管道  [AUTO-TRANSLATED:5f7a013d]
+        //Received eof or non-EAGAIN (no more data) error, indicating that the pipe is invalid, reopen the pipe
+        ErrorL << "Invalid pipe fd of event poller, reopen it";
+        delEvent(_wakeup.readFD());
+        _wakeup.reOpen();
+        addEventPipe();
     }
 
-    _list_swap.for_each([&](const Task::Ptr &task) {
+    auto start = LatencyHistogram::now();
+    uint64_t max_wait = 0;
+    auto run = [&](QueuedTask &queued) {
+        auto wait = start > queued.post_ns ? start - queued.post_ns : 0;
+        _latency[Latency_TaskWait].record(wait);
+        if (wait > max_wait) {
+            max_wait = wait;
+        }
         try {
-            (*task)();
+            queued.task();
         } catch (ExitException &) {
             _exit_flag = true;
         } catch (std::exception &ex) {
             ErrorL << "Exception occurred when do async task: " << ex.what();
         }
+        auto end = LatencyHistogram::now();
+        _latency[Latency_TaskExec].record(end - start);
+        start = end;
+    };
+    auto clear = [&]() {
+        // 保留少量内存供下次复用，突发大量任务后释放多余内存
+        // Keep a small amount of memory for reuse, release the excess after a burst of tasks
+        static constexpr size_t kMaxReserve = 1024;
+        _list_swap.clear();
+        _list_swap_first.clear();
+        _swap_pos = 0;
+        if (_list_swap.capacity() > kMaxReserve) {
+            decltype(_list_swap)().swap(_list_swap);
+        }
+        if (_list_swap_first.capacity() > kMaxReserve) {
+            decltype(_list_swap_first)().swap(_list_swap_first);
+        }
+    };
+
+    size_t budget = flush ? 0 : _task_budget.load(std::memory_order_relaxed);
+    size_t count = 0;
+    bool swapped = false;
+    while (true) {
+        if (!_swap_first_left && _swap_pos == _list_swap.size()) {
+            // 上一批任务已全部执行，交换出新的任务；每次最多交换一次，避免任务不断投递新任务时饿死io
+            // 先执行完顺延的任务后也需要交换一次，因为drain之后投递的任务可能没有产生新的唤醒
+            // The previous batch has been fully run, swap out the new tasks; swap at most once per call so tasks posting new tasks cannot starve io
+            // Also swap once after finishing the deferred tasks, since tasks posted after drain may not have made a new wakeup
+            clear();
+            if (swapped) {
+                break;
+            }
+            swapped = true;
+            {
+                lock_guard<mutex> lck(_mtx_task);
+                _list_swap.swap(_list_task);
+                _list_swap_first.swap(_list_task_first);
+            }
+            _swap_first_left = _list_swap_first.size();
+            if (!_swap_first_left && _list_swap.empty()) {
+                break;
+            }
+        }
+
+        while (_swap_first_left && (!budget || count < budget)) {
+            run(_list_swap_first[--_swap_first_left]);
+            ++count;
+        }
+        while (_swap_pos < _list_swap.size() && (!budget || count < budget)) {
+            run(_list_swap[_swap_pos++]);
+            ++count;
+        }
+
+        if (_swap_first_left || _swap_pos < _list_swap.size()) {
+            // 预算用尽，剩余任务顺延到下一轮，并确保下一轮不会休眠
+            // The budget ran out, the rest are deferred to the next round, and make sure the next round does not sleep
+            _stat_task_deferred.fetch_add(1, std::memory_order_relaxed);
+            _wakeup.wakeup();
+            break;
+        }
+    }
+    _stat_task_count.fetch_add(count, std::memory_order_relaxed);
+    if (max_wait / 1000 > _stat_task_max_delay.load(std::memory_order_relaxed)) {
+        _stat_task_max_delay.store(max_wait / 1000, std::memory_order_relaxed);
+    }
+}
+
+void EventPoller::setDispatchBudget(size_t io_budget, size_t task_budget) {
+    _io_budget = io_budget;
+    _task_budget = task_budget;
+}
+
+void EventPoller::setEventPriority(int fd, bool high) {
+    async([this, fd, high]() {
+        if (!high) {
+            _event_priority.erase(fd);
+        } else if (_event_map.count(fd)) {
+            _event_priority.emplace(fd);
+        }
     });
 }
 
+LatencyHistogram::Snapshot EventPoller::getLatency(LatencyType type, bool reset) {
+    return _latency[type].snapshot(reset);
+}
+
+const char *EventPoller::getLatencyName(LatencyType type) {
+    switch (type) {
+        case Latency_LoopBusy: return "loop busy";
+        case Latency_TaskWait: return "task wait";
+        case Latency_TaskExec: return "task exec";
+        case Latency_EventExec: return "event exec";
+        case Latency_TimerLate: return "timer late";
+        default: return "unknown";
+    }
+}
+
+EventPoller::DispatchStatistic EventPoller::getDispatchStatistic(bool reset) {
+    DispatchStatistic ret;
+    if (reset) {
+        ret.io_events = _stat_io_events.exchange(0);
+        ret.io_yield = _stat_io_yield.exchange(0);
+        ret.task_deferred = _stat_task_deferred.exchange(0);
+        ret.task_count = _stat_task_count.exchange(0);
+        ret.task_max_delay_usec = _stat_task_max_delay.exchange(0);
+    } else {
+        ret.io_events = _stat_io_events;
+        ret.io_yield = _stat_io_yield;
+        ret.task_deferred = _stat_task_deferred;
+        ret.task_count = _stat_task_count;
+        ret.task_max_delay_usec = _stat_task_max_delay;
+    }
+    return ret;
+}
+
 SocketRecvBuffer::Ptr EventPoller::getSharedBuffer(bool is_udp) {
 #if !defined(__linux) && !defined(__linux__)
     // 非Linux平台下，tcp和udp共享recvfrom方案，使用同一个buffer  [AUTO-TRANSLATED:2d2ee7bf]
@@ -362,6 +494,10 @@ const std::string& EventPoller::getThreadName() const {
     return _name;
 }
 
+size_t EventPoller::getSendBufferBytes() const {
+    return _send_buffer_bytes.load(std::memory_order_relaxed);
+}
+
 static thread_local std::weak_ptr<EventPoller> s_current_poller;
 
 // static
@@ -369,6 +505,103 @@ EventPoller::Ptr EventPoller::getCurrentPoller() {
     return s_current_poller.lock();
 }
 
+void EventPoller::setBusyPoll(uint32_t spin_usec, bool kernel_busy_poll) {
+    if (spin_usec && thread::hardware_concurrency() <= 1) {
+        // 单核下自旋会占用其他线程唤醒本线程所需的cpu
+        // On a single core, spinning takes the cpu that other threads need to wake this one up
+        WarnL << "Busy poll on a single core machine only adds latency";
+    }
+    _busy_poll_usec = spin_usec;
+    _kernel_busy_poll = spin_usec && kernel_busy_poll;
+#if defined(HAS_EPOLL) && (defined(__linux__) || defined(__linux))
+    struct epoll_params params;
+    memset(&params, 0, sizeof(params));
+    if (_kernel_busy_poll) {
+        params.busy_poll_usecs = spin_usec;
+        params.busy_poll_budget = 8;
+        params.prefer_busy_poll = 1;
+    }
+    if (ioctl(_event_fd, EPIOCSPARAMS, &params) == -1 && _kernel_busy_poll) {
+        WarnL << "Enable epoll busy poll failed: " << get_uv_errmsg();
+    }
+#endif
+}
+
+template <typename FUNC>
+int EventPoller::busyPoll(int64_t min_delay, FUNC &&poll) {
+    uint64_t spin_usec = _busy_poll_usec.load(std::memory_order_relaxed);
+    if (!spin_usec || min_delay == 0) {
+        return 0;
+    }
+    if (min_delay > 0 && spin_usec > (uint64_t)min_delay * 1000) {
+        // 不超过最近的延时任务
+        // Do not exceed the nearest delayed task
+        spin_usec = (uint64_t)min_delay * 1000;
+    }
+    int ret;
+    uint64_t spent;
+    auto start = std::chrono::steady_clock::now();
+    do {
+        ret = poll();
+        spent = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    } while (ret == 0 && spent < spin_usec);
+    onSpin(ret != 0, spent);
+    return ret;
+}
+
+template <typename EVENT, typename GET_FD, typename DISPATCH>
+void EventPoller::dispatchEvents(EVENT *events, int count, GET_FD &&get_fd, DISPATCH &&dispatch) {
+    if (!_event_priority.empty()) {
+        // 高优先级fd的事件移到最前面
+        // Move events of high priority fds to the front
+        int front = 0;
+        for (int i = 0; i < count; ++i) {
+            if (_event_priority.count((int)get_fd(events[i]))) {
+                if (i != front) {
+                    std::swap(events[i], events[front]);
+                }
+                ++front;
+            }
+        }
+    }
+
+    size_t budget = _io_budget.load(std::memory_order_relaxed);
+    auto start = LatencyHistogram::now();
+    for (int i = 0; i < count; ++i) {
+        dispatch(events[i]);
+        auto end = LatencyHistogram::now();
+        _latency[Latency_EventExec].record(end - start);
+        start = end;
+        if (budget && (i + 1) % budget == 0 && i + 1 < count) {
+            // 本批预算用尽，先处理到期的定时器与异步任务
+            // The budget of this batch ran out, handle due timers and async tasks first
+            onDispatchYield();
+            start = LatencyHistogram::now();
+        }
+    }
+    _stat_io_events.fetch_add(count, std::memory_order_relaxed);
+}
+
+void EventPoller::onLoopSleep() {
+    if (_wake_ns) {
+        _latency[Latency_LoopBusy].record(LatencyHistogram::now() - _wake_ns);
+    }
+    startSleep();
+}
+
+void EventPoller::onLoopWakeUp() {
+    sleepWakeUp();
+    _wake_ns = LatencyHistogram::now();
+}
+
+void EventPoller::onDispatchYield() {
+    _stat_io_yield.fetch_add(1, std::memory_order_relaxed);
+    getMinDelay();
+    if (_wakeup.isPending()) {
+        onPipeEvent();
+    }
+}
+
 void EventPoller::runLoop(bool blocked, bool ref_self) {
     if (blocked) {
         if (ref_self) {
@@ -381,9 +614,12 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
         struct epoll_event events[EPOLL_SIZE];
         while (!_exit_flag) {
             minDelay = getMinDelay();
-            startSleep(); // 用于统计当前线程负载情况
-            int ret = epoll_wait(_event_fd, events, EPOLL_SIZE, minDelay);
-            sleepWakeUp(); // 用于统计当前线程负载情况
+            onLoopSleep(); // 用于统计当前线程负载情况
+            int ret = busyPoll(minDelay, [&]() { return epoll_wait(_event_fd, events, EPOLL_SIZE, 0); });
+            if (ret == 0) {
+                ret = epoll_wait(_event_fd, events, EPOLL_SIZE, minDelay);
+            }
+            onLoopWakeUp(); // 用于统计当前线程负载情况
             if (ret <= 0) {
                 // 超时或被打断  [AUTO-TRANSLATED:7005fded]
                 // Timed out or interrupted
@@ -392,18 +628,17 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
 
             _event_cache_expired.clear();
 
-            for (int i = 0; i < ret; ++i) {
-                struct epoll_event &ev = events[i];
+            dispatchEvents(events, ret, [](const struct epoll_event &ev) { return ev.data.fd; }, [&](struct epoll_event &ev) {
                 int fd = ev.data.fd;
                 if (_event_cache_expired.count(fd)) {
                     // event cache refresh
-                    continue;
+                    return;
                 }
 
                 auto it = _event_map.find(fd);
                 if (it == _event_map.end()) {
                     epoll_ctl(_event_fd, EPOLL_CTL_DEL, fd, nullptr);
-                    continue;
+                    return;
                 }
                 auto cb = it->second;
                 try {
@@ -411,7 +646,7 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
                 } catch (std::exception &ex) {
                     ErrorL << "Exception occurred when do event task: " << ex.what();
                 }
-            }
+            });
         }
 #elif defined(HAS_KQUEUE)
         struct kevent kevents[KEVENT_SIZE];
@@ -419,28 +654,33 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
             minDelay = getMinDelay();
             struct timespec timeout = { (long)minDelay / 1000, (long)minDelay % 1000 * 1000000 };
 
-            startSleep();
-            int ret = kevent(_event_fd, nullptr, 0, kevents, KEVENT_SIZE, minDelay == -1 ? nullptr : &timeout);
-            sleepWakeUp();
+            onLoopSleep();
+            int ret = busyPoll(minDelay, [&]() {
+                struct timespec zero = { 0, 0 };
+                return kevent(_event_fd, nullptr, 0, kevents, KEVENT_SIZE, &zero);
+            });
+            if (ret == 0) {
+                ret = kevent(_event_fd, nullptr, 0, kevents, KEVENT_SIZE, minDelay == -1 ? nullptr : &timeout);
+            }
+            onLoopWakeUp();
             if (ret <= 0) {
                 continue;
             }
 
             _event_cache_expired.clear();
 
-            for (int i = 0; i < ret; ++i) {
-                auto &kev = kevents[i];
+            dispatchEvents(kevents, ret, [](const struct kevent &kev) { return kev.ident; }, [&](struct kevent &kev) {
                 auto fd = kev.ident;
                 if (_event_cache_expired.count(fd)) {
                     // event cache refresh
-                    continue;
+                    return;
                 }
 
                 auto it = _event_map.find(fd);
                 if (it == _event_map.end()) {
                     EV_SET(&kev, fd, kev.filter, EV_DELETE, 0, 0, nullptr);
                     kevent(_event_fd, &kev, 1, nullptr, 0, nullptr);
-                    continue;
+                    return;
                 }
                 auto cb = it->second;
                 int event = 0;
@@ -455,7 +695,7 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
                 } catch (std::exception &ex) {
                     ErrorL << "Exception occurred when do event task: " << ex.what();
                 }
-            }
+            });
         }
 #else
         int ret, max_fd;
@@ -488,9 +728,9 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
                 }
             }
 
-            startSleep(); // 用于统计当前线程负载情况
+            onLoopSleep(); // 用于统计当前线程负载情况
             ret = zl_select(max_fd + 1, &set_read, &set_write, &set_err, minDelay == -1 ? nullptr : &tv);
-            sleepWakeUp(); // 用于统计当前线程负载情况
+            onLoopWakeUp(); // 用于统计当前线程负载情况
 
             if (ret <= 0) {
                 // 超时或被打断  [AUTO-TRANSLATED:7005fded]
@@ -543,10 +783,13 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
 int64_t EventPoller::flushDelayTask(uint64_t now_time) {
     decltype(_delay_task_map) task_copy;
     task_copy.swap(_delay_task_map);
+    auto now_usec = getCurrentMicrosecond();
 
     for (auto it = task_copy.begin(); it != task_copy.end() && it->first <= now_time; it = task_copy.erase(it)) {
         //已到期的任务  [AUTO-TRANSLATED:849cdc29]
         //Expired tasks
+        auto deadline_usec = it->first * 1000;
+        _latency[Latency_TimerLate].record(now_usec > deadline_usec ? (now_usec - deadline_usec) * 1000 : 0);
         try {
             auto next_delay = (*(it->second))();
             if (next_delay) {
@@ -607,6 +850,8 @@ EventPoller::DelayTask::Ptr EventPoller::doDelayTask(uint64_t delay_ms, function
 
 static size_t s_pool_size = 0;
 static bool s_enable_cpu_affinity = true;
+static bool s_enable_numa_aware = false;
+static string s_nic_irq_affinity;
 
 INSTANCE_IMP(EventPollerPool)
 
@@ -626,10 +871,46 @@ void EventPollerPool::preferCurrentThread(bool flag) {
     _prefer_current_thread = flag;
 }
 
+LatencyHistogram::Snapshot EventPollerPool::getLatency(EventPoller::LatencyType type, bool reset) {
+    LatencyHistogram::Snapshot ret;
+    for_each([&](const TaskExecutor::Ptr &executor) {
+        ret.merge(static_pointer_cast<EventPoller>(executor)->getLatency(type, reset));
+    });
+    return ret;
+}
+
+void EventPollerPool::setLatencyDump(uint64_t interval_ms) {
+    if (_latency_dump_task) {
+        _latency_dump_task->cancel();
+        _latency_dump_task = nullptr;
+    }
+    if (!interval_ms) {
+        return;
+    }
+    _latency_dump_task = getFirstPoller()->doDelayTask(interval_ms, [this, interval_ms]() -> uint64_t {
+        for_each([](const TaskExecutor::Ptr &executor) {
+            auto poller = static_pointer_cast<EventPoller>(executor);
+            for (int type = 0; type < EventPoller::Latency_Max; ++type) {
+                auto snap = poller->getLatency((EventPoller::LatencyType)type, true);
+                if (snap.count()) {
+                    InfoL << poller->getThreadName() << " " << EventPoller::getLatencyName((EventPoller::LatencyType)type) << ": " << snap.toString();
+                }
+            }
+        });
+        return interval_ms;
+    });
+}
+
 const std::string EventPollerPool::kOnStarted = "kBroadcastEventPollerPoolStarted";
 
 EventPollerPool::EventPollerPool() {
-    auto size = addPoller("event poller", s_pool_size, ThreadPool::PRIORITY_HIGHEST, true, s_enable_cpu_affinity);
+    vector<int> cpus;
+    if (s_enable_cpu_affinity && (s_enable_numa_aware || !s_nic_irq_affinity.empty())) {
+        auto size = s_pool_size ? s_pool_size : thread::hardware_concurrency();
+        cpus = CpuTopology::Instance().getPlacement(size, s_enable_numa_aware, s_nic_irq_affinity);
+    }
+    NumaMemoryPool::enable(s_enable_cpu_affinity && s_enable_numa_aware);
+    auto size = addPoller("event poller", s_pool_size, ThreadPool::PRIORITY_HIGHEST, true, s_enable_cpu_affinity, cpus);
     NOTICE_EMIT(EventPollerPoolOnStartedArgs, kOnStarted, *this, size);
     InfoL << "EventPoller created size: " << size;
 }
@@ -642,5 +923,13 @@ void EventPollerPool::enableCpuAffinity(bool enable) {
     s_enable_cpu_affinity = enable;
 }
 
+void EventPollerPool::enableNumaAware(bool enable) {
+    s_enable_numa_aware = enable;
+}
+
+void EventPollerPool::setNicIrqAffinity(const std::string &ifname) {
+    s_nic_irq_affinity = ifname;
+}
+
 }  // namespace toolkit
 
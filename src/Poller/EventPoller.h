@@ -11,16 +11,19 @@
 #ifndef EventPoller_h
 #define EventPoller_h
 
+#include <atomic>
 #include <mutex>
 #include <thread>
 #include <string>
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 #include <unordered_set>
-#include "PipeWrap.h"
+#include "EventWakeup.h"
 #include "Util/logger.h"
 #include "Util/List.h"
+#include "Util/LatencyHistogram.h"
 #include "Thread/TaskExecutor.h"
 #include "Thread/ThreadPool.h"
 #include "Network/Buffer.h"
@@ -49,6 +52,7 @@ namespace toolkit {
 class EventPoller : public TaskExecutor, public AnyStorage, public std::enable_shared_from_this<EventPoller> {
 public:
     friend class TaskExecutorGetterImp;
+    friend class Socket;
 
     using Ptr = std::shared_ptr<EventPoller>;
     using PollEventCB = std::function<void(int event)>;
@@ -62,6 +66,15 @@ public:
         Event_LT = 1 << 3, // 水平触发
     } Poll_Event;
 
+    typedef enum {
+        Latency_LoopBusy = 0, // 每轮事件循环从唤醒到再次休眠的耗时，即新事件最多需要等待的时长
+        Latency_TaskWait, // 异步任务从投递到开始执行的等待时长
+        Latency_TaskExec, // 异步任务的执行耗时
+        Latency_EventExec, // io事件回调的执行耗时
+        Latency_TimerLate, // 定时任务实际执行时间相对截止时间的延迟
+        Latency_Max
+    } LatencyType;
+
     ~EventPoller();
 
     /**
@@ -150,6 +163,110 @@ public:
      */
     Task::Ptr async_first(TaskIn task, bool may_sync = true) override;
 
+    /**
+     * 快速投递不可取消的任务，不创建Task对象，小任务全程无堆内存分配
+     * @param task 任务
+     * @param may_sync 如果调用该函数的线程就是本对象的轮询线程，那么may_sync为true时就是同步执行任务
+     * Quickly post a non-cancelable task without creating a Task object, small tasks need no heap allocation at all
+     * @param task The task to execute
+     * @param may_sync If the calling thread is the polling thread of this object,
+     *                  then if may_sync is true, the task will be executed synchronously
+     */
+    void post(InlineTask task, bool may_sync = true) override;
+
+    /**
+     * 设置忙轮询模式，适用于低延时场景，可在任意线程调用
+     * 开启后每次休眠前先以非阻塞方式轮询spin_usec微秒，期间有事件则不进入休眠，省去休眠唤醒的开销，代价是cpu占用
+     * 自旋与休眠的统计见getSpinStatistic()
+     * @param spin_usec 每次休眠前自旋的时长(微秒)，0为关闭
+     * @param kernel_busy_poll 是否同时开启内核忙轮询(epoll的EPIOCSPARAMS与之后创建的socket的SO_BUSY_POLL)，需要较新的内核及CAP_NET_ADMIN权限
+     * Set busy poll mode for latency-critical scenarios, can be called from any thread
+     * When enabled, before each sleep the poller polls non-blockingly for spin_usec microseconds, and does not sleep if events arrive meanwhile, saving the sleep/wake cost at the price of cpu usage
+     * See getSpinStatistic() for spin and sleep statistics
+     * @param spin_usec Spin time before each sleep (microseconds), 0 to disable
+     * @param kernel_busy_poll Whether to also enable kernel busy poll (EPIOCSPARAMS of epoll and SO_BUSY_POLL of sockets created afterwards), requires a recent kernel and CAP_NET_ADMIN
+     */
+    void setBusyPoll(uint32_t spin_usec, bool kernel_busy_poll = false);
+
+    uint32_t getBusyPollUsec() const { return _busy_poll_usec; }
+    bool isKernelBusyPoll() const { return _kernel_busy_poll; }
+
+    /**
+     * 事件分发统计，用于观察过载时异步任务与io事件是否被饿死
+     * Dispatch statistics, used to observe whether async tasks and io events are starved under overload
+     */
+    struct DispatchStatistic {
+        // 已分发的io事件数
+        // Number of io events dispatched
+        uint64_t io_events = 0;
+        // io事件因预算用尽而中断、插入执行异步任务与定时器的次数
+        // Times the io dispatch was interrupted by the budget to run async tasks and timers
+        uint64_t io_yield = 0;
+        // 异步任务因预算用尽而顺延到下一轮的次数
+        // Times async tasks were deferred to the next round because the budget ran out
+        uint64_t task_deferred = 0;
+        // 已执行的异步任务数
+        // Number of async tasks executed
+        uint64_t task_count = 0;
+        // 异步任务从投递到开始执行的最大等待时长(微秒)
+        // Max wait from posting an async task until it starts running (microseconds)
+        uint64_t task_max_delay_usec = 0;
+    };
+
+    /**
+     * 设置每轮事件循环的分发预算，可在任意线程调用
+     * 每分发io_budget个io事件后插入执行到期的定时器与已投递的异步任务，每次最多执行task_budget个异步任务，剩余的顺延到下一轮
+     * 从而在大量socket同时就绪或大量任务积压时，避免某一类工作长时间饿死另一类
+     * @param io_budget 每批分发的io事件数，0为不限制
+     * @param task_budget 每批执行的异步任务数，0为不限制
+     * Set the dispatch budget of each event loop iteration, can be called from any thread
+     * Due timers and posted async tasks are run after every io_budget io events, at most task_budget async tasks are run at a time and the rest are deferred to the next round
+     * So when many sockets are ready at once or many tasks are backlogged, one kind of work cannot starve the other for long
+     * @param io_budget Io events dispatched per batch, 0 for unlimited
+     * @param task_budget Async tasks run per batch, 0 for unlimited
+     */
+    void setDispatchBudget(size_t io_budget, size_t task_budget);
+
+    /**
+     * 标记fd为高优先级，每轮事件循环中其事件先于其他fd分发，适用于监听socket与控制会话
+     * 内部唤醒事件(异步任务)默认为高优先级，fd被delEvent后标记自动清除，可在任意线程调用
+     * Mark the fd as high priority, its events are dispatched before other fds in each loop iteration, suitable for listening sockets and control sessions
+     * The internal wakeup event (async tasks) is high priority by default, the mark is cleared automatically by delEvent, can be called from any thread
+     */
+    void setEventPriority(int fd, bool high);
+
+    /**
+     * 获取事件分发统计
+     * @param reset 获取后是否清零
+     * Get the dispatch statistics
+     * @param reset Whether to reset them after reading
+     */
+    DispatchStatistic getDispatchStatistic(bool reset = false);
+
+    /**
+     * 获取延时直方图快照，用于定位尾延时来自哪个poller以及哪个环节
+     * @param type 统计类型
+     * @param reset 获取后是否清零
+     * Get a snapshot of a latency histogram, used to attribute tail latency to a poller and a stage
+     * @param type Statistic type
+     * @param reset Whether to reset after reading
+     */
+    LatencyHistogram::Snapshot getLatency(LatencyType type, bool reset = false);
+
+    static const char *getLatencyName(LatencyType type);
+
+    /**
+     * 获取轮询线程绑定的cpu，未绑定时返回-1
+     * Get the cpu the polling thread is bound to, -1 if not bound
+     */
+    int getCpu() const { return _cpu; }
+
+    /**
+     * 获取轮询线程所在的NUMA节点，未绑定cpu时返回-1
+     * Get the NUMA node of the polling thread, -1 if no cpu is bound
+     */
+    int getNumaNode() const { return _numa_node; }
+
     /**
      * 判断执行该接口的线程是否为本对象的轮询线程
      * @return 是否为本对象的轮询线程
@@ -202,6 +319,12 @@ public:
      */
     const std::string &getThreadName() const;
 
+    /**
+     * 获取本poller下所有Socket发送缓存中待发送数据的总字节数
+     * Get the total bytes pending in the send buffers of all sockets on this poller
+     */
+    size_t getSendBufferBytes() const;
+
 private:
     /**
      * 本对象只允许在EventPollerPool中构造
@@ -243,6 +366,12 @@ private:
      */
     Task::Ptr async_l(TaskIn task, bool may_sync = true, bool first = false);
 
+    /**
+     * 把任务加入任务列队并唤醒轮询线程
+     * Add the task to the task queue and wake up the polling thread
+     */
+    void post_l(InlineTask task, bool first);
+
     /**
      * 结束事件轮询
      * 需要指出的是，一旦结束就不能再次恢复轮询线程
@@ -266,6 +395,43 @@ private:
      */
     int64_t getMinDelay();
 
+    /**
+     * 忙轮询，在休眠前以非阻塞方式调用poll自旋
+     * @return poll的返回值，0代表未开启忙轮询或自旋期间没有事件
+     * Busy poll, spin calling poll non-blockingly before sleeping
+     * @return The return value of poll, 0 means busy poll is disabled or no events arrived while spinning
+     */
+    template <typename FUNC>
+    int busyPoll(int64_t min_delay, FUNC &&poll);
+
+    /**
+     * 按预算分发一轮io事件，高优先级fd先分发，每批之间插入执行定时器与异步任务
+     * @param events 事件数组，高优先级fd的事件会被移到前面
+     * @param count 事件个数
+     * @param get_fd 获取事件的fd
+     * @param dispatch 分发事件
+     * Dispatch one round of io events within the budget, high priority fds first, timers and async tasks run between batches
+     * @param events Event array, events of high priority fds are moved to the front
+     * @param count Number of events
+     * @param get_fd Get the fd of an event
+     * @param dispatch Dispatch an event
+     */
+    template <typename EVENT, typename GET_FD, typename DISPATCH>
+    void dispatchEvents(EVENT *events, int count, GET_FD &&get_fd, DISPATCH &&dispatch);
+
+    /**
+     * 在io事件批次之间执行到期的定时器与已投递的异步任务
+     * Run due timers and posted async tasks between io event batches
+     */
+    void onDispatchYield();
+
+    /**
+     * 进入休眠前与被唤醒后调用，用于统计负载与每轮循环耗时
+     * Called before sleeping and after waking up, used to count the load and the busy time of each loop
+     */
+    void onLoopSleep();
+    void onLoopWakeUp();
+
     /**
      * 添加管道监听事件
      * Add pipe listening event
@@ -276,6 +442,13 @@ private:
 private:
     class ExitException : public std::exception {};
 
+    // 列队中的任务及其投递时间
+    // A queued task and the time it was posted
+    struct QueuedTask {
+        InlineTask task;
+        uint64_t post_ns;
+    };
+
 private:
     // 标记loop线程是否退出  [AUTO-TRANSLATED:98250f84]
     // 标记loop线程是否退出
@@ -283,6 +456,14 @@ private:
     bool _exit_flag;
     // 统计监听了多少个fd
     size_t _fd_count = 0;
+    // 轮询线程绑定的cpu与所在NUMA节点
+    // The cpu the polling thread is bound to and its NUMA node
+    int _cpu = -1;
+    int _numa_node = -1;
+    // 忙轮询自旋时长(微秒)与是否开启内核忙轮询
+    // Busy poll spin time (microseconds) and whether kernel busy poll is enabled
+    std::atomic<uint32_t> _busy_poll_usec { 0 };
+    std::atomic<bool> _kernel_busy_poll { false };
     // 线程名  [AUTO-TRANSLATED:f1d62d9f]
     // 线程名
     // Thread name
@@ -291,6 +472,9 @@ private:
     // 当前线程下，所有socket共享的读缓存
     // Shared read buffer for all sockets under the current thread
     std::weak_ptr<SocketRecvBuffer> _shared_buffer[2];
+    // 本poller下所有Socket待发送数据的总字节数，由Socket维护
+    // Total bytes pending to send of all sockets on this poller, maintained by Socket
+    std::atomic<size_t> _send_buffer_bytes { 0 };
     // 执行事件循环的线程  [AUTO-TRANSLATED:2465cc75]
     // 执行事件循环的线程
     // Thread that executes the event loop
@@ -300,15 +484,40 @@ private:
     // Notify the event loop thread that it has started
     semaphore _sem_run_started;
 
-    // 内部事件管道  [AUTO-TRANSLATED:dc1d3a93]
-    // 内部事件管道
-    // Internal event pipe
-    PipeWrap _pipe;
+    // 内部唤醒事件(Linux下为eventfd)，多次async()在被处理前只唤醒一次
+    // Internal wakeup event (eventfd on Linux), multiple async() calls only wake up once before being handled
+    EventWakeup _wakeup;
     // 从其他线程切换过来的任务  [AUTO-TRANSLATED:d16917d6]
     // 从其他线程切换过来的任务
     // Tasks switched from other threads
     std::mutex _mtx_task;
-    List<Task::Ptr> _list_task;
+    std::vector<QueuedTask> _list_task;
+    // async_first切换过来的任务，倒序执行且先于_list_task
+    // Tasks switched by async_first, executed in reverse order and before _list_task
+    std::vector<QueuedTask> _list_task_first;
+    // 轮询线程交换任务列队用，复用其内存避免每次分配
+    // Used by the polling thread to swap the task queues, their memory is reused to avoid allocating every time
+    std::vector<QueuedTask> _list_swap;
+    std::vector<QueuedTask> _list_swap_first;
+    // 交换出来但因预算用尽尚未执行的任务位置
+    // Positions of swapped tasks not yet run because the budget ran out
+    size_t _swap_first_left = 0;
+    size_t _swap_pos = 0;
+
+    // 分发预算与统计
+    // Dispatch budget and statistics
+    std::atomic<size_t> _io_budget { 128 };
+    std::atomic<size_t> _task_budget { 1024 };
+    std::atomic<uint64_t> _stat_io_events { 0 };
+    std::atomic<uint64_t> _stat_io_yield { 0 };
+    std::atomic<uint64_t> _stat_task_deferred { 0 };
+    std::atomic<uint64_t> _stat_task_count { 0 };
+    std::atomic<uint64_t> _stat_task_max_delay { 0 };
+
+    // 延时直方图与本轮循环被唤醒的时间
+    // Latency histograms and the time this loop iteration woke up
+    LatencyHistogram _latency[Latency_Max];
+    uint64_t _wake_ns = 0;
 
     // 保持日志可用  [AUTO-TRANSLATED:4a6c2438]
     // 保持日志可用
@@ -335,6 +544,9 @@ private:
     std::unordered_map<int, Poll_Record::Ptr> _event_map;
 #endif // HAS_EPOLL
     std::unordered_set<int> _event_cache_expired;
+    // 高优先级的fd
+    // High priority fds
+    std::unordered_set<int> _event_priority;
 
     // 定时器相关  [AUTO-TRANSLATED:fa2e84da]
     // Timer related
@@ -376,6 +588,24 @@ public:
      */
     static void enableCpuAffinity(bool enable);
 
+    /**
+     * 开启NUMA感知，在EventPollerPool单例创建前有效，需同时开启cpu亲和性
+     * 开启后EventPoller在各NUMA节点间均匀分布，BufferRaw从poller所在节点的内存池分配
+     * Enable NUMA awareness, effective before the EventPollerPool singleton is created, cpu affinity must also be enabled
+     * When enabled, EventPollers are spread evenly over NUMA nodes and BufferRaw is allocated from the memory pool of the poller's node
+     */
+    static void enableNumaAware(bool enable);
+
+    /**
+     * 使EventPoller绑定到网卡RX队列中断所在的cpu上，在EventPollerPool单例创建前有效
+     * 收包中断与处理线程位于同一cpu可减少跨核/跨节点访问，网卡中断数少于poller数时其余poller按默认方式分配
+     * @param ifname 网卡名，例如eth0，为空则不按网卡中断分配
+     * Bind EventPollers to the cpus of the NIC RX queue IRQs, effective before the EventPollerPool singleton is created
+     * Having the receive IRQ and the processing thread on the same cpu reduces cross-core/cross-node access, if there are fewer IRQs than pollers the rest are assigned as usual
+     * @param ifname NIC name, such as eth0, empty to disable
+     */
+    static void setNicIrqAffinity(const std::string &ifname);
+
     /**
      * 获取第一个实例
      * @return
@@ -411,11 +641,30 @@ public:
      */
     void preferCurrentThread(bool flag = true);
 
+    /**
+     * 合并所有EventPoller的延时直方图
+     * @param type 统计类型
+     * @param reset 获取后是否清零
+     * Merge the latency histograms of all EventPollers
+     * @param type Statistic type
+     * @param reset Whether to reset after reading
+     */
+    LatencyHistogram::Snapshot getLatency(EventPoller::LatencyType type, bool reset = false);
+
+    /**
+     * 定时把每个EventPoller的延时直方图打印到日志并清零
+     * @param interval_ms 打印间隔(毫秒)，0为关闭
+     * Periodically log the latency histograms of every EventPoller and reset them
+     * @param interval_ms Dump interval (milliseconds), 0 to disable
+     */
+    void setLatencyDump(uint64_t interval_ms);
+
 private:
     EventPollerPool();
 
 private:
     bool _prefer_current_thread = true;
+    EventPoller::DelayTask::Ptr _latency_dump_task;
 };
 
 } // namespace toolkit
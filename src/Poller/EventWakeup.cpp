@@ -0,0 +1,119 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <stdexcept>
+#include "EventWakeup.h"
+#include "Util/util.h"
+#include "Util/uv_errno.h"
+#include "Network/sockutil.h"
+
+#if defined(__linux__) || defined(__linux)
+#include <sys/eventfd.h>
+#endif
+
+using namespace std;
+
+namespace toolkit {
+
+EventWakeup::EventWakeup() {
+    reOpen();
+}
+
+EventWakeup::~EventWakeup() {
+    clearFD();
+}
+
+#if defined(__linux__) || defined(__linux)
+
+void EventWakeup::reOpen() {
+    clearFD();
+    _event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_event_fd == -1) {
+        throw runtime_error(StrPrinter << "Create eventfd failed: " << get_uv_errmsg());
+    }
+    _pending = false;
+}
+
+void EventWakeup::clearFD() {
+    if (_event_fd != -1) {
+        close(_event_fd);
+        _event_fd = -1;
+    }
+}
+
+int EventWakeup::readFD() const {
+    return _event_fd;
+}
+
+bool EventWakeup::wakeup() {
+    if (_pending.exchange(true)) {
+        // 接收方还未drain，之前的唤醒已能覆盖本次
+        // The receiver has not drained yet, the previous wakeup covers this one
+        return false;
+    }
+    uint64_t one = 1;
+    int ret;
+    do {
+        ret = (int)::write(_event_fd, &one, sizeof(one));
+    } while (-1 == ret && UV_EINTR == get_uv_error(true));
+    return true;
+}
+
+bool EventWakeup::drain() {
+    uint64_t count;
+    int ret;
+    do {
+        ret = (int)::read(_event_fd, &count, sizeof(count));
+    } while (-1 == ret && UV_EINTR == get_uv_error(true));
+    // 先读空计数器再清除标记，清除后的唤醒一定会产生新的可读事件
+    // Read the counter first and then clear the flag, any wakeup after clearing makes a new readable event
+    _pending = false;
+    return ret == sizeof(count) || (ret == -1 && get_uv_error(true) == UV_EAGAIN);
+}
+
+#else
+
+void EventWakeup::reOpen() {
+    _pipe.reOpen();
+    SockUtil::setNoBlocked(_pipe.readFD());
+    SockUtil::setNoBlocked(_pipe.writeFD());
+    _pending = false;
+}
+
+void EventWakeup::clearFD() {}
+
+int EventWakeup::readFD() const {
+    return _pipe.readFD();
+}
+
+bool EventWakeup::wakeup() {
+    if (_pending.exchange(true)) {
+        return false;
+    }
+    _pipe.write("", 1);
+    return true;
+}
+
+bool EventWakeup::drain() {
+    char buf[1024];
+    int err;
+    while ((err = _pipe.read(buf, sizeof(buf))) > 0) {
+        // 读到管道数据,继续读,直到读空为止
+        // Read data from the pipe, continue reading until it's empty
+    }
+    _pending = false;
+    // 收到eof或非EAGAIN(无更多数据)错误,说明管道无效了
+    // Received eof or non-EAGAIN (no more data) error, indicating that the pipe is invalid
+    return err != 0 && get_uv_error(true) == UV_EAGAIN;
+}
+
+#endif // defined(__linux__) || defined(__linux)
+
+} /* namespace toolkit */
@@ -0,0 +1,79 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef EventWakeup_h
+#define EventWakeup_h
+
+#include <atomic>
+#include "PipeWrap.h"
+
+namespace toolkit {
+
+/**
+ * 跨线程唤醒原语，只传递"有事件"这一信号，不传递数据
+ * Linux下基于eventfd实现，只占用一个fd；其他平台退化为PipeWrap
+ * 唤醒会被合并：在接收方调用drain()之前，多次wakeup()只会产生一次系统调用
+ * 使用方式：把readFD()加入EventPoller读事件监听，触发后先调用drain()再处理待办事项
+ * Cross-thread wakeup primitive, it only carries the signal "something happened", not data
+ * On Linux it is based on eventfd and uses a single fd; other platforms fall back to PipeWrap
+ * Wakeups are coalesced: before the receiver calls drain(), multiple wakeup() calls only make one system call
+ * Usage: add readFD() to the read events of an EventPoller, when triggered call drain() first and then handle pending work
+ */
+class EventWakeup {
+public:
+    EventWakeup();
+    ~EventWakeup();
+
+    /**
+     * 唤醒接收方，可在任意线程调用
+     * @return 是否真正执行了系统调用(false表示与之前的唤醒合并了)
+     * Wake up the receiver, can be called from any thread
+     * @return Whether a system call was really made (false means it was coalesced with a previous wakeup)
+     */
+    bool wakeup();
+
+    /**
+     * 清除唤醒状态，接收方在处理待办事项之前调用
+     * @return 成功返回true，返回false说明fd已失效，需要reOpen()
+     * Clear the wakeup state, called by the receiver before handling pending work
+     * @return true on success, false means the fd is invalid and reOpen() is required
+     */
+    bool drain();
+
+    /**
+     * 是否有尚未被drain的唤醒
+     * Whether there is a wakeup not drained yet
+     */
+    bool isPending() const { return _pending.load(std::memory_order_relaxed); }
+
+    /**
+     * 用于加入事件监听的fd
+     * The fd to be added to event polling
+     */
+    int readFD() const;
+
+    void reOpen();
+
+private:
+    void clearFD();
+
+private:
+    // 是否已有未被drain的唤醒
+    // Whether there is a wakeup not drained yet
+    std::atomic<bool> _pending { false };
+#if defined(__linux__) || defined(__linux)
+    int _event_fd = -1;
+#else
+    PipeWrap _pipe;
+#endif
+};
+
+} /* namespace toolkit */
+#endif // !EventWakeup_h
@@ -0,0 +1,154 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_INLINEFUNCTION_H
+#define ZLTOOLKIT_INLINEFUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+
+namespace toolkit {
+
+template <typename Sig, size_t InlineSize = 96>
+class InlineFunction;
+
+/**
+ * 只可移动的函数对象，不超过InlineSize字节的可调用对象直接保存在对象内部，不分配堆内存
+ * 超出大小或移动构造可能抛异常的可调用对象退化为堆上保存
+ * 与std::function相比：不要求可拷贝(可捕获unique_ptr等)，小对象构造与移动无内存分配
+ * Move-only function object, callables no larger than InlineSize bytes are stored inside the object without heap allocation
+ * Callables that are larger, or whose move constructor may throw, fall back to heap storage
+ * Compared with std::function: copying is not required (unique_ptr etc. can be captured), constructing and moving small objects allocates no memory
+ */
+template <typename R, typename... Args, size_t InlineSize>
+class InlineFunction<R(Args...), InlineSize> {
+public:
+    InlineFunction() = default;
+    InlineFunction(std::nullptr_t) {}
+
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+    InlineFunction(F &&f) {
+        if (!isNull(static_cast<const typename std::decay<F>::type &>(f))) {
+            init<typename std::decay<F>::type>(std::forward<F>(f), std::integral_constant<bool, isInline<typename std::decay<F>::type>()>());
+        }
+    }
+
+    InlineFunction(InlineFunction &&that) noexcept { moveFrom(that); }
+
+    InlineFunction &operator=(InlineFunction &&that) noexcept {
+        if (this != &that) {
+            reset();
+            moveFrom(that);
+        }
+        return *this;
+    }
+
+    InlineFunction &operator=(std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    InlineFunction(const InlineFunction &) = delete;
+    InlineFunction &operator=(const InlineFunction &) = delete;
+
+    ~InlineFunction() { reset(); }
+
+    explicit operator bool() const { return _ops != nullptr; }
+
+    R operator()(Args... args) const {
+        if (!_ops) {
+            throw std::bad_function_call();
+        }
+        return _ops->invoke(const_cast<void *>(static_cast<const void *>(&_storage)), std::forward<Args>(args)...);
+    }
+
+    void reset() {
+        if (_ops) {
+            _ops->destroy(&_storage);
+            _ops = nullptr;
+        }
+    }
+
+    /**
+     * 可调用对象是否保存在对象内部(未分配堆内存)
+     * Whether the callable is stored inside the object (no heap allocation)
+     */
+    bool isInlined() const { return _ops && _ops->inlined; }
+
+private:
+    using Storage = typename std::aligned_storage<InlineSize, alignof(long double)>::type;
+
+    struct Ops {
+        R (*invoke)(void *, Args &&...);
+        // 移动到未初始化的dst，并析构src
+        // Move into the uninitialized dst and destroy src
+        void (*relocate)(void *dst, void *src);
+        void (*destroy)(void *);
+        bool inlined;
+    };
+
+    template <typename F>
+    static constexpr bool isInline() {
+        return sizeof(F) <= InlineSize && alignof(F) <= alignof(Storage) && std::is_nothrow_move_constructible<F>::value;
+    }
+
+    template <typename F>
+    static bool isNull(const F &) { return false; }
+    template <typename T>
+    static bool isNull(T *ptr) { return ptr == nullptr; }
+    template <typename Sig>
+    static bool isNull(const std::function<Sig> &func) { return !func; }
+
+    template <typename F, typename T>
+    void init(T &&f, std::true_type) {
+        static const Ops s_ops = {
+            [](void *p, Args &&...args) -> R { return (*static_cast<F *>(p))(std::forward<Args>(args)...); },
+            [](void *dst, void *src) {
+                new (dst) F(std::move(*static_cast<F *>(src)));
+                static_cast<F *>(src)->~F();
+            },
+            [](void *p) { static_cast<F *>(p)->~F(); },
+            true
+        };
+        new (&_storage) F(std::forward<T>(f));
+        _ops = &s_ops;
+    }
+
+    template <typename F, typename T>
+    void init(T &&f, std::false_type) {
+        static const Ops s_ops = {
+            [](void *p, Args &&...args) -> R { return (**static_cast<F **>(p))(std::forward<Args>(args)...); },
+            [](void *dst, void *src) { *static_cast<F **>(dst) = *static_cast<F **>(src); },
+            [](void *p) { delete *static_cast<F **>(p); },
+            false
+        };
+        *reinterpret_cast<F **>(&_storage) = new F(std::forward<T>(f));
+        _ops = &s_ops;
+    }
+
+    void moveFrom(InlineFunction &that) {
+        if (that._ops) {
+            that._ops->relocate(&_storage, &that._storage);
+            _ops = that._ops;
+            that._ops = nullptr;
+        }
+    }
+
+private:
+    const Ops *_ops = nullptr;
+    mutable Storage _storage;
+};
+
+} /* namespace toolkit */
+#endif // ZLTOOLKIT_INLINEFUNCTION_H
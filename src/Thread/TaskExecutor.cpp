@@ -14,6 +14,7 @@
 #include "Poller/EventPoller.h"
 #include "Util/onceToken.h"
 #include "Util/TimeTicker.h"
+#include "Util/CpuTopology.h"
 
 using namespace std;
 
@@ -26,6 +27,7 @@ ThreadLoadCounter::ThreadLoadCounter(uint64_t max_size, uint64_t max_usec) {
 }
 
 void ThreadLoadCounter::startSleep() {
+    _sleep_count.fetch_add(1, memory_order_relaxed);
     lock_guard<mutex> lck(_mtx);
     _sleeping = true;
     auto current_time = getCurrentMicrosecond();
@@ -49,6 +51,20 @@ void ThreadLoadCounter::sleepWakeUp() {
     }
 }
 
+void ThreadLoadCounter::onSpin(bool hit, uint64_t usec) {
+    (hit ? _spin_hit : _spin_miss).fetch_add(1, memory_order_relaxed);
+    _spin_usec.fetch_add(usec, memory_order_relaxed);
+}
+
+ThreadLoadCounter::SpinStatistic ThreadLoadCounter::getSpinStatistic() const {
+    SpinStatistic ret;
+    ret.spin_hit = _spin_hit.load(memory_order_relaxed);
+    ret.spin_miss = _spin_miss.load(memory_order_relaxed);
+    ret.sleep = _sleep_count.load(memory_order_relaxed);
+    ret.spin_usec = _spin_usec.load(memory_order_relaxed);
+    return ret;
+}
+
 int ThreadLoadCounter::load() {
     lock_guard<mutex> lck(_mtx);
     uint64_t totalSleepTime = 0;
@@ -90,6 +106,13 @@ Task::Ptr TaskExecutorInterface::async_first(TaskIn task, bool may_sync) {
     return async(std::move(task), may_sync);
 }
 
+void TaskExecutorInterface::post(InlineTask task, bool may_sync) {
+    // std::function要求可拷贝，借助shared_ptr包装只可移动的任务
+    // std::function requires copyable callables, wrap the move-only task with shared_ptr
+    auto ptr = std::make_shared<InlineTask>(std::move(task));
+    async([ptr]() { (*ptr)(); }, may_sync);
+}
+
 void TaskExecutorInterface::sync(const TaskIn &task) {
     semaphore sem;
     auto ret = async([&]() {
@@ -227,15 +250,23 @@ size_t TaskExecutorGetterImp::getExecutorSize() const {
     return _threads.size();
 }
 
-size_t TaskExecutorGetterImp::addPoller(const string &name, size_t size, int priority, bool register_thread, bool enable_cpu_affinity) {
+size_t TaskExecutorGetterImp::addPoller(const string &name, size_t size, int priority, bool register_thread, bool enable_cpu_affinity,
+                                        const vector<int> &cpu_list) {
     auto cpus = thread::hardware_concurrency();
     size = size > 0 ? size : cpus;
     for (size_t i = 0; i < size; ++i) {
         auto full_name = name + " " + to_string(i);
-        auto cpu_index = i % cpus;
+        int cpu_index = cpu_list.empty() ? (int)(i % cpus) : cpu_list[i % cpu_list.size()];
         EventPoller::Ptr poller(new EventPoller(full_name));
+        if (enable_cpu_affinity) {
+            // 记录所在cpu与NUMA节点，供NUMA内存池与查询使用
+            // Record the cpu and NUMA node, used by the NUMA memory pool and queries
+            poller->_cpu = cpu_index;
+            poller->_numa_node = CpuTopology::Instance().getNodeOfCpu(cpu_index);
+        }
         poller->runLoop(false, register_thread);
-        poller->async([cpu_index, full_name, priority, enable_cpu_affinity]() {
+        auto numa_node = poller->_numa_node;
+        poller->async([cpu_index, numa_node, full_name, priority, enable_cpu_affinity]() {
             // 设置线程优先级  [AUTO-TRANSLATED:2966f860]
             //Set thread priority
             ThreadPool::setPriority((ThreadPool::Priority)priority);
@@ -246,6 +277,7 @@ size_t TaskExecutorGetterImp::addPoller(const string &name, size_t size, int pri
             //Set CPU affinity
             if (enable_cpu_affinity) {
                 setThreadAffinity(cpu_index);
+                CpuTopology::setCurrentNode(numa_node);
             }
         });
         _threads.emplace_back(std::move(poller));
@@ -12,10 +12,12 @@
 #define ZLTOOLKIT_TASKEXECUTOR_H
 
 #include <mutex>
+#include <atomic>
 #include <memory>
 #include <functional>
 #include "Util/List.h"
 #include "Util/util.h"
+#include "InlineFunction.h"
 
 namespace toolkit {
 
@@ -66,6 +68,37 @@ public:
      */
     int load();
 
+    /**
+     * 忙轮询统计，自旋等待事件期间按休眠计算负载
+     * Busy poll statistics, time spent spinning for events counts as sleeping in the load
+     */
+    struct SpinStatistic {
+        // 自旋期间等到事件的次数
+        // Number of times events arrived while spinning
+        uint64_t spin_hit = 0;
+        // 自旋超时后进入阻塞休眠的次数
+        // Number of times spinning timed out and the thread blocked
+        uint64_t spin_miss = 0;
+        // 进入休眠的总次数
+        // Total number of sleeps
+        uint64_t sleep = 0;
+        // 自旋耗费的总时长(微秒)
+        // Total time spent spinning (microseconds)
+        uint64_t spin_usec = 0;
+    };
+
+    /**
+     * 记录一次自旋
+     * @param hit 自旋期间是否等到了事件
+     * @param usec 自旋时长(微秒)
+     * Record one spin
+     * @param hit Whether events arrived while spinning
+     * @param usec Spin time (microseconds)
+     */
+    void onSpin(bool hit, uint64_t usec);
+
+    SpinStatistic getSpinStatistic() const;
+
 private:
     struct TimeRecord {
         TimeRecord(uint64_t tm, bool slp) {
@@ -79,6 +112,10 @@ private:
 
 private:
     bool _sleeping = true;
+    std::atomic<uint64_t> _spin_hit { 0 };
+    std::atomic<uint64_t> _spin_miss { 0 };
+    std::atomic<uint64_t> _sleep_count { 0 };
+    std::atomic<uint64_t> _spin_usec { 0 };
     uint64_t _last_sleep_time;
     uint64_t _last_wake_time;
     uint64_t _max_size;
@@ -154,6 +191,9 @@ protected:
 
 using TaskIn = std::function<void()>;
 using Task = TaskCancelableImp<void()>;
+// 不可取消、只可移动的任务，小任务无堆内存分配
+// Non-cancelable move-only task, small tasks need no heap allocation
+using InlineTask = InlineFunction<void()>;
 
 class TaskExecutorInterface {
 public:
@@ -188,6 +228,18 @@ public:
      */
     virtual Task::Ptr async_first(TaskIn task, bool may_sync = true);
 
+    /**
+     * 快速投递不可取消的任务，不创建Task对象，适合高频投递的场景
+     * 默认实现转调async，EventPoller与ThreadPool重载后小任务投递无堆内存分配
+     * @param task 任务
+     * @param may_sync 是否允许同步执行该任务
+     * Quickly post a non-cancelable task without creating a Task object, suitable for high-rate posting
+     * The default implementation forwards to async, EventPoller and ThreadPool override it so that posting small tasks allocates no heap memory
+     * @param task Task
+     * @param may_sync Whether to allow synchronous execution of the task
+     */
+    virtual void post(InlineTask task, bool may_sync = true);
+
     /**
      * 同步执行任务
      * @param task
@@ -297,7 +349,14 @@ public:
     size_t getExecutorSize() const override;
 
 protected:
-    size_t addPoller(const std::string &name, size_t size, int priority, bool register_thread, bool enable_cpu_affinity = true);
+    /**
+     * 创建EventPoller线程
+     * @param cpus 每个线程绑定的cpu，为空时按线程序号绑定
+     * Create EventPoller threads
+     * @param cpus The cpu each thread is bound to, bound by thread index if empty
+     */
+    size_t addPoller(const std::string &name, size_t size, int priority, bool register_thread, bool enable_cpu_affinity = true,
+                     const std::vector<int> &cpus = {});
 
 protected:
     size_t _thread_pos = 0;
@@ -12,6 +12,9 @@
 #define TASKQUEUE_H_
 
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include "Util/List.h"
 #include "semaphore.h"
 
@@ -72,5 +75,175 @@ private:
     semaphore _sem;
 };
 
+/**
+ * 有界无锁多生产者多消费者任务列队，接口与TaskQueue一致
+ * 普通任务写入固定大小的环形缓冲(每个槽位带序号，生产与消费只需一次CAS)，由fast_semaphore计数与唤醒
+ * 环形缓冲满时以及push_task_first的任务退化为加锁链表，保证任务不丢失也不阻塞生产者：
+ * 优先插队任务最先被取出；溢出期间新的普通任务也进入溢出链表，待环形缓冲取空后再按序取出
+ * Bounded lock-free multi-producer multi-consumer task queue, with the same interface as TaskQueue
+ * Normal tasks are written into a fixed size ring buffer (each slot has a sequence number, producing and consuming only take one CAS), counted and signaled by fast_semaphore
+ * When the ring buffer is full, and for push_task_first, tasks fall back to locked lists, so tasks are never lost and producers never block:
+ * Tasks pushed first are taken first; while overflowing, new normal tasks also go to the overflow list and are taken in order once the ring buffer is drained
+ */
+template<typename T>
+class LockFreeTaskQueue {
+public:
+    /**
+     * @param capacity 环形缓冲大小，向上取整为2的幂；环形缓冲在构造时整体分配，突发的积压由溢出链表承接，因此默认值较小
+     * @param capacity Ring buffer size, rounded up to a power of 2; the ring buffer is allocated up front and bursts spill into the overflow list, so the default is small
+     */
+    explicit LockFreeTaskQueue(size_t capacity = 128) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _mask = size - 1;
+        _slots.reset(new Slot[size]);
+        for (size_t i = 0; i < size; ++i) {
+            _slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    //打入任务至列队
+    //Put a task into the queue
+    template<typename C>
+    void push_task(C &&task_func) {
+        if (_overflow_size.load(std::memory_order_acquire) || !tryPush(std::forward<C>(task_func))) {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            _overflow.emplace_back(std::forward<C>(task_func));
+            ++_overflow_size;
+        }
+        _sem.post();
+    }
+
+    template<typename C>
+    void push_task_first(C &&task_func) {
+        {
+            std::lock_guard<decltype(_mutex)> lock(_mutex);
+            _first.emplace_front(std::forward<C>(task_func));
+            ++_first_size;
+        }
+        _sem.post();
+    }
+
+    //清空任务列队
+    //Clear the task queue
+    void push_exit(size_t n) {
+        _exit_count += n;
+        _sem.post(n);
+    }
+
+    //从列队获取一个任务，由执行线程执行；列队为空且收到退出信号时返回false
+    //Get a task from the queue and execute it by the executing thread; return false if the queue is empty and an exit signal was received
+    bool get_task(T &tsk) {
+        _sem.wait();
+        while (true) {
+            if (tryPopList(_first, _first_size, tsk) || tryPop(tsk) || tryPopList(_overflow, _overflow_size, tsk)) {
+                return true;
+            }
+            auto exit_count = _exit_count.load();
+            while (exit_count > 0) {
+                if (_exit_count.compare_exchange_weak(exit_count, exit_count - 1)) {
+                    return false;
+                }
+            }
+            // 信号量对应的任务已占位但尚未写完(生产者正在写槽位)，稍后重试
+            // The task for this signal has claimed its slot but is not fully written yet (the producer is writing it), retry later
+            std::this_thread::yield();
+        }
+    }
+
+    size_t size() const {
+        auto ring = _enqueue_pos.load(std::memory_order_relaxed) - _dequeue_pos.load(std::memory_order_relaxed);
+        return (ring > _mask + 1 ? 0 : ring) + _first_size.load() + _overflow_size.load();
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    // 失败时task_func未被移动，可继续写入溢出链表
+    // On failure task_func is not moved from, so it can still be written into the overflow list
+    template<typename C>
+    bool tryPush(C &&task_func) {
+        auto pos = _enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            auto &slot = _slots[pos & _mask];
+            auto seq = slot.seq.load(std::memory_order_acquire);
+            auto diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.data = std::forward<C>(task_func);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // 环形缓冲已满
+                // The ring buffer is full
+                return false;
+            } else {
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T &tsk) {
+        auto pos = _dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            auto &slot = _slots[pos & _mask];
+            auto seq = slot.seq.load(std::memory_order_acquire);
+            auto diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    tsk = std::move(slot.data);
+                    slot.data = T();
+                    slot.seq.store(pos + _mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // 环形缓冲为空或槽位尚未写完
+                // The ring buffer is empty or the slot is not fully written yet
+                return false;
+            } else {
+                pos = _dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPopList(List<T> &list, std::atomic<size_t> &list_size, T &tsk) {
+        if (!list_size.load(std::memory_order_acquire)) {
+            return false;
+        }
+        std::lock_guard<decltype(_mutex)> lock(_mutex);
+        if (list.empty()) {
+            return false;
+        }
+        tsk = std::move(list.front());
+        list.pop_front();
+        --list_size;
+        return true;
+    }
+
+private:
+    size_t _mask;
+    std::unique_ptr<Slot[]> _slots;
+    // 生产与消费位置各自独占缓存行；C++11的new不保证alignas(64)，因此用整个缓存行的填充隔开
+    // The producer and consumer positions each own a cache line; new does not honour alignas(64) in C++11, so they are separated by a whole cache line of padding
+    char _pad0[64];
+    std::atomic<size_t> _enqueue_pos { 0 };
+    char _pad1[64];
+    std::atomic<size_t> _dequeue_pos { 0 };
+    char _pad2[64];
+    std::atomic<size_t> _first_size { 0 };
+    std::atomic<size_t> _overflow_size { 0 };
+    std::atomic<size_t> _exit_count { 0 };
+    std::mutex _mutex;
+    List<T> _first;
+    List<T> _overflow;
+    fast_semaphore _sem;
+};
+
 } /* namespace toolkit */
 #endif /* TASKQUEUE_H_ */
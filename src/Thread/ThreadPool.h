@@ -16,6 +16,7 @@
 #include "TaskExecutor.h"
 #include "Util/util.h"
 #include "Util/logger.h"
+#include "Util/LatencyHistogram.h"
 
 namespace toolkit {
 
@@ -29,8 +30,18 @@ public:
         PRIORITY_HIGHEST
     };
 
+    enum LatencyType {
+        Latency_TaskWait = 0, // 任务从投递到开始执行的等待时长
+        Latency_TaskExec, // 任务的执行耗时
+        Latency_Max
+    };
+
+    /**
+     * @param queue_capacity 无锁任务列队的环形缓冲大小，超出部分进入溢出链表，任务不会丢失
+     * @param queue_capacity Ring buffer size of the lock-free task queue, tasks beyond it go to the overflow list and are never lost
+     */
     ThreadPool(int num = 1, Priority priority = PRIORITY_HIGHEST, bool auto_run = true, bool set_affinity = true,
-               const std::string &pool_name = "thread pool") {
+               const std::string &pool_name = "thread pool", size_t queue_capacity = 128) : _queue(queue_capacity) {
         _thread_num = num;
         _on_setup = [pool_name, priority, set_affinity, num](int index) {
             std::string name = num > 1 ? pool_name + ' ' + std::to_string(index) : pool_name;
@@ -59,9 +70,9 @@ public:
             return nullptr;
         }
         auto ret = std::make_shared<Task>(std::move(task));
-        _queue.push_task([ret](size_t) {
+        _queue.push_task(QueuedTask { [ret](size_t) {
             (*ret)();
-        });
+        }, LatencyHistogram::now() });
         return ret;
     }
 
@@ -72,21 +83,29 @@ public:
         }
 
         auto ret = std::make_shared<Task>(std::move(task));
-        _queue.push_task_first([ret](size_t) {
+        _queue.push_task_first(QueuedTask { [ret](size_t) {
             (*ret)();
-        });
+        }, LatencyHistogram::now() });
         return ret;
     }
 
+    void post(InlineTask task, bool may_sync = true) override {
+        if (may_sync && _thread_group.is_this_thread_in()) {
+            task();
+            return;
+        }
+        _queue.push_task(QueuedTask { PostedTask { std::move(task) }, LatencyHistogram::now() });
+    }
+
     void async2(std::function<void(size_t index)> task, bool may_sync = true, bool first = false) {
         if (may_sync && _thread_group.is_this_thread_in()) {
             task(0);
             return;
         }
         if (first) {
-            _queue.push_task_first(std::move(task));
+            _queue.push_task_first(QueuedTask { std::move(task), LatencyHistogram::now() });
         } else {
-            _queue.push_task(std::move(task));
+            _queue.push_task(QueuedTask { std::move(task), LatencyHistogram::now() });
         }
     }
 
@@ -94,6 +113,18 @@ public:
         return _queue.size();
     }
 
+    /**
+     * 获取延时直方图快照
+     * @param type 统计类型
+     * @param reset 获取后是否清零
+     * Get a snapshot of a latency histogram
+     * @param type Statistic type
+     * @param reset Whether to reset after reading
+     */
+    LatencyHistogram::Snapshot getLatency(LatencyType type, bool reset = false) {
+        return _latency[type].snapshot(reset);
+    }
+
     static bool setPriority(Priority priority = PRIORITY_NORMAL, std::thread::native_handle_type threadId = 0) {
         // set priority
 #if defined(_WIN32)
@@ -135,7 +166,7 @@ public:
 private:
     void run(size_t index) {
         _on_setup(index);
-        std::function<void(size_t index)> task;
+        QueuedTask task;
         while (true) {
             startSleep();
             if (!_queue.get_task(task)) {
@@ -144,12 +175,15 @@ private:
                 break;
             }
             sleepWakeUp();
+            auto start = LatencyHistogram::now();
+            _latency[Latency_TaskWait].record(start > task.post_ns ? start - task.post_ns : 0);
             try {
-                task(index);
-                task = nullptr;
+                task.task(index);
+                task.task = nullptr;
             } catch (std::exception &ex) {
                 ErrorL << "ThreadPool catch a exception: " << ex.what();
             }
+            _latency[Latency_TaskExec].record(LatencyHistogram::now() - start);
         }
     }
 
@@ -161,11 +195,28 @@ private:
         _queue.push_exit(_thread_num);
     }
 
+private:
+    // 列队中的任务，内联空间可容纳std::function与InlineTask，投递时无需再次分配内存
+    // Task in the queue, its inline storage can hold std::function and InlineTask, so no more allocation is needed when posting
+    using PoolTask = InlineFunction<void(size_t index), 128>;
+
+    struct PostedTask {
+        InlineTask task;
+        void operator()(size_t) const { task(); }
+    };
+    // 列队中的任务及其投递时间
+    // A queued task and the time it was posted
+    struct QueuedTask {
+        PoolTask task;
+        uint64_t post_ns;
+    };
+
 private:
     size_t _thread_num;
     Logger::Ptr _logger;
     thread_group _thread_group;
-    TaskQueue<std::function<void(size_t index)>> _queue;
+    LockFreeTaskQueue<QueuedTask> _queue;
+    LatencyHistogram _latency[Latency_Max];
     std::function<void(int)> _on_setup;
 };
 
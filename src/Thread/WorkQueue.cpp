@@ -0,0 +1,225 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "WorkQueue.h"
+
+using namespace std;
+
+namespace toolkit {
+
+// 每次drain最多执行的任务数与时长，之后让出poller以便执行io事件与其他任务
+// Max tasks and time of one drain, after which the poller is yielded to io events and other tasks
+static constexpr size_t kDrainBatch = 64;
+static constexpr uint64_t kDrainBudgetNs = 5 * 1000 * 1000;
+
+static const char *s_priority_name[WorkQueue::Priority_Max] = { "high", "normal", "low" };
+
+void WorkQueue::Statistic::merge(const Statistic &that) {
+    for (int i = 0; i < Priority_Max; ++i) {
+        queued[i] += that.queued[i];
+        wait[i].merge(that.wait[i]);
+    }
+    accepted += that.accepted;
+    executed += that.executed;
+    rejected += that.rejected;
+    shed += that.shed;
+    inlined += that.inlined;
+}
+
+string WorkQueue::Statistic::toString() const {
+    string ret = "accepted:" + to_string(accepted);
+    ret += " executed:" + to_string(executed);
+    ret += " rejected:" + to_string(rejected);
+    ret += " shed:" + to_string(shed);
+    ret += " inlined:" + to_string(inlined);
+    for (int i = 0; i < Priority_Max; ++i) {
+        ret += string(" | ") + s_priority_name[i] + " queued:" + to_string(queued[i]) + " wait:{" + wait[i].toString() + "}";
+    }
+    return ret;
+}
+
+WorkQueue::WorkQueue(EventPoller::Ptr poller, size_t max_size, OverflowPolicy policy) {
+    _poller = std::move(poller);
+    _max_size = max_size;
+    _policy = policy;
+}
+
+Task::Ptr WorkQueue::async(TaskIn task, Priority priority, bool may_sync) {
+    if (priority < Priority_High || priority >= Priority_Max) {
+        priority = Priority_Normal;
+    }
+    if (may_sync && _poller->isCurrentThread()) {
+        task();
+        ++_executed;
+        return nullptr;
+    }
+
+    auto ret = std::make_shared<Task>(std::move(task));
+    Task::Ptr shed;
+    bool reject = false;
+    bool run_inline = false;
+    bool schedule = false;
+    {
+        lock_guard<mutex> lck(_mtx);
+        if (_max_size && _size >= _max_size) {
+            // 新任务总是可以挤掉更低优先级的任务
+            // A new task can always push out a lower priority one
+            for (int i = Priority_Max - 1; i > priority && !shed; --i) {
+                if (!_queue[i].empty()) {
+                    shed = std::move(_queue[i].front().task);
+                    _queue[i].pop_front();
+                    --_size;
+                }
+            }
+        }
+        if (!shed && _max_size && _size >= _max_size) {
+            switch (_policy) {
+                case Overflow_ShedOldest: {
+                    // 没有更低优先级的任务，丢弃同优先级最旧的任务
+                    // No lower priority task, drop the oldest task of the same priority
+                    if (!_queue[priority].empty()) {
+                        shed = std::move(_queue[priority].front().task);
+                        _queue[priority].pop_front();
+                        --_size;
+                    }
+                    reject = !shed;
+                    break;
+                }
+                case Overflow_RunInline: run_inline = true; break;
+                default: reject = true; break;
+            }
+        }
+        if (!reject && !run_inline) {
+            _queue[priority].emplace_back(QueuedTask { ret, LatencyHistogram::now() });
+            ++_size;
+            if (!_scheduled) {
+                _scheduled = true;
+                schedule = true;
+            }
+        }
+    }
+
+    if (shed) {
+        shed->cancel();
+        ++_shed;
+    }
+    if (reject) {
+        ret->cancel();
+        ++_rejected;
+        return ret;
+    }
+    if (run_inline) {
+        ++_inlined;
+        (*ret)();
+        return nullptr;
+    }
+    ++_accepted;
+    if (schedule) {
+        std::weak_ptr<WorkQueue> weak_self = shared_from_this();
+        _poller->post([weak_self]() {
+            if (auto strong_self = weak_self.lock()) {
+                strong_self->drain();
+            }
+        }, false);
+    }
+    return ret;
+}
+
+void WorkQueue::drain() {
+    auto start = LatencyHistogram::now();
+    for (size_t count = 0; count < kDrainBatch; ++count) {
+        QueuedTask queued;
+        int priority = 0;
+        {
+            lock_guard<mutex> lck(_mtx);
+            while (priority < Priority_Max && _queue[priority].empty()) {
+                ++priority;
+            }
+            if (priority == Priority_Max) {
+                _scheduled = false;
+                return;
+            }
+            queued = std::move(_queue[priority].front());
+            _queue[priority].pop_front();
+            --_size;
+        }
+        auto now = LatencyHistogram::now();
+        _wait[priority].record(now - queued.enqueue_ns);
+        try {
+            (*queued.task)();
+        } catch (std::exception &ex) {
+            ErrorL << "Exception occurred when do work queue task: " << ex.what();
+        } catch (...) {
+            // 异常不可逃出drain，否则_scheduled无法复位，该列队将不再被调度
+            // No exception may escape drain, otherwise _scheduled is never reset and the queue is never scheduled again
+            ErrorL << "Unknown exception occurred when do work queue task";
+        }
+        ++_executed;
+        if (LatencyHistogram::now() - start >= kDrainBudgetNs) {
+            break;
+        }
+    }
+
+    {
+        lock_guard<mutex> lck(_mtx);
+        if (!_size) {
+            _scheduled = false;
+            return;
+        }
+    }
+    // 还有任务，排到poller任务列队末尾继续执行
+    // Tasks remain, continue at the tail of the poller task queue
+    std::weak_ptr<WorkQueue> weak_self = shared_from_this();
+    _poller->post([weak_self]() {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->drain();
+        }
+    }, false);
+}
+
+void WorkQueue::setLimit(size_t max_size, OverflowPolicy policy) {
+    lock_guard<mutex> lck(_mtx);
+    _max_size = max_size;
+    _policy = policy;
+}
+
+size_t WorkQueue::size() const {
+    lock_guard<mutex> lck(_mtx);
+    return _size;
+}
+
+WorkQueue::Statistic WorkQueue::getStatistic(bool reset) {
+    Statistic ret;
+    {
+        lock_guard<mutex> lck(_mtx);
+        for (int i = 0; i < Priority_Max; ++i) {
+            ret.queued[i] = _queue[i].size();
+        }
+    }
+    if (reset) {
+        ret.accepted = _accepted.exchange(0);
+        ret.executed = _executed.exchange(0);
+        ret.rejected = _rejected.exchange(0);
+        ret.shed = _shed.exchange(0);
+        ret.inlined = _inlined.exchange(0);
+    } else {
+        ret.accepted = _accepted.load();
+        ret.executed = _executed.load();
+        ret.rejected = _rejected.load();
+        ret.shed = _shed.load();
+        ret.inlined = _inlined.load();
+    }
+    for (int i = 0; i < Priority_Max; ++i) {
+        ret.wait[i] = _wait[i].snapshot(reset);
+    }
+    return ret;
+}
+
+} // namespace toolkit
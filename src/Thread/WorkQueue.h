@@ -0,0 +1,163 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_WORKQUEUE_H
+#define ZLTOOLKIT_WORKQUEUE_H
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include "Util/List.h"
+#include "Util/LatencyHistogram.h"
+#include "Poller/EventPoller.h"
+
+namespace toolkit {
+
+/**
+ * 有界、分优先级的任务列队，任务最终在所属的EventPoller线程中执行
+ * 列队满时新任务优先挤掉最旧的更低优先级任务，否则按溢出策略处理，过载时丢弃任务而不是无限堆积，从而限制排队时延
+ * 高优先级任务总是先于低优先级任务执行，每次只执行一批任务，不会长时间占用poller
+ * Bounded task queue with priority classes, tasks finally run in the thread of its EventPoller
+ * When the queue is full a new task first pushes out the oldest lower priority task, otherwise it is handled by the overflow policy, so overload sheds tasks instead of piling them up, which bounds the queueing delay
+ * Higher priority tasks always run before lower priority ones, only a batch of tasks runs at a time so the poller is never hogged
+ */
+class WorkQueue : public TaskExecutorInterface, public std::enable_shared_from_this<WorkQueue> {
+public:
+    using Ptr = std::shared_ptr<WorkQueue>;
+
+    typedef enum {
+        Priority_High = 0,
+        Priority_Normal,
+        Priority_Low,
+        Priority_Max
+    } Priority;
+
+    typedef enum {
+        // 拒绝新任务
+        // Reject the new task
+        Overflow_Reject = 0,
+        // 丢弃同优先级最旧的任务，没有时拒绝新任务
+        // Drop the oldest task of the same priority, reject the new task if there is none
+        Overflow_ShedOldest,
+        // 在投递线程中直接执行新任务，从而反压投递方
+        // Run the new task directly in the posting thread, which pushes back on the poster
+        Overflow_RunInline,
+    } OverflowPolicy;
+
+    struct Statistic {
+        // 当前各优先级排队的任务数
+        // Tasks currently queued in each priority class
+        size_t queued[Priority_Max] = {};
+        uint64_t accepted = 0;
+        uint64_t executed = 0;
+        uint64_t rejected = 0;
+        uint64_t shed = 0;
+        uint64_t inlined = 0;
+        // 各优先级任务的排队时长
+        // Queueing time of tasks in each priority class
+        LatencyHistogram::Snapshot wait[Priority_Max];
+
+        void merge(const Statistic &that);
+        std::string toString() const;
+    };
+
+    /**
+     * @param poller 执行任务的poller
+     * @param max_size 列队最大任务数，0为不限制
+     * @param policy 列队满时的溢出策略
+     * @param poller Poller which runs the tasks
+     * @param max_size Max tasks of the queue, 0 for unlimited
+     * @param policy Overflow policy when the queue is full
+     */
+    WorkQueue(EventPoller::Ptr poller, size_t max_size = 0, OverflowPolicy policy = Overflow_Reject);
+    ~WorkQueue() override = default;
+
+    /**
+     * 以普通优先级投递任务
+     * Post a task with the normal priority
+     */
+    Task::Ptr async(TaskIn task, bool may_sync = true) override {
+        return async(std::move(task), Priority_Normal, may_sync);
+    }
+
+    /**
+     * 以高优先级投递任务
+     * Post a task with the high priority
+     */
+    Task::Ptr async_first(TaskIn task, bool may_sync = true) override {
+        return async(std::move(task), Priority_High, may_sync);
+    }
+
+    /**
+     * 投递任务
+     * @param task 任务
+     * @param priority 优先级
+     * @param may_sync 在poller线程中投递时是否允许直接执行
+     * @return 已直接执行时返回nullptr；被拒绝或之后被丢弃的任务为已取消状态(operator bool()为false)
+     * Post a task
+     * @param task Task
+     * @param priority Priority
+     * @param may_sync Whether it may run directly when posted from the poller thread
+     * @return nullptr if it already ran directly; a rejected task, or one shed later, is in the canceled state (operator bool() is false)
+     */
+    Task::Ptr async(TaskIn task, Priority priority, bool may_sync = true);
+
+    /**
+     * 修改列队长度限制与溢出策略，已排队的任务不受影响
+     * Change the queue limit and overflow policy, queued tasks are not affected
+     */
+    void setLimit(size_t max_size, OverflowPolicy policy);
+
+    /**
+     * 当前排队的任务数
+     * Number of queued tasks
+     */
+    size_t size() const;
+
+    const EventPoller::Ptr &getPoller() const { return _poller; }
+
+    /**
+     * 获取统计信息
+     * @param reset 是否清零计数与排队时长统计
+     * Get the statistics
+     * @param reset Whether to reset the counters and queueing time statistics
+     */
+    Statistic getStatistic(bool reset = false);
+
+private:
+    struct QueuedTask {
+        Task::Ptr task;
+        uint64_t enqueue_ns;
+    };
+
+    void drain();
+
+private:
+    EventPoller::Ptr _poller;
+
+    mutable std::mutex _mtx;
+    List<QueuedTask> _queue[Priority_Max];
+    size_t _size = 0;
+    size_t _max_size;
+    OverflowPolicy _policy;
+    // 是否已有drain任务在poller中等待
+    // Whether a drain task is already pending in the poller
+    bool _scheduled = false;
+
+    std::atomic<uint64_t> _accepted { 0 };
+    std::atomic<uint64_t> _executed { 0 };
+    std::atomic<uint64_t> _rejected { 0 };
+    std::atomic<uint64_t> _shed { 0 };
+    std::atomic<uint64_t> _inlined { 0 };
+    LatencyHistogram _wait[Priority_Max];
+};
+
+} // namespace toolkit
+#endif // ZLTOOLKIT_WORKQUEUE_H
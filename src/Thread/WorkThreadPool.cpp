@@ -29,6 +29,49 @@ WorkThreadPool::WorkThreadPool() {
     //最低优先级  [AUTO-TRANSLATED:cd1f0dbc]
     //Lowest priority
     addPoller("work poller", s_pool_size, ThreadPool::PRIORITY_LOWEST, false, s_enable_cpu_affinity);
+    for (auto &th : _threads) {
+        _queues.emplace_back(std::make_shared<WorkQueue>(std::static_pointer_cast<EventPoller>(th), 4096, WorkQueue::Overflow_Reject));
+    }
+}
+
+WorkQueue::Ptr WorkThreadPool::getWorkQueue() {
+    //从上次的位置开始查找，排队数相同时选负载低的
+    //Search from the last position, prefer the lower load when the queued counts are equal
+    auto pos = _queue_pos.fetch_add(1, std::memory_order_relaxed);
+    WorkQueue::Ptr ret;
+    size_t min_size = 0;
+    int min_load = 0;
+    for (size_t i = 0; i < _queues.size(); ++i) {
+        auto &queue = _queues[(pos + i) % _queues.size()];
+        auto size = queue->size();
+        if (ret && size > min_size) {
+            continue;
+        }
+        auto load = queue->getPoller()->load();
+        if (!ret || size < min_size || load < min_load) {
+            ret = queue;
+            min_size = size;
+            min_load = load;
+        }
+        if (!min_size && !min_load) {
+            break;
+        }
+    }
+    return ret;
+}
+
+void WorkThreadPool::setQueueLimit(size_t max_size, WorkQueue::OverflowPolicy policy) {
+    for (auto &queue : _queues) {
+        queue->setLimit(max_size, policy);
+    }
+}
+
+WorkQueue::Statistic WorkThreadPool::getQueueStatistic(bool reset) {
+    WorkQueue::Statistic ret;
+    for (auto &queue : _queues) {
+        ret.merge(queue->getStatistic(reset));
+    }
+    return ret;
 }
 
 void WorkThreadPool::setPoolSize(size_t size) {
@@ -11,8 +11,10 @@
 #ifndef UTIL_WORKTHREADPOOL_H_
 #define UTIL_WORKTHREADPOOL_H_
 
+#include <atomic>
 #include <memory>
 #include "Poller/EventPoller.h"
+#include "WorkQueue.h"
 
 namespace toolkit {
 
@@ -74,8 +76,40 @@ public:
      */
     EventPoller::Ptr getPoller();
 
+    /**
+     * 获取排队任务最少的有界任务列队，每个poller对应一个列队
+     * 适合DNS解析、sql、文件扫描等耗cpu或阻塞的任务，过载时按溢出策略丢弃任务而不是无限堆积
+     * Get the bounded task queue with the fewest queued tasks, there is one queue per poller
+     * Suitable for cpu heavy or blocking tasks such as DNS resolving, sql and file scans, overload sheds tasks by the overflow policy instead of piling them up
+     */
+    WorkQueue::Ptr getWorkQueue();
+
+    /**
+     * 设置所有任务列队的长度限制与溢出策略，默认每个列队最多4096个任务，满时拒绝新任务
+     * @param max_size 每个列队的最大任务数，0为不限制
+     * @param policy 溢出策略
+     * Set the limit and overflow policy of all the task queues, by default each queue holds at most 4096 tasks and rejects new ones when full
+     * @param max_size Max tasks of each queue, 0 for unlimited
+     * @param policy Overflow policy
+     */
+    void setQueueLimit(size_t max_size, WorkQueue::OverflowPolicy policy);
+
+    /**
+     * 合并所有任务列队的统计信息
+     * @param reset 是否清零
+     * Merge the statistics of all the task queues
+     * @param reset Whether to reset them
+     */
+    WorkQueue::Statistic getQueueStatistic(bool reset = false);
+
 protected:
     WorkThreadPool();
+
+private:
+    // getWorkQueue可被多个线程并发调用
+    // getWorkQueue may be called by several threads concurrently
+    std::atomic<size_t> _queue_pos { 0 };
+    std::vector<WorkQueue::Ptr> _queues;
 };
 
 } /* namespace toolkit */
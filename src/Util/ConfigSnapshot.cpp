@@ -0,0 +1,138 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "ConfigSnapshot.h"
+#include "logger.h"
+#include "onceToken.h"
+
+using namespace std;
+
+namespace toolkit {
+
+INSTANCE_IMP(ConfigStore)
+
+ConfigValue::ConfigValue(const string &str) {
+    variant value(str);
+    _exists = true;
+    _bool = value.as<bool>();
+    _int = value.as<int64_t>();
+    _double = value.as<double>();
+    _str = str;
+}
+
+ConfigStore::ConfigStore() {
+    _snapshot = std::make_shared<ConfigSnapshot>(0, vector<ConfigValue>());
+}
+
+ConfigKey ConfigStore::intern(const string &name) {
+    lock_guard<recursive_mutex> lck(_mtx);
+    auto it = _keys.find(name);
+    if (it != _keys.end()) {
+        return it->second;
+    }
+    ConfigKey key((uint32_t) _names.size());
+    _names.emplace_back(name);
+    _keys.emplace(name, key);
+    if (_source.find(name) != _source.end()) {
+        //该配置已有值，重新发布使其在快照中可见
+        //The item already has a value, republish so it becomes visible in the snapshot
+        publish_l(_source);
+    }
+    return key;
+}
+
+string ConfigStore::keyName(ConfigKey key) const {
+    lock_guard<recursive_mutex> lck(_mtx);
+    return key.index() < _names.size() ? _names[key.index()] : "";
+}
+
+void ConfigStore::publish(const mINI &ini) {
+    map<string, string> source;
+    for (auto &pr : ini) {
+        source.emplace_hint(source.end(), pr.first, pr.second);
+    }
+    lock_guard<recursive_mutex> lck(_mtx);
+    publish_l(std::move(source));
+}
+
+void ConfigStore::publish_l(map<string, string> source) {
+    auto old_snapshot = std::atomic_load(&_snapshot);
+    vector<ConfigValue> values(_names.size());
+    vector<ConfigKey> changed;
+    for (uint32_t i = 0; i < _names.size(); ++i) {
+        ConfigKey key(i);
+        auto it = source.find(_names[i]);
+        if (it != source.end()) {
+            values[i] = ConfigValue(it->second);
+        }
+        auto &old_value = (*old_snapshot)[key];
+        if (old_value.exists() != values[i].exists() || old_value.asString() != values[i].asString()) {
+            changed.emplace_back(key);
+        }
+    }
+    _source = std::move(source);
+
+    auto snapshot = std::make_shared<const ConfigSnapshot>(old_snapshot->version() + 1, std::move(values));
+    //先替换快照再更新版本号，读取方看到新版本号时一定能读到新快照
+    //Swap the snapshot before bumping the version, so a reader that sees the new version always gets the new snapshot
+    std::atomic_store(&_snapshot, ConfigSnapshot::Ptr(snapshot));
+    _version.store(snapshot->version(), memory_order_release);
+
+    if (changed.empty()) {
+        return;
+    }
+    //复制一份再回调，回调中可添加/删除监听者
+    //Call a copy, so listeners may be added or removed from inside a callback
+    auto listeners = _listeners;
+    for (auto &pr : listeners) {
+        try {
+            pr.second(snapshot, changed);
+        } catch (std::exception &ex) {
+            WarnL << "Exception occurred when notify config changed: " << ex.what();
+        }
+    }
+}
+
+const ConfigSnapshot::Ptr &ConfigStore::cached() const {
+    struct Cache {
+        const ConfigStore *owner = nullptr;
+        uint64_t version = 0;
+        ConfigSnapshot::Ptr snapshot;
+    };
+    static thread_local Cache s_cache;
+    if (s_cache.owner != this || s_cache.version != _version.load(memory_order_acquire)) {
+        //快照已更新(低频)，刷新本线程缓存的引用
+        //The snapshot was updated (rarely), refresh the reference cached by this thread
+        s_cache.snapshot = std::atomic_load(&_snapshot);
+        s_cache.owner = this;
+        s_cache.version = s_cache.snapshot->version();
+    }
+    return s_cache.snapshot;
+}
+
+ConfigSnapshot::Ptr ConfigStore::current() const {
+    return cached();
+}
+
+ConfigSnapshot::Ptr ConfigStore::snapshot() const {
+    return std::atomic_load(&_snapshot);
+}
+
+void ConfigStore::addListener(void *tag, ChangedCB cb) {
+    lock_guard<recursive_mutex> lck(_mtx);
+    _listeners[tag] = std::move(cb);
+}
+
+void ConfigStore::delListener(void *tag) {
+    lock_guard<recursive_mutex> lck(_mtx);
+    _listeners.erase(tag);
+}
+
+} // namespace toolkit
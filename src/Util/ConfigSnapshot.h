@@ -0,0 +1,218 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_CONFIGSNAPSHOT_H
+#define ZLTOOLKIT_CONFIGSNAPSHOT_H
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include "mini.h"
+
+namespace toolkit {
+
+/**
+ * 配置项句柄，由ConfigStore::intern()在启动时把配置名转换为整数下标，读取时免去字符串查找
+ * Config item handle, ConfigStore::intern() turns the config name into an integer index at startup, so reads need no string lookup
+ */
+class ConfigKey {
+public:
+    ConfigKey() = default;
+    explicit ConfigKey(uint32_t index) : _index(index) {}
+
+    uint32_t index() const { return _index; }
+    bool valid() const { return _index != kInvalid; }
+
+    bool operator==(const ConfigKey &that) const { return _index == that._index; }
+    bool operator!=(const ConfigKey &that) const { return _index != that._index; }
+
+private:
+    static constexpr uint32_t kInvalid = 0xFFFFFFFF;
+    uint32_t _index = kInvalid;
+};
+
+/**
+ * 预先解析好的配置值，发布快照时一次性转换为各种类型，读取时直接返回
+ * Pre-parsed config value, it is converted to every type once when the snapshot is published, reads just return it
+ */
+class ConfigValue {
+public:
+    ConfigValue() = default;
+    explicit ConfigValue(const std::string &str);
+
+    bool exists() const { return _exists; }
+    const std::string &asString() const { return _str; }
+    int64_t asInt() const { return _int; }
+    double asDouble() const { return _double; }
+    bool asBool() const { return _bool; }
+
+    /**
+     * 转换为指定类型，整数、浮点、布尔与字符串直接返回预解析结果，其他类型与variant::as<T>()一致
+     * Convert to the given type, integers, floats, booleans and strings return the pre-parsed result, other types behave like variant::as<T>()
+     */
+    template<typename T>
+    typename std::enable_if<std::is_same<T, bool>::value, T>::type as() const { return _bool; }
+
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, T>::type as() const { return (T) _int; }
+
+    template<typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, T>::type as() const { return (T) _double; }
+
+    template<typename T>
+    typename std::enable_if<std::is_same<T, std::string>::value, const std::string &>::type as() const { return _str; }
+
+    template<typename T>
+    typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_same<T, std::string>::value, T>::type as() const {
+        return variant(_str).as<T>();
+    }
+
+private:
+    bool _exists = false;
+    bool _bool = false;
+    int64_t _int = 0;
+    double _double = 0;
+    std::string _str;
+};
+
+/**
+ * 不可变的配置快照，按ConfigKey下标存放预解析的值
+ * Immutable config snapshot, the pre-parsed values are stored by ConfigKey index
+ */
+class ConfigSnapshot {
+public:
+    using Ptr = std::shared_ptr<const ConfigSnapshot>;
+
+    ConfigSnapshot(uint64_t version, std::vector<ConfigValue> values) : _version(version), _values(std::move(values)) {}
+
+    /**
+     * 获取配置值，未知的句柄返回不存在的空值
+     * Get the config value, an unknown handle returns an empty non-existent value
+     */
+    const ConfigValue &operator[](ConfigKey key) const {
+        static const ConfigValue s_empty;
+        return key.index() < _values.size() ? _values[key.index()] : s_empty;
+    }
+
+    template<typename T>
+    auto get(ConfigKey key) const -> decltype(ConfigValue().as<T>()) {
+        return (*this)[key].template as<T>();
+    }
+
+    /**
+     * 快照版本号，每次发布加一
+     * Snapshot version, increased by one for every publish
+     */
+    uint64_t version() const { return _version; }
+
+private:
+    uint64_t _version;
+    std::vector<ConfigValue> _values;
+};
+
+/**
+ * 写时复制的配置存储
+ * 配置名在启动时intern为ConfigKey，发布时由mINI生成新的不可变快照并原子地替换，然后通知变化的配置项
+ * 读取方通过get()读取配置，热路径只有一次原子读，无锁、无引用计数操作(RCU风格，每个线程缓存自己的快照引用)；需要多次读取同一快照时用current()
+ * Copy-on-write config store
+ * Config names are interned as ConfigKey at startup, publishing builds a new immutable snapshot from mINI, swaps it in atomically and then notifies the changed items
+ * Readers read values with get(), the hot path is a single atomic load without locks or reference counting (RCU style, each thread caches its own snapshot reference); use current() to read several values from the same snapshot
+ */
+class ConfigStore {
+public:
+    using ChangedCB = std::function<void(const ConfigSnapshot::Ptr &snapshot, const std::vector<ConfigKey> &changed)>;
+
+    ConfigStore();
+    ConfigStore(const ConfigStore &) = delete;
+    ConfigStore &operator=(const ConfigStore &) = delete;
+
+    static ConfigStore &Instance();
+
+    /**
+     * 把配置名转换为句柄，同名返回相同句柄，应在启动时调用并保存结果
+     * 新配置名会触发一次以上次配置为源的重新发布，使其值在快照中可见
+     * Turn a config name into a handle, the same name returns the same handle, it should be called at startup and the result kept
+     * A new name triggers a republish from the last source so its value becomes visible in the snapshot
+     */
+    ConfigKey intern(const std::string &name);
+
+    /**
+     * 获取句柄对应的配置名
+     * Get the config name of a handle
+     */
+    std::string keyName(ConfigKey key) const;
+
+    /**
+     * 由配置发布新快照，配置值发生变化(含新增与删除)的句柄会通知给监听者
+     * 监听者在发布线程中被同步回调，回调中不可再调用publish()
+     * Publish a new snapshot from the config, the handles whose value changed (added and removed included) are notified to the listeners
+     * The listeners are called synchronously in the publishing thread and must not call publish() again
+     */
+    void publish(const mINI &ini);
+
+    /**
+     * 获取当前快照，从本线程缓存的快照复制共享指针，只比get()多一次引用计数操作
+     * 返回的快照可一直持有，期间的发布不影响它
+     * Get the current snapshot, the shared pointer is copied from the snapshot cached by this thread, costing only one reference count operation more than get()
+     * The returned snapshot can be held for as long as needed, later publishes do not affect it
+     */
+    ConfigSnapshot::Ptr current() const;
+
+    /**
+     * 获取当前快照的共享指针，不经过线程缓存
+     * Get a shared pointer to the current snapshot, bypassing the thread cache
+     */
+    ConfigSnapshot::Ptr snapshot() const;
+
+    /**
+     * 读取当前快照中的配置值，字符串按值返回，热路径只有一次原子读
+     * Read a config value from the current snapshot, strings are returned by value, the hot path is a single atomic load
+     */
+    template<typename T>
+    auto get(ConfigKey key) const -> typename std::decay<decltype(ConfigValue().as<T>())>::type {
+        return cached()->get<T>(key);
+    }
+
+    /**
+     * 添加/删除配置变化监听者
+     * @param tag 监听者标识
+     * Add/remove a config change listener
+     * @param tag Listener tag
+     */
+    void addListener(void *tag, ChangedCB cb);
+    void delListener(void *tag);
+
+private:
+    void publish_l(std::map<std::string, std::string> source);
+
+    // 本线程缓存的当前快照，返回的引用只在本线程下次刷新缓存前有效，仅供按值返回的get()内部使用
+    // Current snapshot cached by this thread, the returned reference is only valid until this thread refreshes the cache, for internal use by get() which returns by value
+    const ConfigSnapshot::Ptr &cached() const;
+
+private:
+    // 发布快照时的版本号，读取方以此判断缓存的快照是否过期
+    // Version of the published snapshot, readers use it to tell whether their cached snapshot is stale
+    std::atomic<uint64_t> _version { 0 };
+    ConfigSnapshot::Ptr _snapshot;
+
+    mutable std::recursive_mutex _mtx;
+    std::vector<std::string> _names;
+    std::unordered_map<std::string, ConfigKey> _keys;
+    std::map<std::string, std::string> _source;
+    std::unordered_map<void *, ChangedCB> _listeners;
+};
+
+} // namespace toolkit
+#endif // ZLTOOLKIT_CONFIGSNAPSHOT_H
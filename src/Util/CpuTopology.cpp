@@ -0,0 +1,320 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "CpuTopology.h"
+#include "File.h"
+#include "util.h"
+#include "logger.h"
+
+using namespace std;
+
+namespace toolkit {
+
+INSTANCE_IMP(CpuTopology)
+
+static string readSysFile(const string &path) {
+    ifstream in(path);
+    string ret;
+    getline(in, ret);
+    return trim(ret);
+}
+
+vector<int> CpuTopology::parseCpuList(const string &str) {
+    vector<int> ret;
+    for (auto &item : split(str, ",")) {
+        auto range = split(item, "-");
+        if (range.empty() || trim(range[0]).empty()) {
+            continue;
+        }
+        auto start = atoi(range[0].data());
+        auto end = range.size() > 1 ? atoi(range[1].data()) : start;
+        for (auto i = start; i <= end; ++i) {
+            ret.emplace_back(i);
+        }
+    }
+    return ret;
+}
+
+CpuTopology::CpuTopology() {
+    _cpu_count = std::max(1u, thread::hardware_concurrency());
+    _cpu_node.assign(_cpu_count, -1);
+#if defined(__linux__) || defined(__linux)
+    for (int node = 0;; ++node) {
+        auto cpus = readSysFile("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        if (cpus.empty()) {
+            break;
+        }
+        _node_cpus.emplace_back(parseCpuList(cpus));
+        for (auto cpu : _node_cpus.back()) {
+            if (cpu >= 0 && (size_t)cpu < _cpu_count) {
+                _cpu_node[cpu] = node;
+            }
+        }
+    }
+#endif
+    if (_node_cpus.empty()) {
+        // 无拓扑信息，所有cpu视为同一节点
+        // No topology information, treat all cpus as one node
+        _node_cpus.resize(1);
+        for (size_t cpu = 0; cpu < _cpu_count; ++cpu) {
+            _node_cpus[0].emplace_back((int)cpu);
+            _cpu_node[cpu] = 0;
+        }
+    }
+    InfoL << "numa nodes: " << _node_cpus.size() << ", cpus: " << _cpu_count;
+}
+
+size_t CpuTopology::getNodeCount() const {
+    return _node_cpus.size();
+}
+
+int CpuTopology::getNodeOfCpu(int cpu) const {
+    return cpu >= 0 && (size_t)cpu < _cpu_count ? _cpu_node[cpu] : -1;
+}
+
+vector<int> CpuTopology::getNicIrqCpus(const string &ifname) const {
+    vector<int> ret;
+#if defined(__linux__) || defined(__linux)
+    vector<int> irqs;
+    File::scanDir("/sys/class/net/" + ifname + "/device/msi_irqs", [&](const string &path, bool) {
+        auto pos = path.rfind('/');
+        irqs.emplace_back(atoi(path.data() + (pos == string::npos ? 0 : pos + 1)));
+        return true;
+    }, false);
+    std::sort(irqs.begin(), irqs.end());
+    for (auto irq : irqs) {
+        auto cpus = parseCpuList(readSysFile("/proc/irq/" + to_string(irq) + "/smp_affinity_list"));
+        // 只关心绑定到单个cpu的队列中断，绑定到多个cpu的一般为管理中断或未做绑定
+        // Only queue IRQs bound to a single cpu matter, those bound to many cpus are usually admin IRQs or not bound at all
+        if (cpus.size() == 1 && (size_t)cpus[0] < _cpu_count && std::find(ret.begin(), ret.end(), cpus[0]) == ret.end()) {
+            ret.emplace_back(cpus[0]);
+        }
+    }
+#endif
+    return ret;
+}
+
+vector<int> CpuTopology::getPlacement(size_t count, bool numa_aware, const string &nic) const {
+    vector<int> ret;
+    vector<bool> used(_cpu_count, false);
+    if (!nic.empty()) {
+        auto irq_cpus = getNicIrqCpus(nic);
+        if (irq_cpus.empty()) {
+            WarnL << "no irq affinity found for nic: " << nic;
+        }
+        for (auto cpu : irq_cpus) {
+            if (ret.size() == count) {
+                break;
+            }
+            ret.emplace_back(cpu);
+            used[cpu] = true;
+        }
+    }
+    if (!numa_aware || _node_cpus.size() == 1) {
+        for (size_t cpu = 0; ret.size() < count; cpu = (cpu + 1) % _cpu_count) {
+            if (!used[cpu] || std::all_of(used.begin(), used.end(), [](bool flag) { return flag; })) {
+                ret.emplace_back((int)cpu);
+                used[cpu] = true;
+            }
+        }
+        return ret;
+    }
+
+    // 各节点轮流分配，节点内按cpu顺序，cpu用尽后从头复用
+    // Assign to nodes in turn, by cpu order within a node, reuse from the beginning once cpus run out
+    vector<size_t> next(_node_cpus.size(), 0);
+    for (size_t i = 0; ret.size() < count; ++i) {
+        auto &cpus = _node_cpus[i % _node_cpus.size()];
+        auto &pos = next[i % _node_cpus.size()];
+        if (cpus.empty()) {
+            continue;
+        }
+        int cpu = cpus[pos % cpus.size()];
+        for (size_t n = 0; n < cpus.size() && used[cpu]; ++n) {
+            cpu = cpus[++pos % cpus.size()];
+        }
+        ++pos;
+        used[cpu] = true;
+        ret.emplace_back(cpu);
+        if (std::all_of(used.begin(), used.end(), [](bool flag) { return flag; })) {
+            used.assign(_cpu_count, false);
+        }
+    }
+    return ret;
+}
+
+static thread_local int s_current_node = -1;
+
+int CpuTopology::getCurrentNode() {
+    return s_current_node;
+}
+
+void CpuTopology::setCurrentNode(int node) {
+    s_current_node = node;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+// 分档为64字节到64KB的2的幂，更大的内存不缓存
+// Size classes are powers of 2 from 64 bytes to 64KB, larger blocks are not cached
+static constexpr size_t kMinClassShift = 6;
+static constexpr int kClassCount = 11;
+// 每个节点每档最多缓存的内存块个数
+// Maximum number of cached blocks per size class per node
+static constexpr size_t kMaxCachedBlocks = 256;
+// 每个线程每档最多缓存的内存块个数，以及与节点池一次交换的个数
+// Maximum number of cached blocks per size class per thread, and the number exchanged with the node pool at once
+static constexpr size_t kMaxThreadCachedBlocks = 32;
+static constexpr size_t kBatchBlocks = kMaxThreadCachedBlocks / 2;
+
+atomic<bool> NumaMemoryPool::s_enabled { false };
+// 线程局部缓存是否已析构，线程退出时其他线程局部对象仍可能释放内存
+// Whether the thread local cache is destroyed, other thread local objects may still free memory while the thread exits
+static thread_local bool s_thread_cache_destroyed = false;
+
+void NumaMemoryPool::enable(bool flag) {
+    s_enabled = flag;
+}
+
+struct NumaMemoryPool::ThreadCache {
+    int node = -1;
+    std::vector<Header *> free_list[kClassCount];
+
+    ~ThreadCache() {
+        flush();
+        s_thread_cache_destroyed = true;
+    }
+
+    // 线程退出或切换节点时，把缓存的内存块全部归还到所属节点池
+    // Return all cached blocks to their node pool when the thread exits or switches node
+    void flush() {
+        if (node < 0) {
+            return;
+        }
+        auto pool = getNodePool(node);
+        lock_guard<mutex> lck(pool->mtx);
+        for (int i = 0; i < kClassCount; ++i) {
+            for (auto header : free_list[i]) {
+                if (pool->free_list[i].size() < kMaxCachedBlocks) {
+                    pool->free_list[i].emplace_back(header);
+                } else {
+                    delete[] reinterpret_cast<char *>(header);
+                }
+            }
+            free_list[i].clear();
+        }
+    }
+};
+
+NumaMemoryPool::ThreadCache *NumaMemoryPool::getThreadCache(int node) {
+    if (s_thread_cache_destroyed) {
+        return nullptr;
+    }
+    static thread_local ThreadCache s_cache;
+    if (s_cache.node != node) {
+        s_cache.flush();
+        s_cache.node = node;
+    }
+    return &s_cache;
+}
+
+NumaMemoryPool::NodePool *NumaMemoryPool::getNodePool(int node) {
+    // 节点个数在运行期不变，池对象永不释放，避免退出时的析构顺序问题
+    // The number of nodes never changes at runtime, pools are never freed to avoid destruction order issues at exit
+    static vector<NodePool> *s_pools = new vector<NodePool>(CpuTopology::Instance().getNodeCount());
+    return node >= 0 && (size_t)node < s_pools->size() ? &(*s_pools)[node] : nullptr;
+}
+
+char *NumaMemoryPool::allocate(size_t size) {
+    if (!isEnabled()) {
+        return nullptr;
+    }
+    int node = CpuTopology::getCurrentNode();
+    if (!getNodePool(node)) {
+        return nullptr;
+    }
+    int size_class = -1;
+    for (int i = 0; i < kClassCount; ++i) {
+        if (size <= ((size_t)1 << (i + kMinClassShift))) {
+            size_class = i;
+            break;
+        }
+    }
+    if (size_class < 0) {
+        return nullptr;
+    }
+
+    if (auto cache = getThreadCache(node)) {
+        auto &list = cache->free_list[size_class];
+        if (list.empty()) {
+            // 线程缓存为空，加锁从节点池批量取一批
+            // The thread cache is empty, take a batch from the node pool under its lock
+            auto pool = getNodePool(node);
+            lock_guard<mutex> lck(pool->mtx);
+            auto &shared = pool->free_list[size_class];
+            auto count = std::min(shared.size(), kBatchBlocks);
+            list.insert(list.end(), shared.end() - count, shared.end());
+            shared.resize(shared.size() - count);
+        }
+        if (!list.empty()) {
+            auto header = list.back();
+            list.pop_back();
+            return reinterpret_cast<char *>(header + 1);
+        }
+    }
+    auto header = reinterpret_cast<Header *>(new char[sizeof(Header) + ((size_t)1 << (size_class + kMinClassShift))]);
+    header->node = node;
+    header->size_class = size_class;
+    return reinterpret_cast<char *>(header + 1);
+}
+
+void NumaMemoryPool::deallocate(char *ptr) {
+    if (!ptr) {
+        return;
+    }
+    auto header = reinterpret_cast<Header *>(ptr) - 1;
+    auto pool = getNodePool(header->node);
+    auto cache = header->node == CpuTopology::getCurrentNode() ? getThreadCache(header->node) : nullptr;
+    if (cache) {
+        auto &list = cache->free_list[header->size_class];
+        if (list.size() < kMaxThreadCachedBlocks) {
+            list.emplace_back(header);
+            return;
+        }
+        // 线程缓存已满，加锁把一批连同本块归还到节点池
+        // The thread cache is full, return a batch together with this block to the node pool under its lock
+        lock_guard<mutex> lck(pool->mtx);
+        auto &shared = pool->free_list[header->size_class];
+        for (size_t i = 0; i < kBatchBlocks && shared.size() < kMaxCachedBlocks; ++i) {
+            shared.emplace_back(list.back());
+            list.pop_back();
+        }
+        if (shared.size() < kMaxCachedBlocks) {
+            shared.emplace_back(header);
+            return;
+        }
+    } else {
+        // 其他节点的内存块(或线程缓存已析构时)直接归还到其节点池
+        // Blocks of other nodes (or any block once the thread cache is destroyed) go straight back to their node pool
+        lock_guard<mutex> lck(pool->mtx);
+        auto &shared = pool->free_list[header->size_class];
+        if (shared.size() < kMaxCachedBlocks) {
+            shared.emplace_back(header);
+            return;
+        }
+    }
+    delete[] reinterpret_cast<char *>(header);
+}
+
+} /* namespace toolkit */
@@ -0,0 +1,133 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_CPUTOPOLOGY_H
+#define ZLTOOLKIT_CPUTOPOLOGY_H
+
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace toolkit {
+
+/**
+ * cpu与NUMA节点拓扑，Linux下从/sys读取，其他平台视为只有一个节点
+ * CPU and NUMA node topology, read from /sys on Linux, other platforms are treated as a single node
+ */
+class CpuTopology {
+public:
+    ~CpuTopology() = default;
+
+    static CpuTopology &Instance();
+
+    /**
+     * NUMA节点个数，至少为1
+     * Number of NUMA nodes, at least 1
+     */
+    size_t getNodeCount() const;
+
+    /**
+     * 获取cpu所在的NUMA节点，未知时返回-1
+     * Get the NUMA node of a cpu, -1 if unknown
+     */
+    int getNodeOfCpu(int cpu) const;
+
+    /**
+     * 获取网卡RX队列中断被绑定的cpu列表(按中断号顺序去重)，读取失败返回空
+     * Get the cpus that the NIC RX queue IRQs are bound to (deduplicated, in IRQ order), empty on failure
+     */
+    std::vector<int> getNicIrqCpus(const std::string &ifname) const;
+
+    /**
+     * 为count个线程分配cpu
+     * 指定网卡时，前面的线程优先使用该网卡中断所在的cpu，使收包与处理在同一个cpu/节点；
+     * 开启numa_aware时，其余线程在各NUMA节点间轮流分配，否则按cpu序号分配
+     * Assign cpus to count threads
+     * When a NIC is given, the first threads prefer the cpus its IRQs are bound to, so receiving and processing happen on the same cpu/node;
+     * When numa_aware is enabled, the other threads are assigned to NUMA nodes in turn, otherwise by cpu index
+     */
+    std::vector<int> getPlacement(size_t count, bool numa_aware, const std::string &nic = "") const;
+
+    /**
+     * 当前线程所在的NUMA节点，由EventPoller绑定cpu后设置，未设置时为-1
+     * NUMA node of the current thread, set after an EventPoller binds its cpu, -1 if not set
+     */
+    static int getCurrentNode();
+    static void setCurrentNode(int node);
+
+    /**
+     * 解析"0-3,8,10-11"格式的cpu列表
+     * Parse a cpu list in "0-3,8,10-11" format
+     */
+    static std::vector<int> parseCpuList(const std::string &str);
+
+private:
+    CpuTopology();
+
+private:
+    size_t _cpu_count;
+    std::vector<int> _cpu_node;
+    std::vector<std::vector<int> > _node_cpus;
+};
+
+/**
+ * 按NUMA节点划分的内存池，从当前线程所在节点的池中分配，释放时归还到分配时的节点
+ * 池中的内存由该节点的线程首次写入，依据Linux的first-touch策略，物理页位于该节点上
+ * 每个线程先使用自己的线程局部缓存，缓存为空或已满时才加锁与节点池批量交换内存块
+ * Memory pool partitioned by NUMA node, allocating from the pool of the current thread's node and returning to the original node on release
+ * Memory in the pool is first written by threads of that node, so by Linux's first-touch policy its physical pages live on that node
+ * Each thread uses its own thread local cache first, and only locks the node pool to exchange a batch of blocks when the cache is empty or full
+ */
+class NumaMemoryPool {
+public:
+    static void enable(bool flag);
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * 从当前线程所在节点的池中分配
+     * 未开启、当前线程无节点信息或大小超过最大分档时返回nullptr，由调用者自行new[]，此时没有任何额外开销
+     * Allocate from the pool of the current thread's node
+     * Returns nullptr when not enabled, when the current thread has no node information or when the size exceeds the largest class, the caller then uses new[] at no extra cost
+     */
+    static char *allocate(size_t size);
+
+    /**
+     * 归还allocate返回的非空内存
+     * Return a non-null block returned by allocate
+     */
+    static void deallocate(char *ptr);
+
+private:
+    // 内存块头部，记录所属节点与分档，对齐到16字节以保证数据对齐
+    // Block header, recording the owning node and size class, aligned to 16 bytes to keep the data aligned
+    struct alignas(16) Header {
+        int node;
+        int size_class;
+    };
+
+    struct NodePool {
+        std::mutex mtx;
+        std::vector<Header *> free_list[11];
+    };
+
+    struct ThreadCache;
+
+    static NodePool *getNodePool(int node);
+    static ThreadCache *getThreadCache(int node);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+} /* namespace toolkit */
+#endif // ZLTOOLKIT_CPUTOPOLOGY_H
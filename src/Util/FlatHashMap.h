@@ -0,0 +1,519 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_FLATHASHMAP_H
+#define ZLTOOLKIT_FLATHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ZLTOOLKIT_FLAT_HASH_SSE2
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace toolkit {
+
+namespace flat_hash {
+
+using ctrl_t = int8_t;
+
+// 控制字节: 空槽位、已删除槽位；已占用槽位保存哈希值低7位(>= 0)
+// Control bytes: empty slot, deleted slot; occupied slots store the low 7 bits of the hash (>= 0)
+static constexpr ctrl_t kEmpty = -128;
+static constexpr ctrl_t kDeleted = -2;
+// 每次探测比较的槽位个数
+// Number of slots compared per probe
+static constexpr size_t kGroupWidth = 16;
+
+inline uint32_t countTrailingZeros(uint32_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+/**
+ * 一组(16个)控制字节，x86下通过SSE2一次比较整组，其他平台退化为逐字节比较
+ * A group of 16 control bytes, compared at once with SSE2 on x86, falls back to byte-by-byte comparison on other platforms
+ */
+class Group {
+public:
+    explicit Group(const ctrl_t *pos) {
+#if defined(ZLTOOLKIT_FLAT_HASH_SSE2)
+        _ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+#else
+        memcpy(_ctrl, pos, kGroupWidth);
+#endif
+    }
+
+    // 返回与h2相等的槽位位图
+    // Returns a bitmap of the slots equal to h2
+    uint32_t match(ctrl_t h2) const {
+#if defined(ZLTOOLKIT_FLAT_HASH_SSE2)
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl)));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kGroupWidth; ++i) {
+            mask |= static_cast<uint32_t>(_ctrl[i] == h2) << i;
+        }
+        return mask;
+#endif
+    }
+
+    uint32_t matchEmpty() const { return match(kEmpty); }
+
+    // 空槽位与已删除槽位的最高位都为1
+    // Both empty and deleted slots have the highest bit set
+    uint32_t matchEmptyOrDeleted() const {
+#if defined(ZLTOOLKIT_FLAT_HASH_SSE2)
+        return static_cast<uint32_t>(_mm_movemask_epi8(_ctrl));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kGroupWidth; ++i) {
+            mask |= static_cast<uint32_t>(_ctrl[i] < 0) << i;
+        }
+        return mask;
+#endif
+    }
+
+private:
+#if defined(ZLTOOLKIT_FLAT_HASH_SSE2)
+    __m128i _ctrl;
+#else
+    ctrl_t _ctrl[kGroupWidth];
+#endif
+};
+
+} // namespace flat_hash
+
+/**
+ * 开放寻址的扁平哈希表(SwissTable风格)
+ * 元素连续存放，无每元素节点分配；查找时按16个槽位为一组，通过SIMD一次比较一组控制字节
+ * 接口为std::unordered_map的常用子集；插入可能导致重新哈希，使迭代器与元素引用失效；删除不会移动其他元素
+ * Open addressing flat hash map (SwissTable style)
+ * Elements are stored contiguously without per-element node allocation; lookups probe groups of 16 slots, comparing a whole group of control bytes at once with SIMD
+ * The interface is a commonly used subset of std::unordered_map; insertion may rehash and invalidate iterators and element references; erasure never moves other elements
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<const Key, Value>;
+    using size_type = size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+
+    template <bool IsConst>
+    class IteratorImp {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = typename std::conditional<IsConst, const value_type *, value_type *>::type;
+        using reference = typename std::conditional<IsConst, const value_type &, value_type &>::type;
+
+        IteratorImp() = default;
+
+        // iterator可隐式转换为const_iterator
+        // iterator is implicitly convertible to const_iterator
+        template <bool C = IsConst, typename = typename std::enable_if<C>::type>
+        IteratorImp(const IteratorImp<false> &that)
+            : _ctrl(that._ctrl)
+            , _end(that._end)
+            , _slot(that._slot) {}
+
+        reference operator*() const { return *_slot; }
+        pointer operator->() const { return _slot; }
+
+        IteratorImp &operator++() {
+            ++_ctrl;
+            ++_slot;
+            skipEmpty();
+            return *this;
+        }
+
+        IteratorImp operator++(int) {
+            auto ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const IteratorImp &that) const { return _ctrl == that._ctrl; }
+        bool operator!=(const IteratorImp &that) const { return _ctrl != that._ctrl; }
+
+    private:
+        friend class FlatHashMap;
+        template <bool>
+        friend class IteratorImp;
+
+        IteratorImp(const flat_hash::ctrl_t *ctrl, const flat_hash::ctrl_t *end, pointer slot)
+            : _ctrl(ctrl)
+            , _end(end)
+            , _slot(slot) {
+            skipEmpty();
+        }
+
+        void skipEmpty() {
+            while (_ctrl != _end && *_ctrl < 0) {
+                ++_ctrl;
+                ++_slot;
+            }
+        }
+
+    private:
+        const flat_hash::ctrl_t *_ctrl = nullptr;
+        const flat_hash::ctrl_t *_end = nullptr;
+        pointer _slot = nullptr;
+    };
+
+    using iterator = IteratorImp<false>;
+    using const_iterator = IteratorImp<true>;
+
+    FlatHashMap() = default;
+
+    explicit FlatHashMap(size_t bucket_count, const Hash &hash = Hash(), const KeyEqual &equal = KeyEqual())
+        : _hash(hash)
+        , _equal(equal) {
+        reserve(bucket_count);
+    }
+
+    FlatHashMap(const FlatHashMap &that)
+        : _hash(that._hash)
+        , _equal(that._equal) {
+        reserve(that.size());
+        for (auto &pr : that) {
+            insertUnique(hashOf(pr.first), pr);
+        }
+    }
+
+    FlatHashMap(FlatHashMap &&that) noexcept
+        : _hash(std::move(that._hash))
+        , _equal(std::move(that._equal)) {
+        swapData(that);
+    }
+
+    FlatHashMap &operator=(const FlatHashMap &that) {
+        if (this != &that) {
+            FlatHashMap tmp(that);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    FlatHashMap &operator=(FlatHashMap &&that) noexcept {
+        if (this != &that) {
+            destroy();
+            _hash = std::move(that._hash);
+            _equal = std::move(that._equal);
+            swapData(that);
+        }
+        return *this;
+    }
+
+    ~FlatHashMap() { destroy(); }
+
+    iterator begin() { return iterator(_ctrl, _ctrl + _capacity, _slots); }
+    iterator end() { return iterator(_ctrl + _capacity, _ctrl + _capacity, _slots + _capacity); }
+    const_iterator begin() const { return const_iterator(_ctrl, _ctrl + _capacity, _slots); }
+    const_iterator end() const { return const_iterator(_ctrl + _capacity, _ctrl + _capacity, _slots + _capacity); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    size_t capacity() const { return _capacity; }
+
+    void swap(FlatHashMap &that) noexcept {
+        std::swap(_hash, that._hash);
+        std::swap(_equal, that._equal);
+        swapData(that);
+    }
+
+    void clear() {
+        if (!_size) {
+            return;
+        }
+        destroySlots();
+        resetCtrl();
+    }
+
+    /**
+     * 预留空间，保证插入n个元素前不会重新哈希
+     * Reserve space so that no rehash happens before n elements are inserted
+     */
+    void reserve(size_t n) {
+        auto cap = capacityFor(n);
+        if (cap > _capacity) {
+            resize(cap);
+        }
+    }
+
+    iterator find(const Key &key) {
+        auto index = findIndex(key, hashOf(key));
+        return index == npos ? end() : iteratorAt(index);
+    }
+
+    const_iterator find(const Key &key) const {
+        auto index = findIndex(key, hashOf(key));
+        return index == npos ? end() : const_iterator(_ctrl + index, _ctrl + _capacity, _slots + index);
+    }
+
+    size_t count(const Key &key) const { return findIndex(key, hashOf(key)) == npos ? 0 : 1; }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(const Key &key, Args &&...args) {
+        return emplace_l(key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Key &&key, Args &&...args) {
+        return emplace_l(std::move(key), std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key &key, Args &&...args) {
+        return emplace_l(key, std::forward<Args>(args)...);
+    }
+
+    std::pair<iterator, bool> insert(const value_type &value) { return emplace_l(value.first, value.second); }
+
+    Value &operator[](const Key &key) { return emplace_l(key).first->second; }
+
+    size_t erase(const Key &key) {
+        auto index = findIndex(key, hashOf(key));
+        if (index == npos) {
+            return 0;
+        }
+        eraseAt(index);
+        return 1;
+    }
+
+    // 返回被删除元素的下一个元素
+    // Returns the element following the erased one
+    iterator erase(const_iterator it) {
+        auto index = static_cast<size_t>(it._ctrl - _ctrl);
+        eraseAt(index);
+        // 该槽位已不再被占用，构造迭代器时会自动跳到下一个元素
+        // The slot is no longer occupied, constructing the iterator skips to the next element
+        return iteratorAt(index);
+    }
+
+    iterator erase(iterator it) { return erase(const_iterator(it)); }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> emplace_l(K &&key, Args &&...args) {
+        auto hash = hashOf(key);
+        auto index = findIndex(key, hash);
+        if (index != npos) {
+            return std::make_pair(iteratorAt(index), false);
+        }
+        index = prepareInsert(hash);
+        new (_slots + index) value_type(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+        return std::make_pair(iteratorAt(index), true);
+    }
+
+    void insertUnique(size_t hash, const value_type &value) {
+        auto index = prepareInsert(hash);
+        new (_slots + index) value_type(value);
+    }
+
+    // 混合用户哈希值，避免std::hash对整数是恒等映射导致低位分布差
+    // Mix the user hash value, since std::hash is the identity function for integers and gives poorly distributed low bits
+    size_t hashOf(const Key &key) const {
+        auto hash = static_cast<uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+
+    static flat_hash::ctrl_t H2(size_t hash) { return static_cast<flat_hash::ctrl_t>(hash & 0x7F); }
+    size_t firstGroup(size_t hash) const { return (hash >> 7) & groupMask(); }
+    size_t groupMask() const { return _capacity / flat_hash::kGroupWidth - 1; }
+
+    // 最大负载因子为7/8
+    // The max load factor is 7/8
+    static size_t growthOf(size_t capacity) { return capacity - capacity / 8; }
+
+    static size_t capacityFor(size_t n) {
+        if (!n) {
+            return 0;
+        }
+        size_t cap = flat_hash::kGroupWidth;
+        while (growthOf(cap) < n) {
+            cap <<= 1;
+        }
+        return cap;
+    }
+
+    iterator iteratorAt(size_t index) { return iterator(_ctrl + index, _ctrl + _capacity, _slots + index); }
+
+    size_t findIndex(const Key &key, size_t hash) const {
+        if (!_capacity) {
+            return npos;
+        }
+        auto h2 = H2(hash);
+        auto group = firstGroup(hash);
+        // 按组进行三角数探测，组数为2的幂次方时可以遍历到所有组
+        // Triangular probing over groups, which visits every group since the group count is a power of 2
+        for (size_t step = 1;; ++step) {
+            auto base = group * flat_hash::kGroupWidth;
+            flat_hash::Group g(_ctrl + base);
+            for (auto mask = g.match(h2); mask; mask &= mask - 1) {
+                auto index = base + flat_hash::countTrailingZeros(mask);
+                if (_equal(_slots[index].first, key)) {
+                    return index;
+                }
+            }
+            if (g.matchEmpty()) {
+                return npos;
+            }
+            group = (group + step) & groupMask();
+        }
+    }
+
+    size_t findFirstNonFull(size_t hash) const {
+        auto group = firstGroup(hash);
+        for (size_t step = 1;; ++step) {
+            auto base = group * flat_hash::kGroupWidth;
+            auto mask = flat_hash::Group(_ctrl + base).matchEmptyOrDeleted();
+            if (mask) {
+                return base + flat_hash::countTrailingZeros(mask);
+            }
+            group = (group + step) & groupMask();
+        }
+    }
+
+    size_t prepareInsert(size_t hash) {
+        if (!_capacity) {
+            resize(flat_hash::kGroupWidth);
+        }
+        auto index = findFirstNonFull(hash);
+        if (!_growth_left && _ctrl[index] != flat_hash::kDeleted) {
+            // 已删除槽位较多时原地重建以清理墓碑，否则扩容一倍
+            // Rebuild in place to clear tombstones when there are many deleted slots, otherwise double the capacity
+            resize(_size * 2 <= growthOf(_capacity) ? _capacity : _capacity * 2);
+            index = findFirstNonFull(hash);
+        }
+        if (_ctrl[index] == flat_hash::kEmpty) {
+            --_growth_left;
+        }
+        _ctrl[index] = H2(hash);
+        ++_size;
+        return index;
+    }
+
+    void eraseAt(size_t index) {
+        _slots[index].~value_type();
+        --_size;
+        // 所在组内已有空槽位时，探测必然在该组终止，可以直接置为空槽位而无需留下墓碑
+        // If the group already has an empty slot, probing always stops at this group, so the slot can be marked empty instead of leaving a tombstone
+        auto base = index & ~(flat_hash::kGroupWidth - 1);
+        if (flat_hash::Group(_ctrl + base).matchEmpty()) {
+            _ctrl[index] = flat_hash::kEmpty;
+            ++_growth_left;
+        } else {
+            _ctrl[index] = flat_hash::kDeleted;
+        }
+    }
+
+    void resize(size_t new_capacity) {
+        auto old_ctrl = _ctrl;
+        auto old_slots = _slots;
+        auto old_capacity = _capacity;
+        auto old_size = _size;
+
+        _ctrl = new flat_hash::ctrl_t[new_capacity];
+        _slots = static_cast<value_type *>(::operator new(sizeof(value_type) * new_capacity));
+        _capacity = new_capacity;
+        resetCtrl();
+        _size = old_size;
+        _growth_left -= old_size;
+
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_ctrl[i] < 0) {
+                continue;
+            }
+            auto hash = hashOf(old_slots[i].first);
+            auto index = findFirstNonFull(hash);
+            _ctrl[index] = H2(hash);
+            new (_slots + index) value_type(std::move(old_slots[i]));
+            old_slots[i].~value_type();
+        }
+        delete[] old_ctrl;
+        ::operator delete(old_slots);
+    }
+
+    void resetCtrl() {
+        if (_capacity) {
+            memset(_ctrl, flat_hash::kEmpty, _capacity);
+        }
+        _size = 0;
+        _growth_left = growthOf(_capacity);
+    }
+
+    void destroySlots() {
+        for (size_t i = 0; i < _capacity; ++i) {
+            if (_ctrl[i] >= 0) {
+                _slots[i].~value_type();
+            }
+        }
+    }
+
+    void destroy() {
+        if (!_capacity) {
+            return;
+        }
+        destroySlots();
+        delete[] _ctrl;
+        ::operator delete(_slots);
+        _ctrl = nullptr;
+        _slots = nullptr;
+        _capacity = 0;
+        _size = 0;
+        _growth_left = 0;
+    }
+
+    void swapData(FlatHashMap &that) noexcept {
+        std::swap(_ctrl, that._ctrl);
+        std::swap(_slots, that._slots);
+        std::swap(_capacity, that._capacity);
+        std::swap(_size, that._size);
+        std::swap(_growth_left, that._growth_left);
+    }
+
+private:
+    flat_hash::ctrl_t *_ctrl = nullptr;
+    value_type *_slots = nullptr;
+    size_t _capacity = 0;
+    size_t _size = 0;
+    size_t _growth_left = 0;
+    Hash _hash;
+    KeyEqual _equal;
+};
+
+} // namespace toolkit
+#endif // ZLTOOLKIT_FLATHASHMAP_H
@@ -0,0 +1,125 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cstdio>
+#include "LatencyHistogram.h"
+
+using namespace std;
+
+namespace toolkit {
+
+static inline uint32_t highestBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    uint32_t ret = 0;
+    while (value >>= 1) {
+        ++ret;
+    }
+    return ret;
+#endif
+}
+
+uint32_t LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < 2 * kSubBucketCount) {
+        return (uint32_t)value;
+    }
+    auto bits = highestBit(value);
+    if (bits > kMaxBits) {
+        return kBucketCount - 1;
+    }
+    auto shift = bits - kSubBucketBits;
+    return kSubBucketCount * shift + (uint32_t)(value >> shift);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(uint32_t index) {
+    if (index < 2 * kSubBucketCount) {
+        return index;
+    }
+    auto shift = index / kSubBucketCount - 1;
+    uint64_t mantissa = index - kSubBucketCount * shift;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+LatencyHistogram::LatencyHistogram() {
+    for (auto &bucket : _buckets) {
+        bucket.store(0, memory_order_relaxed);
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot(bool reset) {
+    Snapshot ret;
+    for (uint32_t i = 0; i < kBucketCount; ++i) {
+        ret._buckets[i] = reset ? _buckets[i].exchange(0, memory_order_relaxed) : _buckets[i].load(memory_order_relaxed);
+        ret._count += ret._buckets[i];
+    }
+    ret._sum = reset ? _sum.exchange(0, memory_order_relaxed) : _sum.load(memory_order_relaxed);
+    ret._max = reset ? _max.exchange(0, memory_order_relaxed) : _max.load(memory_order_relaxed);
+    return ret;
+}
+
+LatencyHistogram::Snapshot::Snapshot() : _buckets(kBucketCount, 0) {}
+
+void LatencyHistogram::Snapshot::merge(const Snapshot &that) {
+    for (uint32_t i = 0; i < kBucketCount; ++i) {
+        _buckets[i] += that._buckets[i];
+    }
+    _count += that._count;
+    _sum += that._sum;
+    if (that._max > _max) {
+        _max = that._max;
+    }
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double percent) const {
+    if (!_count) {
+        return 0;
+    }
+    auto target = (uint64_t)(percent / 100 * _count + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < kBucketCount; ++i) {
+        sum += _buckets[i];
+        if (sum >= target) {
+            auto ret = bucketUpperBound(i);
+            return ret < _max ? ret : _max;
+        }
+    }
+    return _max;
+}
+
+static string formatDuration(uint64_t nanosec) {
+    char buf[32];
+    if (nanosec < 1000) {
+        snprintf(buf, sizeof(buf), "%uns", (unsigned)nanosec);
+    } else if (nanosec < 1000 * 1000) {
+        snprintf(buf, sizeof(buf), "%.1fus", nanosec / 1000.0);
+    } else if (nanosec < 1000 * 1000 * 1000) {
+        snprintf(buf, sizeof(buf), "%.2fms", nanosec / 1000000.0);
+    } else {
+        snprintf(buf, sizeof(buf), "%.2fs", nanosec / 1000000000.0);
+    }
+    return buf;
+}
+
+string LatencyHistogram::Snapshot::toString() const {
+    string ret = "count:" + to_string(_count);
+    ret += " mean:" + formatDuration(mean());
+    ret += " p50:" + formatDuration(percentile(50));
+    ret += " p90:" + formatDuration(percentile(90));
+    ret += " p99:" + formatDuration(percentile(99));
+    ret += " p999:" + formatDuration(percentile(99.9));
+    ret += " max:" + formatDuration(_max);
+    return ret;
+}
+
+} // namespace toolkit
@@ -0,0 +1,127 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_LATENCYHISTOGRAM_H
+#define ZLTOOLKIT_LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace toolkit {
+
+/**
+ * 无锁延时直方图(HDR风格的对数分桶)，单位纳秒
+ * 每个2的幂区间再等分16档，相对误差不超过1/16，记录时只有几次relaxed原子操作，可在多个线程同时记录
+ * Lock-free latency histogram (HDR style logarithmic buckets), in nanoseconds
+ * Each power of two range is split into 16 sub buckets, the relative error is at most 1/16, recording only takes a few relaxed atomic operations and is safe from multiple threads
+ */
+class LatencyHistogram {
+public:
+    enum : uint32_t {
+        // 每个2的幂区间的分档数为2^kSubBucketBits
+        // Each power of two range has 2^kSubBucketBits sub buckets
+        kSubBucketBits = 4,
+        // 可区分的最大值为2^kMaxBits纳秒(约18分钟)，更大的值计入最后一档
+        // The largest distinguishable value is 2^kMaxBits nanoseconds (about 18 minutes), larger values go to the last bucket
+        kMaxBits = 40,
+        kSubBucketCount = 1 << kSubBucketBits,
+        kBucketCount = kSubBucketCount * (kMaxBits - kSubBucketBits + 2)
+    };
+
+    /**
+     * 直方图快照，可合并多个快照(例如所有poller)后再计算分位数
+     * Histogram snapshot, several snapshots (of all pollers for example) can be merged before computing percentiles
+     */
+    class Snapshot {
+    public:
+        Snapshot();
+
+        void merge(const Snapshot &that);
+
+        uint64_t count() const { return _count; }
+        uint64_t max() const { return _max; }
+        uint64_t mean() const { return _count ? _sum / _count : 0; }
+
+        /**
+         * 获取分位数，返回所在分档的上界(不超过最大值)
+         * @param percent 百分比，范围[0, 100]
+         * Get the percentile, returns the upper bound of its bucket (not above the max value)
+         * @param percent Percentage in [0, 100]
+         */
+        uint64_t percentile(double percent) const;
+
+        /**
+         * 格式化为 count/mean/p50/p90/p99/p999/max
+         * Format as count/mean/p50/p90/p99/p999/max
+         */
+        std::string toString() const;
+
+    private:
+        friend class LatencyHistogram;
+        uint64_t _count = 0;
+        uint64_t _sum = 0;
+        uint64_t _max = 0;
+        std::vector<uint64_t> _buckets;
+    };
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    /**
+     * 记录一次耗时
+     * @param nanosec 耗时，单位纳秒
+     * Record a duration
+     * @param nanosec Duration in nanoseconds
+     */
+    void record(uint64_t nanosec) {
+        _buckets[bucketIndex(nanosec)].fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(nanosec, std::memory_order_relaxed);
+        auto max = _max.load(std::memory_order_relaxed);
+        while (nanosec > max && !_max.compare_exchange_weak(max, nanosec, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * 获取快照
+     * @param reset 获取后是否清零
+     * Get a snapshot
+     * @param reset Whether to reset after reading
+     */
+    Snapshot snapshot(bool reset = false);
+
+    /**
+     * 计时用的单调时钟，单位纳秒
+     * Monotonic clock for timing, in nanoseconds
+     */
+    static uint64_t now() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static uint32_t bucketIndex(uint64_t value);
+
+    /**
+     * 分档所能表示的最大值
+     * The largest value a bucket represents
+     */
+    static uint64_t bucketUpperBound(uint32_t index);
+
+private:
+    std::atomic<uint64_t> _sum { 0 };
+    std::atomic<uint64_t> _max { 0 };
+    std::atomic<uint64_t> _buckets[kBucketCount];
+};
+
+} // namespace toolkit
+#endif // ZLTOOLKIT_LATENCYHISTOGRAM_H
@@ -35,10 +35,16 @@ documentation and/or software.
 
 /* interface header */
 #include "MD5.h"
+#include "Network/Buffer.h"
 /* system implementation headers */
 #include <cstdio>
 #include <cstring>
 
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MD5_MULTI_BUFFER 1
+#include <immintrin.h>
+#endif
+
 namespace toolkit {
 
 // Constants for MD5Transform routine.
@@ -295,6 +301,18 @@ void MD5::update(const char input[], size_type length)
     update((const unsigned char*)input, length);
 }
 
+
+void MD5::update(const Buffer &buf)
+{
+    if (auto chain = buf.getChain()) {
+        for (auto &slice : chain->slices()) {
+            update(slice.buffer->data() + slice.offset, slice.size);
+        }
+        return;
+    }
+    update(buf.data(), buf.size());
+}
+
 //////////////////////////////
 
 // MD5 finalization. Ends an MD5 message-digest operation, writing the
@@ -356,6 +374,234 @@ std::string MD5::rawdigest() const{
 
 //////////////////////////////
 
+#if defined(MD5_MULTI_BUFFER)
+
+/*
+ * 多路MD5：每个SIMD通道独立计算一个消息，64步运算与标量实现相同
+ * Multi-buffer MD5: every SIMD lane hashes its own message, the 64 steps are the same as the scalar implementation
+ */
+
+// 每步使用的消息字下标、循环左移位数与常量
+// Message word index, left rotation and constant of each step
+static const uint8_t s_md5_index[64] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    1, 6, 11, 0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12,
+    5, 8, 11, 14, 1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15, 2,
+    0, 7, 14, 5, 12, 3, 10, 1, 8, 15, 6, 13, 4, 11, 2, 9
+};
+
+static const uint8_t s_md5_shift[64] = {
+    S11, S12, S13, S14, S11, S12, S13, S14, S11, S12, S13, S14, S11, S12, S13, S14,
+    S21, S22, S23, S24, S21, S22, S23, S24, S21, S22, S23, S24, S21, S22, S23, S24,
+    S31, S32, S33, S34, S31, S32, S33, S34, S31, S32, S33, S34, S31, S32, S33, S34,
+    S41, S42, S43, S44, S41, S42, S43, S44, S41, S42, S43, S44, S41, S42, S43, S44
+};
+
+static const uint32_t s_md5_const[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+#define MD5_LANE_STEP(FUNC, ADD, SET1, OR, SLL, SRL, CVT, LOAD) \
+    for (; i < end; ++i) { \
+        auto t = ADD(ADD(a, FUNC), ADD(SET1((int)s_md5_const[i]), LOAD(words[s_md5_index[i]]))); \
+        t = OR(SLL(t, CVT(s_md5_shift[i])), SRL(t, CVT(32 - s_md5_shift[i]))); \
+        a = d; d = c; c = b; b = ADD(b, t); \
+    }
+
+// state[4][N]与words[16][N]为按通道转置后的状态与消息字
+// state[4][N] and words[16][N] are the state and message words transposed by lane
+__attribute__((target("sse2"))) static void md5CompressSse2(uint32_t state[4][4], const uint32_t words[16][4]) {
+#define LOAD128(p) _mm_loadu_si128((const __m128i *)(p))
+    auto a = LOAD128(state[0]), b = LOAD128(state[1]), c = LOAD128(state[2]), d = LOAD128(state[3]);
+    auto aa = a, bb = b, cc = c, dd = d;
+    auto ones = _mm_set1_epi32(-1);
+    int i = 0, end = 16;
+    MD5_LANE_STEP(_mm_or_si128(_mm_and_si128(b, c), _mm_andnot_si128(b, d)), _mm_add_epi32, _mm_set1_epi32, _mm_or_si128, _mm_sll_epi32, _mm_srl_epi32, _mm_cvtsi32_si128, LOAD128)
+    end = 32;
+    MD5_LANE_STEP(_mm_or_si128(_mm_and_si128(b, d), _mm_andnot_si128(d, c)), _mm_add_epi32, _mm_set1_epi32, _mm_or_si128, _mm_sll_epi32, _mm_srl_epi32, _mm_cvtsi32_si128, LOAD128)
+    end = 48;
+    MD5_LANE_STEP(_mm_xor_si128(_mm_xor_si128(b, c), d), _mm_add_epi32, _mm_set1_epi32, _mm_or_si128, _mm_sll_epi32, _mm_srl_epi32, _mm_cvtsi32_si128, LOAD128)
+    end = 64;
+    MD5_LANE_STEP(_mm_xor_si128(c, _mm_or_si128(b, _mm_xor_si128(d, ones))), _mm_add_epi32, _mm_set1_epi32, _mm_or_si128, _mm_sll_epi32, _mm_srl_epi32, _mm_cvtsi32_si128, LOAD128)
+    _mm_storeu_si128((__m128i *)state[0], _mm_add_epi32(a, aa));
+    _mm_storeu_si128((__m128i *)state[1], _mm_add_epi32(b, bb));
+    _mm_storeu_si128((__m128i *)state[2], _mm_add_epi32(c, cc));
+    _mm_storeu_si128((__m128i *)state[3], _mm_add_epi32(d, dd));
+#undef LOAD128
+}
+
+__attribute__((target("avx2"))) static void md5CompressAvx2(uint32_t state[4][8], const uint32_t words[16][8]) {
+#define LOAD256(p) _mm256_loadu_si256((const __m256i *)(p))
+    auto a = LOAD256(state[0]), b = LOAD256(state[1]), c = LOAD256(state[2]), d = LOAD256(state[3]);
+    auto aa = a, bb = b, cc = c, dd = d;
+    auto ones = _mm256_set1_epi32(-1);
+    int i = 0, end = 16;
+    MD5_LANE_STEP(_mm256_or_si256(_mm256_and_si256(b, c), _mm256_andnot_si256(b, d)), _mm256_add_epi32, _mm256_set1_epi32, _mm256_or_si256, _mm256_sll_epi32, _mm256_srl_epi32, _mm_cvtsi32_si128, LOAD256)
+    end = 32;
+    MD5_LANE_STEP(_mm256_or_si256(_mm256_and_si256(b, d), _mm256_andnot_si256(d, c)), _mm256_add_epi32, _mm256_set1_epi32, _mm256_or_si256, _mm256_sll_epi32, _mm256_srl_epi32, _mm_cvtsi32_si128, LOAD256)
+    end = 48;
+    MD5_LANE_STEP(_mm256_xor_si256(_mm256_xor_si256(b, c), d), _mm256_add_epi32, _mm256_set1_epi32, _mm256_or_si256, _mm256_sll_epi32, _mm256_srl_epi32, _mm_cvtsi32_si128, LOAD256)
+    end = 64;
+    MD5_LANE_STEP(_mm256_xor_si256(c, _mm256_or_si256(b, _mm256_xor_si256(d, ones))), _mm256_add_epi32, _mm256_set1_epi32, _mm256_or_si256, _mm256_sll_epi32, _mm256_srl_epi32, _mm_cvtsi32_si128, LOAD256)
+    _mm256_storeu_si256((__m256i *)state[0], _mm256_add_epi32(a, aa));
+    _mm256_storeu_si256((__m256i *)state[1], _mm256_add_epi32(b, bb));
+    _mm256_storeu_si256((__m256i *)state[2], _mm256_add_epi32(c, cc));
+    _mm256_storeu_si256((__m256i *)state[3], _mm256_add_epi32(d, dd));
+#undef LOAD256
+}
+
+#undef MD5_LANE_STEP
+
+/*
+ * 通道调度：每个通道依次取出消息的64字节块(最后1~2块为补齐后的尾部)，消息结束后输出摘要并换入下一个消息
+ * Lane scheduling: every lane takes the 64 byte blocks of its message in turn (the last 1~2 blocks are the padded tail), outputs the digest when the message ends and switches to the next message
+ */
+template <size_t N>
+static void md5Lanes(const char *const data[], const size_t sizes[], size_t count, uint8_t digests[][16],
+                     void (*compress)(uint32_t state[4][N], const uint32_t words[16][N])) {
+    struct Lane {
+        bool active = false;
+        size_t msg = 0;
+        size_t block = 0;
+        size_t full_blocks = 0;
+        size_t total_blocks = 0;
+        uint8_t tail[128];
+    };
+    Lane lanes[N];
+    uint32_t state[4][N];
+    uint32_t words[16][N] = {};
+    size_t next = 0;
+
+    auto assign = [&](size_t j) {
+        auto &lane = lanes[j];
+        if (next >= count) {
+            lane.active = false;
+            return;
+        }
+        lane.active = true;
+        lane.msg = next++;
+        lane.block = 0;
+        auto size = sizes[lane.msg];
+        lane.full_blocks = size / 64;
+        auto remain = size % 64;
+        auto tail_size = remain < 56 ? 64 : 128;
+        memcpy(lane.tail, data[lane.msg] + lane.full_blocks * 64, remain);
+        lane.tail[remain] = 0x80;
+        memset(lane.tail + remain + 1, 0, tail_size - remain - 1);
+        uint64_t bits = (uint64_t)size * 8;
+        for (int k = 0; k < 8; ++k) {
+            lane.tail[tail_size - 8 + k] = (uint8_t)(bits >> (8 * k));
+        }
+        lane.total_blocks = lane.full_blocks + tail_size / 64;
+        state[0][j] = 0x67452301;
+        state[1][j] = 0xefcdab89;
+        state[2][j] = 0x98badcfe;
+        state[3][j] = 0x10325476;
+    };
+
+    size_t active = 0;
+    for (size_t j = 0; j < N; ++j) {
+        assign(j);
+        active += lanes[j].active;
+    }
+    while (active) {
+        for (size_t j = 0; j < N; ++j) {
+            auto &lane = lanes[j];
+            if (!lane.active) {
+                continue;
+            }
+            auto block = lane.block < lane.full_blocks ? (const uint8_t *)data[lane.msg] + lane.block * 64
+                                                       : lane.tail + (lane.block - lane.full_blocks) * 64;
+            for (size_t k = 0; k < 16; ++k) {
+                memcpy(&words[k][j], block + 4 * k, 4);
+            }
+        }
+        compress(state, words);
+        for (size_t j = 0; j < N; ++j) {
+            auto &lane = lanes[j];
+            if (!lane.active || ++lane.block < lane.total_blocks) {
+                continue;
+            }
+            for (size_t k = 0; k < 4; ++k) {
+                memcpy(digests[lane.msg] + 4 * k, &state[k][j], 4);
+            }
+            assign(j);
+            active -= !lane.active;
+        }
+    }
+}
+
+#endif // defined(MD5_MULTI_BUFFER)
+
+
+size_t MD5::multiLanes()
+{
+#if defined(MD5_MULTI_BUFFER)
+    static size_t s_lanes = []() -> size_t {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return 8;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return 4;
+        }
+        return 1;
+    }();
+    return s_lanes;
+#else
+    return 1;
+#endif
+}
+
+
+void MD5::digestMulti(const char *const data[], const size_t sizes[], size_t count, uint8_t digests[][16])
+{
+#if defined(MD5_MULTI_BUFFER)
+    switch (multiLanes()) {
+        case 8: md5Lanes<8>(data, sizes, count, digests, md5CompressAvx2); return;
+        case 4: md5Lanes<4>(data, sizes, count, digests, md5CompressSse2); return;
+        default: break;
+    }
+#endif
+    for (size_t i = 0; i < count; ++i) {
+        MD5 md5;
+        md5.update(data[i], sizes[i]);
+        md5.finalize();
+        memcpy(digests[i], md5.digest, 16);
+    }
+}
+
+
+std::vector<std::string> MD5::hexdigestMulti(const std::vector<std::string> &texts)
+{
+    std::vector<const char *> data(texts.size());
+    std::vector<size_t> sizes(texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        data[i] = texts[i].data();
+        sizes[i] = texts[i].size();
+    }
+    std::vector<uint8_t> digests(texts.size() * 16);
+    digestMulti(data.data(), sizes.data(), texts.size(), (uint8_t (*)[16])digests.data());
+
+    std::vector<std::string> ret(texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        char buf[33];
+        for (int j = 0; j < 16; j++)
+            sprintf(buf + j * 2, "%02x", digests[i * 16 + j]);
+        ret[i].assign(buf, 32);
+    }
+    return ret;
+}
+
+
+
 std::ostream& operator<<(std::ostream& out, MD5 md5)
 {
     return out << md5.hexdigest();
@@ -35,11 +35,14 @@ documentation and/or software.
 #define SRC_UTIL_MD5_H_
 
 #include <string>
+#include <vector>
 #include <iostream>
 #include <cstdint>
 
 namespace toolkit {
 
+class Buffer;
+
 // a small class for calculating MD5 hashes of strings or byte arrays
 // it is not meant to be fast or secure
 //
@@ -59,10 +62,42 @@ public:
     MD5(const std::string& text);
     void update(const unsigned char *buf, size_type length);
     void update(const char *buf, size_type length);
+    // BufferChain会逐段计算，不拼接
+    // A BufferChain is hashed slice by slice without joining
+    void update(const Buffer &buf);
     MD5& finalize();
     std::string hexdigest() const;
     std::string rawdigest() const;
     friend std::ostream& operator<<(std::ostream&, MD5 md5);
+
+    /**
+     * 多路并行计算多个独立消息的MD5：x86上每个SIMD通道计算一个消息(AVX2为8路，SSE2为4路)，
+     * 某个通道的消息结束后立即换入下一个消息；其他平台逐个计算
+     * @param data 各消息的数据
+     * @param sizes 各消息的长度
+     * @param count 消息个数
+     * @param digests 输出各消息16字节的二进制摘要
+     * Hash several independent messages in parallel: on x86 every SIMD lane hashes one message (8 lanes with AVX2, 4 with SSE2),
+     * a lane switches to the next message as soon as its message ends; other platforms hash them one by one
+     * @param data Data of each message
+     * @param sizes Size of each message
+     * @param count Number of messages
+     * @param digests Output 16 byte binary digest of each message
+     */
+    static void digestMulti(const char *const data[], const size_t sizes[], size_t count, uint8_t digests[][16]);
+
+    /**
+     * 多路并行计算多个字符串的MD5，返回16进制摘要
+     * Hash several strings in parallel, returning hex digests
+     */
+    static std::vector<std::string> hexdigestMulti(const std::vector<std::string> &texts);
+
+    /**
+     * digestMulti使用的并行路数，1表示逐个计算
+     * Number of parallel lanes used by digestMulti, 1 means hashing one by one
+     */
+    static size_t multiLanes();
+
 private:
     void init();
     typedef uint8_t uint1; //  8bit
@@ -12,48 +12,213 @@
 #define SRC_UTIL_NOTICECENTER_H_
 
 #include <mutex>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <exception>
 #include <functional>
 #include <unordered_map>
 #include <stdexcept>
+#include <vector>
 #include "util.h"
+#include "logger.h"
 #include "function_traits.h"
+#include "Thread/TaskExecutor.h"
 
 namespace toolkit {
 
-class EventDispatcher {
+/**
+ * 异步监听者的事件队列，事件在监听者绑定的线程(一般为EventPoller)中执行
+ * 没有批次在等待或执行时才投递一次任务，该任务一次性执行期间积压的所有事件(批量派发)，同一时刻最多一个批次在执行
+ * 同时提供队列积压深度等统计，用于发现处理不过来的监听者
+ * Event queue of an asynchronous listener, events are executed in the thread bound to the listener (usually an EventPoller)
+ * A task is only posted when no batch is pending or running, it runs all events accumulated meanwhile in one go (batched delivery), at most one batch runs at a time
+ * Statistics such as queue depth are also provided, to find out listeners that can not keep up
+ */
+class NoticeAsyncQueue : public std::enable_shared_from_this<NoticeAsyncQueue> {
 public:
-    friend class NoticeCenter;
-    using Ptr = std::shared_ptr<EventDispatcher>;
+    using Ptr = std::shared_ptr<NoticeAsyncQueue>;
+    using Event = std::function<void()>;
 
-    ~EventDispatcher() = default;
+    NoticeAsyncQueue(const TaskExecutor::Ptr &executor) : _executor(executor) {}
+    ~NoticeAsyncQueue() = default;
+
+    /**
+     * 当前积压未执行的事件个数
+     * Number of events pending execution
+     */
+    size_t depth() const { return _depth.load(); }
+
+    /**
+     * 历史最大积压事件个数
+     * Maximum number of pending events ever reached
+     */
+    size_t maxDepth() const { return _max_depth.load(); }
+
+    /**
+     * 已执行的事件个数
+     * Number of events delivered
+     */
+    uint64_t delivered() const { return _delivered.load(); }
+
+    /**
+     * 已执行的批次个数，delivered() / batches()即平均批大小
+     * Number of batches executed, delivered() / batches() is the average batch size
+     */
+    uint64_t batches() const { return _batches.load(); }
+
+    /**
+     * 因绑定的线程已销毁而丢弃的事件个数
+     * Number of events dropped because the bound executor has been destroyed
+     */
+    uint64_t dropped() const { return _dropped.load(); }
+
+    void push(Event event) {
+        auto executor = _executor.lock();
+        if (!executor) {
+            ++_dropped;
+            return;
+        }
+        bool need_post;
+        {
+            std::lock_guard<std::mutex> lck(_mtx);
+            _events.emplace_back(std::move(event));
+            need_post = !_posted;
+            _posted = true;
+            auto depth = ++_depth;
+            if (depth > _max_depth) {
+                _max_depth = depth;
+            }
+        }
+        if (need_post) {
+            post(executor);
+        }
+    }
 
 private:
-    using MapType = std::unordered_multimap<void *, Any>;
+    void post(const TaskExecutor::Ptr &executor) {
+        // 投递的任务持有强引用，监听被移除后已积压的事件仍会执行完毕
+        // The posted task holds a strong reference, so events already queued are still delivered after the listener is removed
+        auto self = shared_from_this();
+        executor->async([self]() { self->flush(); }, false);
+    }
 
-    EventDispatcher() = default;
+    void flush() {
+        List<Event> events;
+        {
+            std::lock_guard<std::mutex> lck(_mtx);
+            events.swap(_events);
+        }
+        ++_batches;
+        events.for_each([&](Event &event) {
+            try {
+                event();
+            } catch (std::exception &ex) {
+                WarnL << "Exception occurred when deliver notice event: " << ex.what();
+            }
+            --_depth;
+            ++_delivered;
+        });
 
+        // 本批派发完毕后才清除投递标记，同一时刻最多只有一个flush在执行，
+        // 即使绑定的是ThreadPool等多线程执行器，监听者也不会并发执行且事件保持顺序
+        // The posted flag is only cleared after this batch is delivered, so at most one flush runs at a time,
+        // even on a multi-threaded executor such as ThreadPool the listener never runs concurrently and events stay in order
+        {
+            std::lock_guard<std::mutex> lck(_mtx);
+            if (_events.empty()) {
+                _posted = false;
+                return;
+            }
+        }
+        // 派发期间又有新事件，继续投递下一批
+        // New events arrived during delivery, post the next batch
+        if (auto executor = _executor.lock()) {
+            post(executor);
+            return;
+        }
+        std::lock_guard<std::mutex> lck(_mtx);
+        _dropped += _events.size();
+        _depth -= _events.size();
+        _events.clear();
+        _posted = false;
+    }
+
+private:
+    bool _posted = false;
+    std::mutex _mtx;
+    List<Event> _events;
+    std::weak_ptr<TaskExecutor> _executor;
+    std::atomic<size_t> _depth { 0 };
+    std::atomic<size_t> _max_depth { 0 };
+    std::atomic<uint64_t> _delivered { 0 };
+    std::atomic<uint64_t> _batches { 0 };
+    std::atomic<uint64_t> _dropped { 0 };
+};
+
+template <typename T>
+struct NoticeAsyncWrapper;
+
+/**
+ * 把监听回调包装成签名相同的函数，调用时拷贝参数并投递到异步队列
+ * 引用类型参数会被拷贝为值，监听者在其线程中收到的是这份拷贝
+ * Wrap a listener into a function with the same signature, which copies the arguments and pushes them to the async queue when called
+ * Reference arguments are copied by value, the listener receives the copies in its own thread
+ */
+template <typename RET, typename... Args>
+struct NoticeAsyncWrapper<std::function<RET(Args...)> > {
+    using stl_func = std::function<RET(Args...)>;
+
+    static stl_func wrap(stl_func func, NoticeAsyncQueue::Ptr queue) {
+        auto listener = std::make_shared<stl_func>(std::move(func));
+        return [listener, queue](Args... args) -> RET {
+            queue->push(std::bind([listener](typename std::decay<Args>::type &...copies) { (*listener)(copies...); },
+                                  typename std::decay<Args>::type(std::forward<Args>(args))...));
+            return RET();
+        };
+    }
+};
+
+class EventDispatcher {
+public:
+    friend class NoticeCenter;
+    using Ptr = std::shared_ptr<EventDispatcher>;
+
+    /**
+     * 监听者抛出该异常时中断本次广播，字符串事件与NoticeChannel均支持
+     * A listener throwing this exception stops the current broadcast, supported by both string events and NoticeChannel
+     */
     class InterruptException : public std::runtime_error {
     public:
         InterruptException() : std::runtime_error("InterruptException") {}
         ~InterruptException() {}
     };
 
+    ~EventDispatcher() = default;
+
+private:
+    // 监听者列表创建后不再修改，增删监听时整体替换(写时复制)
+    // The listener list is never modified once created, it is replaced as a whole when adding or removing listeners (copy-on-write)
+    using ListenerList = std::vector<std::pair<void *, Any> >;
+
+    EventDispatcher() = default;
+
     template <typename... ArgsType>
     int emitEvent(bool safe, ArgsType &&...args) {
         using stl_func = std::function<void(decltype(std::forward<ArgsType>(args))...)>;
-        decltype(_mapListener) copy;
+        std::shared_ptr<ListenerList> listeners;
         {
-            // 先拷贝(开销比较小)，目的是防止在触发回调时还是上锁状态从而导致交叉互锁  [AUTO-TRANSLATED:62bff466]
-            //First copy (lower overhead), to prevent cross-locking when triggering callbacks while still locked
+            // 只拷贝监听者列表的智能指针，目的是防止在触发回调时还是上锁状态从而导致交叉互锁
+            // Only copy the smart pointer of the listener list, to prevent cross-locking when triggering callbacks while still locked
             std::lock_guard<std::recursive_mutex> lck(_mtxListener);
-            copy = _mapListener;
+            listeners = _listeners;
+        }
+        if (!listeners) {
+            return 0;
         }
 
         int ret = 0;
-        for (auto &pr : copy) {
+        for (auto &pr : *listeners) {
             try {
                 pr.second.get<stl_func>(safe)(std::forward<ArgsType>(args)...);
                 ++ret;
@@ -71,18 +236,37 @@ private:
         Any listener;
         listener.set<stl_func>(std::forward<FUNC>(func));
         std::lock_guard<std::recursive_mutex> lck(_mtxListener);
-        _mapListener.emplace(tag, listener);
+        auto listeners = _listeners ? std::make_shared<ListenerList>(*_listeners) : std::make_shared<ListenerList>();
+        listeners->emplace_back(tag, std::move(listener));
+        _listeners = std::move(listeners);
+    }
+
+    template <typename FUNC>
+    NoticeAsyncQueue::Ptr addAsyncListener(void *tag, const TaskExecutor::Ptr &executor, FUNC &&func) {
+        using stl_func = typename function_traits<typename std::remove_reference<FUNC>::type>::stl_function_type;
+        auto queue = std::make_shared<NoticeAsyncQueue>(executor);
+        addListener(tag, NoticeAsyncWrapper<stl_func>::wrap(std::forward<FUNC>(func), queue));
+        return queue;
     }
 
     void delListener(void *tag, bool &empty) {
         std::lock_guard<std::recursive_mutex> lck(_mtxListener);
-        _mapListener.erase(tag);
-        empty = _mapListener.empty();
+        if (_listeners) {
+            auto listeners = std::make_shared<ListenerList>();
+            listeners->reserve(_listeners->size());
+            for (auto &pr : *_listeners) {
+                if (pr.first != tag) {
+                    listeners->emplace_back(pr);
+                }
+            }
+            _listeners = listeners->empty() ? nullptr : std::move(listeners);
+        }
+        empty = !_listeners;
     }
 
 private:
     std::recursive_mutex _mtxListener;
-    MapType _mapListener;
+    std::shared_ptr<ListenerList> _listeners;
 };
 
 class NoticeCenter : public std::enable_shared_from_this<NoticeCenter> {
@@ -106,6 +290,21 @@ public:
         getDispatcher(event, true)->addListener(tag, std::forward<FUNC>(func));
     }
 
+    /**
+     * 添加异步监听，广播时只拷贝参数并入队，监听回调在executor(一般为EventPoller)线程中批量执行
+     * 适用于监听者与广播者不在同一线程、或监听回调较重的场景，避免阻塞广播线程
+     * @param executor 监听回调执行所在的线程
+     * @return 该监听的事件队列，可用于获取积压深度等统计
+     * Add an asynchronous listener, emitting only copies the arguments and enqueues them, the listener runs in batches in the executor (usually an EventPoller) thread
+     * Suitable when the listener lives in another thread than the emitter, or the listener is heavy, so the emitting thread is not blocked
+     * @param executor The thread in which the listener runs
+     * @return The event queue of this listener, which can be used to get statistics such as the queue depth
+     */
+    template <typename FUNC>
+    NoticeAsyncQueue::Ptr addAsyncListener(void *tag, const std::string &event, const TaskExecutor::Ptr &executor, FUNC &&func) {
+        return getDispatcher(event, true)->addAsyncListener(tag, executor, std::forward<FUNC>(func));
+    }
+
     void delListener(void *tag, const std::string &event) {
         auto dispatcher = getDispatcher(event);
         if (!dispatcher) {
@@ -202,5 +401,117 @@ public:
 
 #define NOTICE_EMIT(types, ...) NoticeHelper<void(types)>::emit(__VA_ARGS__)
 
+/**
+ * 声明一个编译期类型化事件，事件参数签名固定，例如:
+ * NOTICE_EVENT_DECLARE(kOnFlowReport, void(const std::string &app, size_t bytes));
+ * Declare a compile-time typed event with a fixed argument signature, for example:
+ * NOTICE_EVENT_DECLARE(kOnFlowReport, void(const std::string &app, size_t bytes));
+ */
+#define NOTICE_EVENT_DECLARE(name, ...)                                                                                \
+    struct name {                                                                                                      \
+        using FuncType = __VA_ARGS__;                                                                                  \
+        static const char *eventName() { return #name; }                                                               \
+    }
+
+/**
+ * 类型化事件通道，事件由NOTICE_EVENT_DECLARE声明的类型标识，无需字符串查找与运行时类型检查
+ * 监听者保存在不可变的列表中，增删监听时整体替换(写时复制)；
+ * 广播时只原子获取列表指针，不持有锁、不分配内存，回调中增删监听是安全的
+ * 类型化事件通道为进程全局的，与NoticeCenter实例无关，字符串事件接口保持不变
+ * Typed event channel, events are identified by types declared with NOTICE_EVENT_DECLARE, no string lookup or runtime type check is needed
+ * Listeners are kept in an immutable list which is replaced as a whole when adding or removing listeners (copy-on-write);
+ * Emitting only atomically loads the list pointer, no lock is held and no memory is allocated, adding or removing listeners in callbacks is safe
+ * Typed event channels are process-wide and independent of NoticeCenter instances, the string event interface remains unchanged
+ */
+template <typename Event>
+class NoticeChannel {
+public:
+    using FuncType = typename Event::FuncType;
+    using Listener = std::function<FuncType>;
+
+    static void addListener(void *tag, Listener func) {
+        auto &ref = storage();
+        std::lock_guard<std::mutex> lck(ref.mtx);
+        auto old = std::atomic_load(&ref.listeners);
+        auto listeners = old ? std::make_shared<ListenerList>(*old) : std::make_shared<ListenerList>();
+        listeners->emplace_back(tag, std::move(func));
+        std::atomic_store(&ref.listeners, std::shared_ptr<const ListenerList>(std::move(listeners)));
+    }
+
+    /**
+     * 添加异步监听，监听回调在executor线程中批量执行，参数按值拷贝
+     * @return 该监听的事件队列，可用于获取积压深度等统计
+     * Add an asynchronous listener which runs in batches in the executor thread, arguments are copied by value
+     * @return The event queue of this listener, which can be used to get statistics such as the queue depth
+     */
+    static NoticeAsyncQueue::Ptr addAsyncListener(void *tag, const TaskExecutor::Ptr &executor, Listener func) {
+        auto queue = std::make_shared<NoticeAsyncQueue>(executor);
+        addListener(tag, NoticeAsyncWrapper<Listener>::wrap(std::move(func), queue));
+        return queue;
+    }
+
+    static void delListener(void *tag) {
+        auto &ref = storage();
+        std::lock_guard<std::mutex> lck(ref.mtx);
+        auto old = std::atomic_load(&ref.listeners);
+        if (!old) {
+            return;
+        }
+        auto listeners = std::make_shared<ListenerList>();
+        listeners->reserve(old->size());
+        for (auto &pr : *old) {
+            if (pr.first != tag) {
+                listeners->emplace_back(pr);
+            }
+        }
+        std::atomic_store(&ref.listeners, listeners->empty() ? nullptr : std::shared_ptr<const ListenerList>(std::move(listeners)));
+    }
+
+    /**
+     * 广播事件，监听者抛出InterruptException时中断广播，其他异常传递给调用者
+     * @return 触发的监听者个数
+     * Emit the event, a listener throwing InterruptException stops the broadcast, other exceptions propagate to the caller
+     * @return Number of listeners triggered
+     */
+    template <typename... ArgsType>
+    static int emit(ArgsType &&...args) {
+        auto listeners = std::atomic_load(&storage().listeners);
+        if (!listeners) {
+            return 0;
+        }
+        int ret = 0;
+        for (auto &pr : *listeners) {
+            try {
+                pr.second(args...);
+                ++ret;
+            } catch (EventDispatcher::InterruptException &) {
+                // 与字符串事件一致，中断广播
+                // Same as string events, stop the broadcast
+                ++ret;
+                break;
+            }
+        }
+        return ret;
+    }
+
+    static size_t listenerSize() {
+        auto listeners = std::atomic_load(&storage().listeners);
+        return listeners ? listeners->size() : 0;
+    }
+
+private:
+    using ListenerList = std::vector<std::pair<void *, Listener> >;
+
+    struct Storage {
+        std::mutex mtx;
+        std::shared_ptr<const ListenerList> listeners;
+    };
+
+    static Storage &storage() {
+        static Storage s_storage;
+        return s_storage;
+    }
+};
+
 } /* namespace toolkit */
 #endif /* SRC_UTIL_NOTICECENTER_H_ */
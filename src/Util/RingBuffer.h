@@ -15,6 +15,7 @@
 #include <atomic>
 #include <memory>
 #include <mutex>
+#include <vector>
 #include <unordered_map>
 #include <condition_variable>
 #include <functional>
@@ -60,6 +61,7 @@ template <typename T>
 class _RingReader {
 public:
     using Ptr = std::shared_ptr<_RingReader>;
+    using BatchReadCB = std::function<void(const std::vector<T> &batch)>;
     friend class _RingReaderDispatcher<T>;
 
     _RingReader(std::shared_ptr<_RingStorage<T>> storage, size_t max_gop_size = SIZE_MAX) {
@@ -74,6 +76,7 @@ public:
     ~_RingReader() = default;
 
     void setReadCB(std::function<void(const T &)> cb) {
+        _batch_cb = nullptr;
         if (!cb) {
             _read_cb = [](const T &) {};
         } else {
@@ -82,6 +85,24 @@ public:
         }
     }
 
+    /**
+     * 设置批量读取回调，替代setReadCB设置的逐个回调
+     * 每次唤醒时本读取器积压的全部数据(包括attach时的gop缓存)一次性回调，便于合并为一次发送(例如writev)
+     * 清空批量回调请调用setReadCB(nullptr)
+     * Set the batch read callback, it replaces the per item callback set by setReadCB
+     * All data pending for this reader at each wake (the gop cache on attach included) is delivered in one call, so it can be merged into one send (writev for example)
+     * Call setReadCB(nullptr) to clear the batch callback
+     */
+    void setReadBatchCB(BatchReadCB cb) {
+        if (!cb) {
+            setReadCB(nullptr);
+            return;
+        }
+        _read_cb = [](const T &) {};
+        _batch_cb = std::move(cb);
+        flushGop();
+    }
+
     void setDetachCB(std::function<void()> cb) {
         _detach_cb = cb ? std::move(cb) : []() {};
     }
@@ -101,6 +122,19 @@ public:
         auto gop_count = _storage->getCache().size();
         auto gop_erase = gop_count > _max_gop_size ? gop_count - _max_gop_size : 0U;
         auto gop_index = 0U;
+        if (_batch_cb) {
+            std::vector<T> batch;
+            _storage->getCache().for_each([&](const List<std::pair<bool, T>> &lst) {
+                if (gop_index++ < gop_erase) {
+                    return;
+                }
+                lst.for_each([&](const std::pair<bool, T> &pr) { batch.emplace_back(pr.second); });
+            });
+            if (!batch.empty()) {
+                _batch_cb(batch);
+            }
+            return;
+        }
         _storage->getCache().for_each([&](const List<std::pair<bool, T>> &lst) {
             if (gop_index++ < gop_erase) {
                 return;
@@ -111,6 +145,17 @@ public:
 
 private:
     void onRead(const T &data, bool /*is_key*/) { _read_cb(data); }
+
+    void onReadBatch(const std::vector<T> &batch) {
+        if (_batch_cb) {
+            _batch_cb(batch);
+            return;
+        }
+        for (auto &data : batch) {
+            _read_cb(data);
+        }
+    }
+
     void onMessage(const Any &data) { _msg_cb(data); }
     void onDetach() const { _detach_cb(); }
     Any getInfo() { return _info_cb(); }
@@ -120,6 +165,7 @@ private:
     std::shared_ptr<_RingStorage<T>> _storage;
     std::function<void(void)> _detach_cb;
     std::function<void(const T &)> _read_cb;
+    BatchReadCB _batch_cb;
     std::function<Any()> _info_cb;
     std::function<void(const Any &data)> _msg_cb;
 };
@@ -275,7 +321,64 @@ private:
         assert(_on_size_changed);
     }
 
-    void write(T in, bool is_key = true) {
+    /**
+     * 在写线程中把数据加入待分发列队，列队为空时才切换到poller线程，之后写入的数据在同一次唤醒中批量分发
+     * Queue the data in the writer thread, only switch to the poller thread when the queue was empty, data written afterwards is dispatched as a batch in the same wake
+     */
+    void enqueue(const EventPoller::Ptr &poller, T in, bool is_key) {
+        {
+            LOCK_GUARD(_mtx_pending);
+            _pending.emplace_back(std::move(in));
+            _pending_key.emplace_back(is_key);
+            ++_enqueued;
+            if (_flush_scheduled) {
+                return;
+            }
+            _flush_scheduled = true;
+        }
+        std::weak_ptr<_RingReaderDispatcher> weak_self = this->shared_from_this();
+        poller->async([weak_self]() {
+            if (auto strong_self = weak_self.lock()) {
+                strong_self->flushPending();
+            }
+        }, false);
+    }
+
+    uint64_t enqueuedCount() {
+        LOCK_GUARD(_mtx_pending);
+        return _enqueued;
+    }
+
+    /**
+     * 在poller线程中分发待分发列队中的数据
+     * @param until 分发到累计入队的第几个数据为止，用于保证先写入的数据先于之后投递的消息分发
+     * Dispatch the queued data in the poller thread
+     * @param until Dispatch up to this cumulative enqueued count, used to make sure data written earlier is dispatched before a message posted later
+     */
+    void flushPending(uint64_t until = UINT64_MAX) {
+        // _batch只在poller线程中访问，交换后复用其内存
+        // _batch is only accessed in the poller thread, its memory is reused after the swap
+        _batch.clear();
+        _batch_key.clear();
+        {
+            LOCK_GUARD(_mtx_pending);
+            auto max_count = until > _dispatched ? until - _dispatched : 0;
+            if (max_count >= _pending.size()) {
+                _batch.swap(_pending);
+                _batch_key.swap(_pending_key);
+                _flush_scheduled = false;
+            } else {
+                _batch.assign(std::make_move_iterator(_pending.begin()), std::make_move_iterator(_pending.begin() + max_count));
+                _batch_key.assign(_pending_key.begin(), _pending_key.begin() + max_count);
+                _pending.erase(_pending.begin(), _pending.begin() + max_count);
+                _pending_key.erase(_pending_key.begin(), _pending_key.begin() + max_count);
+            }
+            _dispatched += _batch.size();
+        }
+        if (_batch.empty()) {
+            return;
+        }
+
         for (auto it = _reader_map.begin(); it != _reader_map.end();) {
             auto reader = it->second.lock();
             if (!reader) {
@@ -284,10 +387,14 @@ private:
                 onSizeChanged(false);
                 continue;
             }
-            reader->onRead(in, is_key);
+            reader->onReadBatch(_batch);
             ++it;
         }
-        _storage->write(std::move(in), is_key);
+        for (size_t i = 0; i < _batch.size(); ++i) {
+            _storage->write(std::move(_batch[i]), _batch_key[i]);
+        }
+        _batch.clear();
+        _batch_key.clear();
     }
 
     void sendMessage(const Any &data) {
@@ -357,6 +464,19 @@ private:
     std::function<void(int, bool)> _on_size_changed;
     typename RingStorage::Ptr _storage;
     std::unordered_map<void *, std::weak_ptr<RingReader>> _reader_map;
+
+    std::mutex _mtx_pending;
+    // 是否已有分发任务在poller中等待
+    // Whether a dispatch task is already pending in the poller
+    bool _flush_scheduled = false;
+    // 累计入队与已分发的数据个数
+    // Cumulative count of enqueued and dispatched data
+    uint64_t _enqueued = 0;
+    uint64_t _dispatched = 0;
+    std::vector<T> _pending;
+    std::vector<bool> _pending_key;
+    std::vector<T> _batch;
+    std::vector<bool> _batch_key;
 };
 
 template <typename T>
@@ -387,10 +507,9 @@ public:
 
         LOCK_GUARD(_mtx_map);
         for (auto &pr : _dispatcher_map) {
-            auto &second = pr.second;
-            //切换线程后触发onRead事件  [AUTO-TRANSLATED:4ca6647d]
-            //Switch thread and trigger onRead event
-            pr.first->async([second, in, is_key]() mutable { second->write(std::move(in), is_key); }, false);
+            //切换线程后触发onRead事件，同一次唤醒中积压的数据批量分发
+            //Switch thread and trigger onRead event, data pending in the same wake is dispatched as a batch
+            pr.second->enqueue(pr.first, in, is_key);
         }
         _storage->write(std::move(in), is_key);
     }
@@ -399,9 +518,15 @@ public:
         LOCK_GUARD(_mtx_map);
         for (auto &pr : _dispatcher_map) {
             auto &second = pr.second;
+            // 先分发此前写入的数据，保持与写入的先后顺序
+            // Dispatch the data written before first, keeping the order of writes
+            auto enqueued = second->enqueuedCount();
             // 切换线程后触发sendMessage  [AUTO-TRANSLATED:350138c9]
             //Switch thread and trigger sendMessage
-            pr.first->async([second, data]() { second->sendMessage(data); }, false);
+            pr.first->async([second, data, enqueued]() {
+                second->flushPending(enqueued);
+                second->sendMessage(data);
+            }, false);
         }
     }
 
@@ -435,9 +560,13 @@ public:
         _storage->clearCache();
         for (auto &pr : _dispatcher_map) {
             auto &second = pr.second;
+            auto enqueued = second->enqueuedCount();
             //切换线程后清空缓存  [AUTO-TRANSLATED:150f7fa4]
             //Switch thread and clear cache
-            pr.first->async([second]() { second->clearCache(); }, false);
+            pr.first->async([second, enqueued]() {
+                second->flushPending(enqueued);
+                second->clearCache();
+            }, false);
         }
     }
 
@@ -16,10 +16,19 @@
 // SHA1.cpp
 
 #include "SHA1.h"
+#include "Network/Buffer.h"
 
 #include <sstream>
 #include <iomanip>
 #include <fstream>
+#include <cstring>
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SHA1_SHA_NI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
 
 namespace toolkit {
 
@@ -27,7 +36,7 @@ static const size_t BLOCK_INTS = 16;  /* number of 32bit integers per SHA1 block
 static const size_t BLOCK_BYTES = BLOCK_INTS * 4;
 
 
-static void reset(uint32_t digest[], std::string &buffer, uint64_t &transforms)
+static void reset(uint32_t digest[], size_t &buffer_size, uint64_t &transforms)
 {
     /* SHA1 initialization constants */
     digest[0] = 0x67452301;
@@ -37,7 +46,7 @@ static void reset(uint32_t digest[], std::string &buffer, uint64_t &transforms)
     digest[4] = 0xc3d2e1f0;
 
     /* Reset counters */
-    buffer = "";
+    buffer_size = 0;
     transforms = 0;
 }
 
@@ -101,7 +110,7 @@ static void R4(uint32_t block[BLOCK_INTS], const uint32_t v, uint32_t &w, const
  * Hash a single 512-bit block. This is the core of the algorithm.
  */
 
-static void transform(uint32_t digest[], uint32_t block[BLOCK_INTS], uint64_t &transforms)
+static void transform(uint32_t digest[], uint32_t block[BLOCK_INTS])
 {
     /* Copy digest[] to working vars */
     uint32_t a = digest[0];
@@ -198,15 +207,12 @@ static void transform(uint32_t digest[], uint32_t block[BLOCK_INTS], uint64_t &t
     digest[2] += c;
     digest[3] += d;
     digest[4] += e;
-
-    /* Count the number of transformations */
-    transforms++;
 }
 
 
-static void buffer_to_block(const std::string &buffer, uint32_t block[BLOCK_INTS])
+static void buffer_to_block(const uint8_t *buffer, uint32_t block[BLOCK_INTS])
 {
-    /* Convert the std::string (byte buffer) to a uint32_t array (MSB) */
+    /* Convert the byte buffer to a uint32_t array (MSB) */
     for (size_t i = 0; i < BLOCK_INTS; i++)
     {
         block[i] =
@@ -218,34 +224,204 @@ static void buffer_to_block(const std::string &buffer, uint32_t block[BLOCK_INTS
 }
 
 
+static void transform_blocks_scalar(uint32_t digest[], const uint8_t *data, size_t blocks)
+{
+    uint32_t block[BLOCK_INTS];
+    for (; blocks; --blocks, data += BLOCK_BYTES)
+    {
+        buffer_to_block(data, block);
+        transform(digest, block);
+    }
+}
+
+
+#if defined(SHA1_SHA_NI)
+
+/*
+ * 使用SHA-NI指令(sha1rnds4/sha1nexte/sha1msg1/sha1msg2)计算，每条sha1rnds4完成4轮
+ * 参考Intel SHA扩展白皮书中的示例代码
+ * Hash with the SHA-NI instructions (sha1rnds4/sha1nexte/sha1msg1/sha1msg2), every sha1rnds4 does 4 rounds
+ * Based on the sample code in the Intel SHA extensions white paper
+ */
+
+// 第4..15组(16..63轮)的通用步骤，同时推进消息调度
+// Generic step of groups 4..15 (rounds 16..63), advancing the message schedule at the same time
+#define SHA1_NI_ROUNDS(E_CUR, E_NEXT, MSG, MSG_NEXT, MSG_PREV, MSG_PREV2, FUNC) \
+    E_CUR = _mm_sha1nexte_epu32(E_CUR, MSG); \
+    E_NEXT = abcd; \
+    MSG_NEXT = _mm_sha1msg2_epu32(MSG_NEXT, MSG); \
+    abcd = _mm_sha1rnds4_epu32(abcd, E_CUR, FUNC); \
+    MSG_PREV = _mm_sha1msg1_epu32(MSG_PREV, MSG); \
+    MSG_PREV2 = _mm_xor_si128(MSG_PREV2, MSG)
+
+__attribute__((target("sha,sse4.1"))) static void transform_blocks_sha_ni(uint32_t digest[], const uint8_t *data, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)digest), 0x1B);
+    __m128i e0 = _mm_set_epi32(digest[4], 0, 0, 0);
+    __m128i e1, msg0, msg1, msg2, msg3;
+
+    for (; blocks; --blocks, data += BLOCK_BYTES)
+    {
+        __m128i abcd_save = abcd;
+        __m128i e0_save = e0;
+
+        /* Rounds 0-3 */
+        msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), mask);
+        e0 = _mm_add_epi32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        /* Rounds 4-7 */
+        msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), mask);
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+        /* Rounds 8-11 */
+        msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), mask);
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        /* Rounds 12-63 */
+        msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), mask);
+        SHA1_NI_ROUNDS(e1, e0, msg3, msg0, msg2, msg1, 0);
+        SHA1_NI_ROUNDS(e0, e1, msg0, msg1, msg3, msg2, 0);
+        SHA1_NI_ROUNDS(e1, e0, msg1, msg2, msg0, msg3, 1);
+        SHA1_NI_ROUNDS(e0, e1, msg2, msg3, msg1, msg0, 1);
+        SHA1_NI_ROUNDS(e1, e0, msg3, msg0, msg2, msg1, 1);
+        SHA1_NI_ROUNDS(e0, e1, msg0, msg1, msg3, msg2, 1);
+        SHA1_NI_ROUNDS(e1, e0, msg1, msg2, msg0, msg3, 1);
+        SHA1_NI_ROUNDS(e0, e1, msg2, msg3, msg1, msg0, 2);
+        SHA1_NI_ROUNDS(e1, e0, msg3, msg0, msg2, msg1, 2);
+        SHA1_NI_ROUNDS(e0, e1, msg0, msg1, msg3, msg2, 2);
+        SHA1_NI_ROUNDS(e1, e0, msg1, msg2, msg0, msg3, 2);
+        SHA1_NI_ROUNDS(e0, e1, msg2, msg3, msg1, msg0, 2);
+        SHA1_NI_ROUNDS(e1, e0, msg3, msg0, msg2, msg1, 3);
+        SHA1_NI_ROUNDS(e0, e1, msg0, msg1, msg3, msg2, 3);
+        SHA1_NI_ROUNDS(e1, e0, msg1, msg2, msg0, msg3, 3);
+        SHA1_NI_ROUNDS(e0, e1, msg2, msg3, msg1, msg0, 3);
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+        /* Combine state */
+        e0 = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128((__m128i *)digest, _mm_shuffle_epi32(abcd, 0x1B));
+    digest[4] = _mm_extract_epi32(e0, 3);
+}
+
+#undef SHA1_NI_ROUNDS
+
+#endif // defined(SHA1_SHA_NI)
+
+
+/*
+ * cpu支持SHA-NI时使用硬件指令，否则使用标量实现
+ * Use the hardware instructions when the cpu supports SHA-NI, otherwise the scalar implementation
+ */
+
+using TransformBlocks = void (*)(uint32_t digest[], const uint8_t *data, size_t blocks);
+
+static TransformBlocks get_transform_blocks()
+{
+    static TransformBlocks s_func = []() -> TransformBlocks {
+#if defined(SHA1_SHA_NI)
+        unsigned int eax, ebx, ecx, edx;
+        // CPUID.1:ECX[19]为SSE4.1，CPUID.(7,0):EBX[29]为SHA
+        // CPUID.1:ECX[19] is SSE4.1, CPUID.(7,0):EBX[29] is SHA
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1 << 19))
+            && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1 << 29))) {
+            return transform_blocks_sha_ni;
+        }
+#endif
+        return transform_blocks_scalar;
+    }();
+    return s_func;
+}
+
+
+bool SHA1::isHardwareAccelerated()
+{
+    return get_transform_blocks() != transform_blocks_scalar;
+}
+
+
 SHA1::SHA1()
 {
-    reset(digest, buffer, transforms);
+    reset(digest, buffer_size, transforms);
 }
 
 
 void SHA1::update(const std::string &s)
 {
-    std::istringstream is(s);
-    update(is);
+    update(s.data(), s.size());
 }
 
 
-void SHA1::update(std::istream &is)
+void SHA1::update(const char *data, size_t size)
 {
-    while (true)
+    auto input = (const uint8_t *)data;
+    if (buffer_size)
     {
-        char sbuf[BLOCK_BYTES];
-        is.read(sbuf, BLOCK_BYTES - buffer.size());
-        buffer.append(sbuf, is.gcount());
-        if (buffer.size() != BLOCK_BYTES)
+        /* Fill up the pending block first */
+        auto len = std::min(size, BLOCK_BYTES - buffer_size);
+        memcpy(buffer + buffer_size, input, len);
+        buffer_size += len;
+        input += len;
+        size -= len;
+        if (buffer_size != BLOCK_BYTES)
         {
             return;
         }
-        uint32_t block[BLOCK_INTS];
-        buffer_to_block(buffer, block);
-        transform(digest, block, transforms);
-        buffer.clear();
+        get_transform_blocks()(digest, buffer, 1);
+        transforms++;
+        buffer_size = 0;
+    }
+
+    /* Hash whole blocks straight from the input */
+    auto blocks = size / BLOCK_BYTES;
+    if (blocks)
+    {
+        get_transform_blocks()(digest, input, blocks);
+        transforms += blocks;
+        input += blocks * BLOCK_BYTES;
+        size -= blocks * BLOCK_BYTES;
+    }
+    memcpy(buffer, input, size);
+    buffer_size = size;
+}
+
+
+void SHA1::update(const Buffer &buf)
+{
+    /* Hash every slice of a BufferChain without joining them */
+    if (auto chain = buf.getChain())
+    {
+        for (auto &slice : chain->slices())
+        {
+            update(slice.buffer->data() + slice.offset, slice.size);
+        }
+        return;
+    }
+    update(buf.data(), buf.size());
+}
+
+
+void SHA1::update(std::istream &is)
+{
+    char sbuf[BLOCK_BYTES * 64];
+    while (is)
+    {
+        is.read(sbuf, sizeof(sbuf));
+        update(sbuf, is.gcount());
     }
 }
 
@@ -273,22 +449,19 @@ std::string SHA1::final()
 std::string SHA1::final_bin()
 {
     /* Total number of hashed bits */
-    uint64_t total_bits = (transforms*BLOCK_BYTES + buffer.size()) * 8;
+    uint64_t total_bits = (transforms*BLOCK_BYTES + buffer_size) * 8;
 
     /* Padding */
-    buffer += 0x80;
-    size_t orig_size = buffer.size();
-    while (buffer.size() < BLOCK_BYTES)
-    {
-        buffer += (char)0x00;
-    }
+    buffer[buffer_size++] = 0x80;
+    size_t orig_size = buffer_size;
+    memset(buffer + buffer_size, 0, BLOCK_BYTES - buffer_size);
 
     uint32_t block[BLOCK_INTS];
     buffer_to_block(buffer, block);
 
     if (orig_size > BLOCK_BYTES - 8)
     {
-        transform(digest, block, transforms);
+        transform(digest, block);
         for (size_t i = 0; i < BLOCK_INTS - 2; i++)
         {
             block[i] = 0;
@@ -298,7 +471,7 @@ std::string SHA1::final_bin()
     /* Append total_bits, split this uint64_t into two uint32_t */
     block[BLOCK_INTS - 1] = total_bits;
     block[BLOCK_INTS - 2] = (total_bits >> 32);
-    transform(digest, block, transforms);
+    transform(digest, block);
 
     /* Hex std::string */
     std::string result;
@@ -311,7 +484,7 @@ std::string SHA1::final_bin()
     }
 
     /* Reset for next run */
-    reset(digest, buffer, transforms);
+    reset(digest, buffer_size, transforms);
 
     return result;
 }
@@ -23,12 +23,18 @@
 
 namespace toolkit {
 
+class Buffer;
+
 class SHA1 final
 {
 public:
     SHA1();
 
     void update(const std::string &s);
+    void update(const char *data, size_t size);
+    // BufferChain会逐段计算，不拼接
+    // A BufferChain is hashed slice by slice without joining
+    void update(const Buffer &buf);
     void update(std::istream &is);
     std::string final();
     std::string final_bin();
@@ -38,9 +44,14 @@ public:
     static std::string encode(const std::string &s);
     static std::string encode_bin(const std::string &s);
 
+    // 是否在使用SHA-NI硬件指令
+    // Whether the SHA-NI hardware instructions are used
+    static bool isHardwareAccelerated();
+
 private:
     uint32_t digest[5];
-    std::string buffer;
+    uint8_t buffer[64];
+    size_t buffer_size;
     uint64_t transforms;
 };
 
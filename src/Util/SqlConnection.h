@@ -18,6 +18,7 @@
 #include <vector>
 #include <list>
 #include <deque>
+#include <unordered_map>
 #include <sstream>
 #include <iostream>
 #include <stdexcept>
@@ -99,9 +100,11 @@ public:
         uint32_t reconnect = 0x01010101;
         mysql_options(&_sql, MYSQL_OPT_RECONNECT, &reconnect);
         mysql_set_character_set(&_sql, character.data());
+        _thread_id = mysql_thread_id(&_sql);
     }
 
     ~SqlConnection() {
+        clearStatements();
         mysql_close(&_sql);
     }
 
@@ -205,6 +208,64 @@ public:
         return mysql_affected_rows(&_sql);
     }
 
+    /**
+     * 执行带'?'占位符的预处理语句,无数据返回，适用于insert/update/delete等写操作
+     * 预处理语句按sql缓存在本连接中，重复执行时免去服务器端的sql解析
+     * @param rowId insert时的插入rowid
+     * @param sql 带'?'占位符的sql，占位符无需引号
+     * @param params 参数列表，均按字符串绑定，无需转义
+     * @return 影响行数
+     * Execute a prepared statement with '?' placeholders, no data returned, suitable for writes such as insert/update/delete
+     * Prepared statements are cached per sql in this connection, so repeated executions skip the sql parsing on the server
+     * @param rowId Insert rowid when inserting
+     * @param sql SQL with '?' placeholders, the placeholders need no quotes
+     * @param params Parameter list, all bound as strings, no escaping needed
+     * @return Affected rows
+     */
+    int64_t execute(int64_t &rowId, const std::string &sql, const std::vector<std::string> &params) {
+        check();
+        auto stmt = prepare(sql);
+        if (mysql_stmt_param_count(stmt) != params.size()) {
+            throw SqlException(sql, "Prepared statement parameter count mismatch");
+        }
+        std::vector<MYSQL_BIND> binds(params.size());
+        std::vector<unsigned long> lengths(params.size());
+        if (!binds.empty()) {
+            memset(binds.data(), 0, sizeof(MYSQL_BIND) * binds.size());
+        }
+        for (size_t i = 0; i < params.size(); ++i) {
+            lengths[i] = params[i].size();
+            binds[i].buffer_type = MYSQL_TYPE_STRING;
+            binds[i].buffer = (void *) params[i].data();
+            binds[i].buffer_length = lengths[i];
+            binds[i].length = &lengths[i];
+        }
+        if ((!binds.empty() && mysql_stmt_bind_param(stmt, binds.data())) || mysql_stmt_execute(stmt)) {
+            std::string err = mysql_stmt_error(stmt);
+            //出错的语句可能已失效，下次重新预处理
+            //The failed statement may be invalid, prepare it again next time
+            closeStatement(sql);
+            throw SqlException(sql, err);
+        }
+        if (auto meta = mysql_stmt_result_metadata(stmt)) {
+            //丢弃结果集，否则连接无法执行下一条语句
+            //Discard the result set, otherwise the connection cannot run the next statement
+            mysql_free_result(meta);
+            mysql_stmt_store_result(stmt);
+            mysql_stmt_free_result(stmt);
+        }
+        rowId = mysql_stmt_insert_id(stmt);
+        return mysql_stmt_affected_rows(stmt);
+    }
+
+    /**
+     * 已缓存的预处理语句个数
+     * Number of cached prepared statements
+     */
+    size_t statementCount() const {
+        return _stmts.size();
+    }
+
     std::string escape(const std::string &str) {
         char *out = new char[str.length() * 2 + 1];
         mysql_real_escape_string(&_sql, out, str.c_str(), str.size());
@@ -269,6 +330,51 @@ private:
         if (mysql_ping(&_sql) != 0) {
             throw SqlException("mysql_ping", "Mysql connection ping failed");
         }
+        auto thread_id = mysql_thread_id(&_sql);
+        if (thread_id != _thread_id) {
+            //自动重连后服务器端的预处理语句已全部失效
+            //All the prepared statements on the server are gone after an automatic reconnection
+            _thread_id = thread_id;
+            clearStatements();
+        }
+    }
+
+    MYSQL_STMT *prepare(const std::string &sql) {
+        auto it = _stmts.find(sql);
+        if (it != _stmts.end()) {
+            return it->second;
+        }
+        if (_stmts.size() >= kMaxStatements) {
+            //sql过于分散时缓存无意义，整体清空以限制服务器端的语句数
+            //Caching is pointless when the sql is too scattered, clear it all to bound the statements on the server
+            clearStatements();
+        }
+        auto stmt = mysql_stmt_init(&_sql);
+        if (!stmt) {
+            throw SqlException(sql, mysql_error(&_sql));
+        }
+        if (mysql_stmt_prepare(stmt, sql.data(), sql.size())) {
+            std::string err = mysql_stmt_error(stmt);
+            mysql_stmt_close(stmt);
+            throw SqlException(sql, err);
+        }
+        _stmts.emplace(sql, stmt);
+        return stmt;
+    }
+
+    void closeStatement(const std::string &sql) {
+        auto it = _stmts.find(sql);
+        if (it != _stmts.end()) {
+            mysql_stmt_close(it->second);
+            _stmts.erase(it);
+        }
+    }
+
+    void clearStatements() {
+        for (auto &pr : _stmts) {
+            mysql_stmt_close(pr.second);
+        }
+        _stmts.clear();
     }
 
     int doQuery(const std::string &sql) {
@@ -280,7 +386,11 @@ private:
     }
 
 private:
+    static constexpr size_t kMaxStatements = 256;
+
     MYSQL _sql;
+    unsigned long _thread_id = 0;
+    std::unordered_map<std::string, MYSQL_STMT *> _stmts;
 };
 
 } /* namespace toolkit */
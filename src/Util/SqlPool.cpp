@@ -11,6 +11,8 @@
 #if defined(ENABLE_MYSQL)
 
 #include <memory>
+#include <cctype>
+#include <cstring>
 #include "util.h"
 #include "onceToken.h"
 #include "SqlPool.h"
@@ -21,6 +23,139 @@ namespace toolkit {
 
 INSTANCE_IMP(SqlPool)
 
+//跳过空白字符
+//Skip whitespaces
+static size_t skipSpace(const std::string &sql, size_t pos) {
+    while (pos < sql.size() && isspace((unsigned char) sql[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+//跳过引号包裹的字符串或标识符，pos指向起始引号，返回结束引号之后的位置，未闭合时返回npos
+//Skip a quoted string or identifier, pos points at the opening quote, returns the position after the closing quote, or npos if unclosed
+static size_t skipQuoted(const std::string &sql, size_t pos) {
+    auto quote = sql[pos++];
+    while (pos < sql.size()) {
+        auto ch = sql[pos++];
+        if (ch == '\\' && quote != '`') {
+            ++pos;
+        } else if (ch == quote) {
+            return pos;
+        }
+    }
+    return string::npos;
+}
+
+static bool isQuote(char ch) {
+    return ch == '\'' || ch == '"' || ch == '`';
+}
+
+static bool isComment(const std::string &sql, size_t pos) {
+    auto ch = sql[pos];
+    return ch == '#' || ((ch == '-' || ch == '/') && pos + 1 < sql.size() && sql[pos + 1] == (ch == '-' ? '-' : '*'));
+}
+
+static bool isWordChar(char ch) {
+    return isalnum((unsigned char) ch) || ch == '_' || ch == '$';
+}
+
+bool SqlPool::splitInsert(const std::string &sql, std::string &prefix, std::string &values, size_t &rows) {
+    auto pos = skipSpace(sql, 0);
+    if (strncasecmp(sql.data() + pos, "insert", 6) != 0 || (pos + 6 < sql.size() && isWordChar(sql[pos + 6]))) {
+        return false;
+    }
+    //查找最外层的values关键字
+    //Find the values keyword at the outermost level
+    size_t values_end = string::npos;
+    int depth = 0;
+    while (pos < sql.size()) {
+        auto ch = sql[pos];
+        if (isQuote(ch)) {
+            pos = skipQuoted(sql, pos);
+            if (pos == string::npos) {
+                return false;
+            }
+            continue;
+        }
+        if (isComment(sql, pos)) {
+            return false;
+        }
+        if (ch == '(') {
+            ++depth;
+        } else if (ch == ')') {
+            --depth;
+        } else if (depth == 0 && isWordChar(ch)) {
+            auto start = pos;
+            while (pos < sql.size() && isWordChar(sql[pos])) {
+                ++pos;
+            }
+            auto len = pos - start;
+            if ((len == 6 && strncasecmp(sql.data() + start, "values", 6) == 0) || (len == 5 && strncasecmp(sql.data() + start, "value", 5) == 0)) {
+                values_end = pos;
+                break;
+            }
+            if ((len == 6 && strncasecmp(sql.data() + start, "select", 6) == 0) || (len == 3 && strncasecmp(sql.data() + start, "set", 3) == 0)) {
+                return false;
+            }
+            continue;
+        }
+        ++pos;
+    }
+    if (values_end == string::npos || depth != 0) {
+        return false;
+    }
+
+    //values之后只能是逗号分隔的数据元组及结尾的分号
+    //Only comma separated value tuples and trailing semicolons may follow the values keyword
+    rows = 0;
+    pos = skipSpace(sql, values_end);
+    auto tuples_start = pos;
+    size_t tuples_end = pos;
+    while (pos < sql.size() && sql[pos] == '(') {
+        depth = 0;
+        while (pos < sql.size()) {
+            auto ch = sql[pos];
+            if (isQuote(ch)) {
+                pos = skipQuoted(sql, pos);
+                if (pos == string::npos) {
+                    return false;
+                }
+                continue;
+            }
+            if (isComment(sql, pos)) {
+                return false;
+            }
+            ++pos;
+            if (ch == '(') {
+                ++depth;
+            } else if (ch == ')' && --depth == 0) {
+                break;
+            }
+        }
+        if (depth != 0) {
+            return false;
+        }
+        ++rows;
+        tuples_end = pos;
+        pos = skipSpace(sql, pos);
+        if (pos < sql.size() && sql[pos] == ',') {
+            pos = skipSpace(sql, pos + 1);
+            continue;
+        }
+        break;
+    }
+    while (pos < sql.size() && (sql[pos] == ';' || isspace((unsigned char) sql[pos]))) {
+        ++pos;
+    }
+    if (!rows || pos != sql.size()) {
+        return false;
+    }
+    prefix.assign(sql, 0, values_end);
+    values.assign(sql, tuples_start, tuples_end - tuples_start);
+    return true;
+}
+
 } /* namespace toolkit */
 
 #endif// defined(ENABLE_MYSQL)
@@ -13,10 +13,16 @@
 
 #include <deque>
 #include <mutex>
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <vector>
 #include <sstream>
 #include <functional>
+#include <unordered_map>
 #include "logger.h"
+#include "onceToken.h"
+#include "LatencyHistogram.h"
 #include "Poller/Timer.h"
 #include "SqlConnection.h"
 #include "Thread/WorkThreadPool.h"
@@ -30,9 +36,40 @@ public:
     using PoolType = ResourcePool<SqlConnection>;
     using SqlRetType = std::vector<std::vector<std::string> >;
 
+    /**
+     * 异步写入的统计信息
+     * Statistics of the asynchronous writes
+     */
+    struct Statistic {
+        // 已投递到后台线程但尚未执行完毕的任务数(一次批量写入算一个任务)
+        // Tasks posted to the background thread and not finished yet (a batch counts as one task)
+        size_t pending_tasks = 0;
+        // 批量写入缓存中尚未提交的数据行数
+        // Rows waiting in the batch write cache
+        size_t pending_rows = 0;
+        // 等待定时重试的sql数
+        // Sql statements waiting for the periodic retry
+        size_t error_queries = 0;
+        // 执行成功/失败的sql语句数
+        // Sql statements executed successfully / failed
+        uint64_t executed = 0;
+        uint64_t failed = 0;
+        // 通过批量写入合并提交的数据行数
+        // Rows written through merged batch inserts
+        uint64_t batched_rows = 0;
+        // 从投递到开始执行的排队耗时，批量写入从首行缓存时开始计算
+        // Queueing time from posting to execution start, for batches it starts when the first row is cached
+        LatencyHistogram::Snapshot wait_latency;
+        // 执行耗时
+        // Execution time
+        LatencyHistogram::Snapshot exec_latency;
+    };
+
     static SqlPool &Instance();
 
     ~SqlPool() {
+        _batch_timer.reset();
+        flushBatch();
         _timer.reset();
         flushError();
         _threadPool.reset();
@@ -130,6 +167,147 @@ public:
         return _pool->obtain()->escape(const_cast<std::string &>(str));
     }
 
+    /**
+     * 同步执行带'?'占位符的预处理语句，预处理语句缓存在各个连接中
+     * @param rowId insert时的插入rowid
+     * @param sql 带'?'占位符的sql
+     * @param params 参数列表，无需转义
+     * @return 影响行数
+     * Synchronously execute a prepared statement with '?' placeholders, the prepared statements are cached in each connection
+     * @param rowId Insert rowid when inserting
+     * @param sql SQL with '?' placeholders
+     * @param params Parameter list, no escaping needed
+     * @return Number of affected rows
+     */
+    int64_t syncExecute(int64_t &rowId, const std::string &sql, const std::vector<std::string> &params) {
+        checkInited();
+        typename PoolType::ValuePtr mysql;
+        try {
+            mysql = _pool->obtain();
+            return mysql->execute(rowId, sql, params);
+        } catch (std::exception &e) {
+            mysql.quit();
+            throw;
+        }
+    }
+
+    /**
+     * 异步执行带'?'占位符的预处理语句，失败时只打印日志
+     * @param sql 带'?'占位符的sql
+     * @param params 参数列表，无需转义
+     * Asynchronously execute a prepared statement with '?' placeholders, failures are only logged
+     * @param sql SQL with '?' placeholders
+     * @param params Parameter list, no escaping needed
+     */
+    void asyncExecute(const std::string &sql, const std::vector<std::string> &params) {
+        flushBatch();
+        auto enqueue = LatencyHistogram::now();
+        ++_pending_tasks;
+        _threadPool->async([this, sql, params, enqueue]() {
+            onceToken token(nullptr, [this]() { --_pending_tasks; });
+            std::string err;
+            if (!runTask(enqueue, err, [&]() {
+                int64_t rowID;
+                syncExecute(rowID, sql, params);
+            })) {
+                WarnL << "SqlPool::syncExecute failed: " << err;
+            }
+        });
+    }
+
+    /**
+     * 设置批量写入模式
+     * 开启后异步执行的单条insert ... values(...)语句按前缀(表名与列名)缓存，合并为多行insert后提交，
+     * 缓存满max_rows行、超过max_bytes字节或每隔interval秒提交一次
+     * 其他异步语句投递前会先提交已缓存的insert，不会越过之前的写入
+     * 各表的缓存按首行到达顺序排列，提交某个表的缓存时会先提交首行更早的其他表的缓存，因此父表的首批数据总在子表之前写入；
+     * 但合并后某表的后续行会随该表的首行一同提前，若其依赖的其他表的行到达得更晚，可能因外键约束失败，此时按下述拆分重试流程处理
+     * 合并语句执行失败时拆分为单条sql走重试流程，个别错误行不会导致整批丢失
+     * @param max_rows 每条合并语句的最大行数，为0时关闭批量写入
+     * @param interval 最长缓存时间，单位秒
+     * @param max_bytes 合并语句的最大字节数，应小于服务器的max_allowed_packet
+     * Set the batch write mode
+     * When enabled, asynchronous single insert ... values(...) statements are cached by prefix (table and columns) and committed as merged multi-row inserts,
+     * a batch is committed when it reaches max_rows rows or max_bytes bytes, or every interval seconds
+     * Other asynchronous statements commit the cached inserts first, so they never overtake earlier writes
+     * The per table caches are kept in the arrival order of their first row, committing one table commits the other tables whose first row is older first, so the first rows of a parent table are always written before the child table;
+     * merging does move the later rows of a table ahead together with its first row though, if they depend on rows of another table that arrived later they may fail a foreign key constraint and go through the split and retry path below
+     * When a merged statement fails it is split into single statements which go through the retry path, so one bad row does not lose the whole batch
+     * @param max_rows Max rows of a merged statement, 0 disables the batch write mode
+     * @param interval Max caching time, in seconds
+     * @param max_bytes Max bytes of a merged statement, should be below max_allowed_packet of the server
+     */
+    void setBatchWrite(size_t max_rows, float interval = 0.1f, size_t max_bytes = 1024 * 1024) {
+        {
+            std::lock_guard<std::mutex> lck(_batch_mutex);
+            _batch_max_rows = max_rows;
+            _batch_max_bytes = max_bytes;
+            flushBatch_l();
+        }
+        _batch_timer.reset();
+        if (max_rows) {
+            _batch_timer = std::make_shared<Timer>(interval, [this]() {
+                flushBatch();
+                return true;
+            }, nullptr);
+        }
+    }
+
+    /**
+     * 立即提交批量写入缓存中的所有数据
+     * Commit all the rows in the batch write cache now
+     */
+    void flushBatch() {
+        std::lock_guard<std::mutex> lck(_batch_mutex);
+        flushBatch_l();
+    }
+
+    /**
+     * 获取异步写入的统计信息
+     * @param reset 是否清零耗时统计与计数
+     * Get the statistics of the asynchronous writes
+     * @param reset Whether to reset the latency statistics and counters
+     */
+    Statistic getStatistic(bool reset = false) {
+        Statistic ret;
+        ret.pending_tasks = _pending_tasks.load();
+        ret.pending_rows = _pending_rows.load();
+        {
+            std::lock_guard<std::mutex> lck(_error_query_mutex);
+            ret.error_queries = _error_query.size();
+        }
+        if (reset) {
+            ret.executed = _executed.exchange(0);
+            ret.failed = _failed.exchange(0);
+            ret.batched_rows = _batched_rows.exchange(0);
+        } else {
+            ret.executed = _executed.load();
+            ret.failed = _failed.load();
+            ret.batched_rows = _batched_rows.load();
+        }
+        ret.wait_latency = _wait_latency.snapshot(reset);
+        ret.exec_latency = _exec_latency.snapshot(reset);
+        return ret;
+    }
+
+    /**
+     * 拆分可合并的insert语句，要求形如 insert into tb(cols) values(...)[,(...)][;]
+     * 带on duplicate key update、select等子句的语句不可合并
+     * @param sql insert语句
+     * @param prefix 返回values关键字及之前的部分
+     * @param values 返回所有的数据元组，以逗号分隔
+     * @param rows 返回数据元组个数
+     * @return 是否可合并
+     * Split a mergeable insert statement, which must look like insert into tb(cols) values(...)[,(...)][;]
+     * Statements with clauses such as on duplicate key update or select can not be merged
+     * @param sql Insert statement
+     * @param prefix Returns the part up to and including the values keyword
+     * @param values Returns all the value tuples separated by commas
+     * @param rows Returns the number of value tuples
+     * @return Whether it can be merged
+     */
+    static bool splitInsert(const std::string &sql, std::string &prefix, std::string &values, size_t &rows);
+
 private:
     SqlPool() {
         _threadPool = WorkThreadPool::Instance().getExecutor();
@@ -150,24 +328,135 @@ private:
      * [AUTO-TRANSLATED:6f585bf1]
      */
     void asyncQuery_l(const std::string &sql, int tryCnt = 3) {
-        auto lam = [this, sql, tryCnt]() {
-            int64_t rowID;
-            auto cnt = tryCnt - 1;
-            try {
-                syncQuery(rowID, sql);
-            } catch (std::exception &ex) {
-                if (cnt > 0) {
-                    //失败重试  [AUTO-TRANSLATED:ef091479]
-                    //Retry on failure
-                    std::lock_guard<std::mutex> lk(_error_query_mutex);
-                    sqlQuery query(sql, cnt);
-                    _error_query.push_back(query);
-                } else {
-                    WarnL << "SqlPool::syncQuery failed: " << ex.what();
+        {
+            std::lock_guard<std::mutex> lck(_batch_mutex);
+            if (_batch_max_rows) {
+                std::string prefix, values;
+                size_t rows;
+                if (splitInsert(sql, prefix, values, rows)) {
+                    auto it = _batch_index.find(prefix);
+                    if (it == _batch_index.end()) {
+                        //新的表按首行到达顺序追加到末尾
+                        //A new table is appended in the arrival order of its first row
+                        it = _batch_index.emplace(prefix, _batch_front_seq + _batches.size()).first;
+                        _batches.emplace_back(prefix, Batch());
+                        _batches.back().second.start = LatencyHistogram::now();
+                    }
+                    auto pos = it->second - _batch_front_seq;
+                    auto &batch = _batches[pos].second;
+                    batch.rows += rows;
+                    batch.bytes += values.size() + 1;
+                    batch.try_cnt = (std::max)(batch.try_cnt, tryCnt);
+                    batch.values.emplace_back(std::move(values));
+                    _pending_rows += rows;
+                    if (batch.rows >= _batch_max_rows || prefix.size() + batch.bytes >= _batch_max_bytes) {
+                        //首行更早的其他表先提交，保持跨表的写入顺序
+                        //Tables whose first row is older are committed first to keep the cross table write order
+                        postBatches_l(pos + 1);
+                    }
+                    return;
                 }
+                //其他语句不可越过之前缓存的insert
+                //Other statements must not overtake the cached inserts
+                flushBatch_l();
             }
-        };
-        _threadPool->async(lam);
+        }
+        postQuery(sql, tryCnt, LatencyHistogram::now());
+    }
+
+    void postQuery(const std::string &sql, int tryCnt, uint64_t enqueue) {
+        ++_pending_tasks;
+        _threadPool->async([this, sql, tryCnt, enqueue]() {
+            onceToken token(nullptr, [this]() { --_pending_tasks; });
+            std::string err;
+            if (!runTask(enqueue, err, [&]() {
+                int64_t rowID;
+                syncQuery(rowID, sql);
+            })) {
+                retryLater(sql, tryCnt - 1, err);
+            }
+        });
+    }
+
+    struct Batch {
+        std::vector<std::string> values;
+        size_t rows = 0;
+        size_t bytes = 0;
+        int try_cnt = 0;
+        uint64_t start = 0;
+    };
+
+    void postBatch(const std::string &prefix, Batch batch) {
+        _pending_rows -= batch.rows;
+        ++_pending_tasks;
+        auto ptr = std::make_shared<Batch>(std::move(batch));
+        _threadPool->async([this, prefix, ptr]() {
+            onceToken token(nullptr, [this]() { --_pending_tasks; });
+            std::string sql;
+            sql.reserve(prefix.size() + ptr->bytes);
+            sql.append(prefix);
+            for (auto &values : ptr->values) {
+                sql.append(sql.size() == prefix.size() ? " " : ",");
+                sql.append(values);
+            }
+            std::string err;
+            if (runTask(ptr->start, err, [&]() {
+                int64_t rowID;
+                syncQuery(rowID, sql);
+            })) {
+                _batched_rows += ptr->rows;
+                return;
+            }
+            //整批失败时拆分为单条sql重试，避免个别错误行导致整批丢失
+            //Split a failed batch into single statements for retrying, so one bad row does not lose the whole batch
+            WarnL << "SqlPool batch insert of " << ptr->rows << " rows failed: " << err;
+            for (auto &values : ptr->values) {
+                retryLater(prefix + " " + values, ptr->try_cnt - 1, err);
+            }
+        });
+    }
+
+    //按首行到达顺序提交前count个表的缓存
+    //Commit the caches of the first count tables in the arrival order of their first row
+    void postBatches_l(size_t count) {
+        while (count-- && !_batches.empty()) {
+            auto &front = _batches.front();
+            postBatch(front.first, std::move(front.second));
+            _batch_index.erase(front.first);
+            _batches.pop_front();
+            ++_batch_front_seq;
+        }
+    }
+
+    void flushBatch_l() {
+        postBatches_l(_batches.size());
+    }
+
+    template<typename Func>
+    bool runTask(uint64_t enqueue, std::string &err, Func &&func) {
+        auto start = LatencyHistogram::now();
+        _wait_latency.record(start - enqueue);
+        try {
+            func();
+        } catch (std::exception &ex) {
+            ++_failed;
+            err = ex.what();
+            return false;
+        }
+        _exec_latency.record(LatencyHistogram::now() - start);
+        ++_executed;
+        return true;
+    }
+
+    void retryLater(const std::string &sql, int cnt, const std::string &err) {
+        if (cnt > 0) {
+            //失败重试  [AUTO-TRANSLATED:ef091479]
+            //Retry on failure
+            std::lock_guard<std::mutex> lk(_error_query_mutex);
+            _error_query.emplace_back(sql, cnt);
+        } else {
+            WarnL << "SqlPool::syncQuery failed: " << err;
+        }
     }
 
     /**
@@ -182,8 +471,11 @@ private:
             std::lock_guard<std::mutex> lck(_error_query_mutex);
             query_copy.swap(_error_query);
         }
+        auto now = LatencyHistogram::now();
         for (auto &query : query_copy) {
-            asyncQuery(query.sql_str, query.tryCnt);
+            //重试时不再合并，避免错误行再次拖累整批
+            //Retries are not merged again, so a bad row can not drag down a whole batch again
+            postQuery(query.sql_str, query.tryCnt, now);
         }
     }
 
@@ -213,6 +505,24 @@ private:
     std::mutex _error_query_mutex;
     std::shared_ptr<PoolType> _pool;
     Timer::Ptr _timer;
+
+    std::mutex _batch_mutex;
+    size_t _batch_max_rows = 0;
+    size_t _batch_max_bytes = 0;
+    //按首行到达顺序排列的各表缓存，以及表前缀到其序号的索引，序号减去_batch_front_seq即为在_batches中的位置
+    //Per table caches in the arrival order of their first row, and the index from table prefix to its sequence number, minus _batch_front_seq it gives the position in _batches
+    std::deque<std::pair<std::string, Batch> > _batches;
+    std::unordered_map<std::string, uint64_t> _batch_index;
+    uint64_t _batch_front_seq = 0;
+    Timer::Ptr _batch_timer;
+
+    std::atomic<size_t> _pending_tasks { 0 };
+    std::atomic<size_t> _pending_rows { 0 };
+    std::atomic<uint64_t> _executed { 0 };
+    std::atomic<uint64_t> _failed { 0 };
+    std::atomic<uint64_t> _batched_rows { 0 };
+    LatencyHistogram _wait_latency;
+    LatencyHistogram _exec_latency;
 };
 
 /**
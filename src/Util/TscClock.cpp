@@ -0,0 +1,254 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include "TscClock.h"
+
+#if !defined(_WIN32)
+#include <time.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TSC_CLOCK_SUPPORTED 1
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+namespace toolkit {
+
+#if defined(TSC_CLOCK_SUPPORTED)
+
+// 初次标定时长
+// Duration of the initial calibration
+static constexpr uint64_t kCalibrateNs = 2 * 1000 * 1000;
+// 与系统单调时钟比对的周期，从10ms开始每次翻倍，最长1s
+// Period of comparing with the system monotonic clock, starting at 10ms and doubling each time, at most 1s
+static constexpr uint64_t kMinAdjustNs = 10 * 1000 * 1000;
+static constexpr uint64_t kMaxAdjustNs = 1000 * 1000 * 1000;
+// 误差超过该值(例如系统休眠后)时直接跳变追上，否则只做微调
+// Catch up by stepping when the error exceeds this (for example after system suspend), otherwise only slew
+static constexpr int64_t kStepNs = 100 * 1000 * 1000;
+
+struct TscState {
+    bool enabled = false;
+    // 标定起点
+    // Calibration origin
+    uint64_t origin_tsc = 0;
+    uint64_t origin_ns = 0;
+
+    // 以下参数由seqlock保护: ns = base_ns + ((tsc - base_tsc) * mult >> 32)
+    // The following parameters are protected by a seqlock: ns = base_ns + ((tsc - base_tsc) * mult >> 32)
+    atomic<uint32_t> seq { 0 };
+    atomic<uint64_t> base_tsc { 0 };
+    atomic<uint64_t> base_ns { 0 };
+    atomic<uint64_t> mult { 0 };
+    atomic<uint64_t> adjust_tsc { 0 };
+    atomic<uint64_t> tsc_hz { 0 };
+    atomic_flag adjusting = ATOMIC_FLAG_INIT;
+};
+
+static bool isTscUsable() {
+    unsigned int eax, ebx, ecx, edx;
+    // CPUID.80000007H:EDX[8]为不变TSC标志，频率恒定且各核心同步
+    // CPUID.80000007H:EDX[8] is the invariant TSC flag, constant rate and synchronized across cores
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8))) {
+        return false;
+    }
+#if defined(__linux__)
+    // 内核判定TSC不可靠时(虚拟机迁移、多路服务器未同步等)会切换到其他时钟源，此时跟随内核不使用TSC
+    // The kernel switches to another clock source when it considers the TSC unreliable (vm migration, unsynchronized multi socket servers etc.), follow the kernel then
+    ifstream file("/sys/devices/system/clocksource/clocksource0/current_clocksource");
+    string source;
+    if (file >> source && source != "tsc") {
+        return false;
+    }
+#endif
+    return true;
+}
+
+// 同时读取tsc与系统单调时钟，取前后两次tsc间隔最小的一次，排除读取过程中被调度或中断的干扰
+// Read the tsc and the system monotonic clock together, keep the sample with the smallest gap between the two tsc reads, which filters out preemption and interrupts during reading
+static void sampleClock(uint64_t &tsc, uint64_t &ns) {
+    uint64_t min_gap = UINT64_MAX;
+    for (int i = 0; i < 5; ++i) {
+        auto begin = __rdtsc();
+        auto mono = TscClock::monotonicNanosecond();
+        auto end = __rdtsc();
+        if (end - begin < min_gap) {
+            min_gap = end - begin;
+            tsc = begin + (end - begin) / 2;
+            ns = mono;
+        }
+    }
+}
+
+static uint64_t toMult(uint64_t ns, uint64_t ticks) {
+    return (uint64_t)(((unsigned __int128)ns << 32) / ticks);
+}
+
+static uint64_t toHz(uint64_t mult) {
+    return (uint64_t)(((unsigned __int128)1000000000 << 32) / mult);
+}
+
+static TscState &getTscState() {
+    static TscState *s_state = []() {
+        auto state = new TscState;
+        if (!isTscUsable()) {
+            return state;
+        }
+        sampleClock(state->origin_tsc, state->origin_ns);
+        uint64_t ns, tsc;
+        do {
+            sampleClock(tsc, ns);
+        } while (ns - state->origin_ns < kCalibrateNs);
+        if (tsc <= state->origin_tsc) {
+            return state;
+        }
+        auto mult = toMult(ns - state->origin_ns, tsc - state->origin_tsc);
+        state->base_tsc = tsc;
+        state->base_ns = ns - state->origin_ns;
+        state->mult = mult;
+        state->tsc_hz = toHz(mult);
+        state->adjust_tsc = (uint64_t)(((unsigned __int128)kMinAdjustNs << 32) / mult);
+        state->enabled = true;
+        return state;
+    }();
+    return *s_state;
+}
+
+static void adjustTsc(TscState &state, uint64_t tsc) {
+    if (state.adjusting.test_and_set(memory_order_acquire)) {
+        // 其他线程正在调整
+        // Another thread is adjusting
+        return;
+    }
+    // 持有调整标记期间参数不会变化；本线程读取的tsc可能早于其他线程刚完成的调整
+    // Parameters do not change while holding the adjusting flag; the tsc read by this thread may predate an adjustment just finished by another thread
+    auto base_tsc = state.base_tsc.load(memory_order_relaxed);
+    if (tsc <= base_tsc) {
+        state.adjusting.clear(memory_order_release);
+        return;
+    }
+    uint64_t mono_ns;
+    sampleClock(tsc, mono_ns);
+    auto ns = state.base_ns.load(memory_order_relaxed)
+        + (uint64_t)(((unsigned __int128)(tsc - base_tsc) * state.mult.load(memory_order_relaxed)) >> 32);
+    int64_t mono = mono_ns - state.origin_ns;
+    // 用标定起点至今的总时长重新测量频率，运行越久越精确
+    // Measure the frequency again over the whole time since the calibration origin, more accurate the longer it runs
+    auto nominal = toMult(mono, tsc - state.origin_tsc);
+    auto adjust_tsc = state.adjust_tsc.load(memory_order_relaxed);
+    if (adjust_tsc < ((unsigned __int128)kMaxAdjustNs << 32) / nominal) {
+        adjust_tsc *= 2;
+    }
+    auto period = (int64_t)(((unsigned __int128)adjust_tsc * nominal) >> 32);
+
+    int64_t error = mono - (int64_t)ns;
+    uint64_t base_ns = ns;
+    uint64_t mult = nominal;
+    if (error > kStepNs) {
+        // 落后太多，直接跳变追上
+        // Too far behind, step forward to catch up
+        base_ns = mono;
+    } else if (period > 0) {
+        // 在下一个周期内追平误差，超前时放慢、落后时加快，调整幅度不超过0.1%
+        // Cancel the error within the next period, slow down when ahead and speed up when behind, by at most 0.1%
+        auto limit = (int64_t)(nominal / 1000);
+        auto delta = (int64_t)(((__int128)nominal * error) / period);
+        delta = delta > limit ? limit : (delta < -limit ? -limit : delta);
+        mult = nominal + delta;
+    }
+
+    auto seq = state.seq.load(memory_order_relaxed);
+    state.seq.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    state.base_tsc.store(tsc, memory_order_relaxed);
+    state.base_ns.store(base_ns, memory_order_relaxed);
+    state.mult.store(mult, memory_order_relaxed);
+    state.adjust_tsc.store(adjust_tsc, memory_order_relaxed);
+    state.seq.store(seq + 2, memory_order_release);
+    state.tsc_hz.store(toHz(nominal), memory_order_relaxed);
+    state.adjusting.clear(memory_order_release);
+}
+
+#endif // defined(TSC_CLOCK_SUPPORTED)
+
+uint64_t TscClock::monotonicNanosecond() {
+#if !defined(_WIN32)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint64_t TscClock::now() {
+#if defined(TSC_CLOCK_SUPPORTED)
+    auto &state = getTscState();
+    if (state.enabled) {
+        uint64_t tsc, base_tsc, base_ns, mult, adjust_tsc;
+        uint32_t seq;
+        do {
+            seq = state.seq.load(memory_order_acquire);
+            base_tsc = state.base_tsc.load(memory_order_relaxed);
+            base_ns = state.base_ns.load(memory_order_relaxed);
+            mult = state.mult.load(memory_order_relaxed);
+            adjust_tsc = state.adjust_tsc.load(memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+        } while ((seq & 1) || seq != state.seq.load(memory_order_relaxed));
+
+        tsc = __rdtsc();
+        // 其他线程刚更新的基准可能略晚于本线程读取的tsc
+        // The base just updated by another thread may be slightly later than the tsc read by this thread
+        auto delta = tsc > base_tsc ? tsc - base_tsc : 0;
+        auto ns = base_ns + (uint64_t)(((unsigned __int128)delta * mult) >> 32);
+        if (delta >= adjust_tsc) {
+            adjustTsc(state, tsc);
+        }
+        // 调整参数的瞬间不同线程的换算可能有纳秒级差异，以全局高水位保证跨线程先后读取的时间也不回退
+        // Threads may differ by a few nanoseconds around an adjustment, a global high-water mark makes sure time never goes backwards between ordered reads on different threads either
+        static atomic<uint64_t> s_last { 0 };
+        auto last = s_last.load(memory_order_acquire);
+        while (ns > last) {
+            if (s_last.compare_exchange_weak(last, ns, memory_order_acq_rel, memory_order_acquire)) {
+                return ns;
+            }
+        }
+        return last;
+    }
+#endif
+    static uint64_t s_origin = monotonicNanosecond();
+    return monotonicNanosecond() - s_origin;
+}
+
+bool TscClock::isTscEnabled() {
+#if defined(TSC_CLOCK_SUPPORTED)
+    return getTscState().enabled;
+#else
+    return false;
+#endif
+}
+
+uint64_t TscClock::getTscFrequency() {
+#if defined(TSC_CLOCK_SUPPORTED)
+    auto &state = getTscState();
+    return state.enabled ? state.tsc_hz.load(memory_order_relaxed) : 0;
+#else
+    return 0;
+#endif
+}
+
+} // namespace toolkit
@@ -0,0 +1,52 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_TSCCLOCK_H
+#define ZLTOOLKIT_TSCCLOCK_H
+
+#include <cstdint>
+
+namespace toolkit {
+
+/**
+ * 单调时钟，支持不变TSC(invariant TSC)的x86_64平台上直接读取TSC换算为纳秒，否则回退到clock_gettime(Linux上为vDSO，不陷入内核)
+ * TSC频率在首次使用时标定，之后读取时按周期与系统单调时钟比对，以不超过0.1%的速率微调追平误差，时间永远不会回退
+ * Monotonic clock, on x86_64 with invariant TSC it reads the TSC directly and converts it to nanoseconds, otherwise it falls back to clock_gettime (vDSO on Linux, no kernel entry)
+ * The TSC frequency is calibrated on first use, afterwards readers periodically compare it with the system monotonic clock and slew at most 0.1% to catch up, time never goes backwards
+ */
+class TscClock {
+public:
+    /**
+     * 进程内首次使用以来流逝的纳秒数，不受系统时间调整影响，同一线程内不会回退
+     * Nanoseconds elapsed since the first use in this process, not affected by system time adjustments, never goes backwards within a thread
+     */
+    static uint64_t now();
+
+    /**
+     * 系统单调时钟的纳秒数(clock_gettime(CLOCK_MONOTONIC))
+     * Nanoseconds of the system monotonic clock (clock_gettime(CLOCK_MONOTONIC))
+     */
+    static uint64_t monotonicNanosecond();
+
+    /**
+     * 是否在使用TSC，为false时now()直接读取系统单调时钟
+     * Whether the TSC is used, now() reads the system monotonic clock directly when false
+     */
+    static bool isTscEnabled();
+
+    /**
+     * 当前标定的TSC频率(Hz)，未使用TSC时返回0
+     * Currently calibrated TSC frequency (Hz), 0 if the TSC is not used
+     */
+    static uint64_t getTscFrequency();
+};
+
+} // namespace toolkit
+#endif // ZLTOOLKIT_TSCCLOCK_H
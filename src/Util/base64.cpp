@@ -29,6 +29,8 @@
 #include "base64.h"
 #include <memory>
 #include <limits.h>
+#include <cstring>
+#include "Network/Buffer.h"
 
 using namespace std;
 
@@ -107,29 +109,343 @@ char *av_base64_encode(char *out, int out_size, const uint8_t *in, int in_size)
     return av_base64_encode_l(out, &out_size, in, in_size);
 }
 
+/* ---------------- SIMD code */
+
+static const char s_b64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 标量实现，与av_base64_encode结果一致
+// Scalar implementation, same output as av_base64_encode
+static size_t base64EncodeScalar(char *out, const uint8_t *in, size_t in_size) {
+    auto dst = out;
+    for (; in_size >= 3; in_size -= 3, in += 3) {
+        uint32_t v = (in[0] << 16) | (in[1] << 8) | in[2];
+        *dst++ = s_b64_chars[v >> 18];
+        *dst++ = s_b64_chars[(v >> 12) & 0x3f];
+        *dst++ = s_b64_chars[(v >> 6) & 0x3f];
+        *dst++ = s_b64_chars[v & 0x3f];
+    }
+    if (in_size) {
+        uint32_t v = in[0] << 16;
+        if (in_size == 2) {
+            v |= in[1] << 8;
+        }
+        *dst++ = s_b64_chars[v >> 18];
+        *dst++ = s_b64_chars[(v >> 12) & 0x3f];
+        *dst++ = in_size == 2 ? s_b64_chars[(v >> 6) & 0x3f] : '=';
+        *dst++ = '=';
+    }
+    *dst = '\0';
+    return dst - out;
+}
+
+// 标量实现，与av_base64_decode结果一致，in从4字节对齐的位置开始时可以接续解码
+// Scalar implementation, same output as av_base64_decode, decoding can be resumed when in starts at a multiple of 4 characters
+static int base64DecodeScalar(uint8_t *out, const char *in, size_t in_size) {
+    uint8_t *dst = out;
+    unsigned v = 0;
+    for (size_t i = 0; i < in_size && in[i] && in[i] != '='; i++) {
+        unsigned int index = (uint8_t)in[i] - 43;
+        if (index >= FF_ARRAY_ELEMS(map2) || map2[index] == 0xff) {
+            return -1;
+        }
+        v = (v << 6) + map2[index];
+        if (i & 3) {
+            *dst++ = v >> (6 - 2 * (i & 3));
+        }
+    }
+    return dst - out;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BASE64_X86_SIMD 1
+#include <immintrin.h>
+
+/*
+ * 向量化算法来自Wojciech Muła与Daniel Lemire的base64 SIMD编解码(SSSE3/SSE4.1/AVX2)
+ * 编码：每3字节拆分为4个6bit索引，再按区间查表加偏移得到字符
+ * 解码：按高低4bit查表校验字符并换算为6bit值，再用乘加指令拼回3字节；遇到非法字符、'='或'\0'的块交给标量实现
+ * The vectorized algorithms come from the base64 SIMD codecs by Wojciech Muła and Daniel Lemire (SSSE3/SSE4.1/AVX2)
+ * Encoding: every 3 bytes are split into 4 6-bit indexes, then the character is obtained by adding a per range offset from a lookup table
+ * Decoding: characters are validated and converted to 6-bit values with lookups on the high and low nibbles, then packed back to 3 bytes with multiply-add instructions; blocks containing invalid characters, '=' or '\0' are left to the scalar implementation
+ */
+
+__attribute__((target("sse4.1"))) static inline __m128i encodeIndexesSse(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    auto t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    auto t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    auto t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    auto t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    auto indexes = _mm_or_si128(t1, t3);
+
+    // 0..25 -> 13('A'), 26..51 -> 0('a'), 52..61 -> 1..10('0'), 62 -> 11('+'), 63 -> 12('/')
+    auto result = _mm_subs_epu8(indexes, _mm_set1_epi8(51));
+    auto less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indexes);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    auto shift_lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                   '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(shift_lut, result), indexes);
+}
+
+__attribute__((target("sse4.1"))) static size_t base64EncodeSse(char *out, const uint8_t *in, size_t in_size) {
+    auto dst = out;
+    // 每次读取16字节，使用其中12字节
+    // Read 16 bytes each time and use 12 of them
+    for (; in_size >= 16; in_size -= 12, in += 12, dst += 16) {
+        _mm_storeu_si128((__m128i *)dst, encodeIndexesSse(_mm_loadu_si128((const __m128i *)in)));
+    }
+    return (dst - out) + base64EncodeScalar(dst, in, in_size);
+}
+
+__attribute__((target("sse4.1"))) static inline bool decodeValuesSse(__m128i in, __m128i &out) {
+    auto hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+    auto lo_nibbles = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+    auto shift_lut = _mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    auto mask_lut = _mm_setr_epi8((char)0xa8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8,
+                                  (char)0xf8, (char)0xf8, (char)0xf0, 0x54, 0x50, 0x50, 0x50, 0x54);
+    auto bitpos_lut = _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    auto mask = _mm_shuffle_epi8(mask_lut, lo_nibbles);
+    auto bit = _mm_shuffle_epi8(bitpos_lut, hi_nibbles);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(mask, bit), _mm_setzero_si128()))) {
+        return false;
+    }
+    // '/'与'+'的高4bit相同，单独处理
+    // '/' has the same high nibble as '+', handle it separately
+    auto shift = _mm_blendv_epi8(_mm_shuffle_epi8(shift_lut, hi_nibbles), _mm_set1_epi8(16), _mm_cmpeq_epi8(in, _mm_set1_epi8(0x2f)));
+    auto values = _mm_add_epi8(in, shift);
+    auto merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    out = _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    return true;
+}
+
+__attribute__((target("sse4.1"))) static int base64DecodeSse(uint8_t *out, const char *in, size_t in_size) {
+    auto dst = out;
+    for (; in_size >= 16; in_size -= 16, in += 16, dst += 12) {
+        __m128i bytes;
+        if (!decodeValuesSse(_mm_loadu_si128((const __m128i *)in), bytes)) {
+            break;
+        }
+        // 只写入有效的12字节，避免越界
+        // Only write the 12 valid bytes to stay in bounds
+        _mm_storel_epi64((__m128i *)dst, bytes);
+        auto tail = (uint32_t)_mm_extract_epi32(bytes, 2);
+        memcpy(dst + 8, &tail, 4);
+    }
+    auto ret = base64DecodeScalar(dst, in, in_size);
+    return ret < 0 ? -1 : (int)(dst - out) + ret;
+}
+
+__attribute__((target("avx2"))) static size_t base64EncodeAvx2(char *out, const uint8_t *in, size_t in_size) {
+    auto dst = out;
+    // 两条128bit通道分别读取in与in+12处的16字节，每次处理24字节
+    // The two 128-bit lanes read 16 bytes at in and in+12, 24 bytes are processed each time
+    for (; in_size >= 28; in_size -= 24, in += 24, dst += 32) {
+        auto lo = _mm_loadu_si128((const __m128i *)in);
+        auto hi = _mm_loadu_si128((const __m128i *)(in + 12));
+        auto data = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        data = _mm256_shuffle_epi8(data, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                                         10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+        auto t0 = _mm256_and_si256(data, _mm256_set1_epi32(0x0fc0fc00));
+        auto t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        auto t2 = _mm256_and_si256(data, _mm256_set1_epi32(0x003f03f0));
+        auto t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        auto indexes = _mm256_or_si256(t1, t3);
+
+        auto result = _mm256_subs_epu8(indexes, _mm256_set1_epi8(51));
+        auto less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indexes);
+        result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        auto shift_lut = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                          'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        result = _mm256_add_epi8(_mm256_shuffle_epi8(shift_lut, result), indexes);
+        _mm256_storeu_si256((__m256i *)dst, result);
+    }
+    return (dst - out) + base64EncodeSse(dst, in, in_size);
+}
+
+__attribute__((target("avx2"))) static int base64DecodeAvx2(uint8_t *out, const char *in, size_t in_size) {
+    auto dst = out;
+    auto shift_lut = _mm256_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                      0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    auto mask_lut = _mm256_setr_epi8((char)0xa8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8,
+                                     (char)0xf8, (char)0xf8, (char)0xf0, 0x54, 0x50, 0x50, 0x50, 0x54,
+                                     (char)0xa8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8,
+                                     (char)0xf8, (char)0xf8, (char)0xf0, 0x54, 0x50, 0x50, 0x50, 0x54);
+    auto bitpos_lut = _mm256_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80, 0, 0, 0, 0, 0, 0, 0, 0,
+                                       0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80, 0, 0, 0, 0, 0, 0, 0, 0);
+    for (; in_size >= 32; in_size -= 32, in += 32, dst += 24) {
+        auto data = _mm256_loadu_si256((const __m256i *)in);
+        auto hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(data, 4), _mm256_set1_epi8(0x0f));
+        auto lo_nibbles = _mm256_and_si256(data, _mm256_set1_epi8(0x0f));
+        auto mask = _mm256_shuffle_epi8(mask_lut, lo_nibbles);
+        auto bit = _mm256_shuffle_epi8(bitpos_lut, hi_nibbles);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(mask, bit), _mm256_setzero_si256()))) {
+            break;
+        }
+        auto shift = _mm256_blendv_epi8(_mm256_shuffle_epi8(shift_lut, hi_nibbles), _mm256_set1_epi8(16),
+                                        _mm256_cmpeq_epi8(data, _mm256_set1_epi8(0x2f)));
+        auto values = _mm256_add_epi8(data, shift);
+        auto merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                              2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        // 把两条通道的12字节拼接为连续的24字节
+        // Join the 12 bytes of the two lanes into 24 contiguous bytes
+        merged = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(merged));
+        _mm_storel_epi64((__m128i *)(dst + 16), _mm256_extracti128_si256(merged, 1));
+    }
+    auto ret = base64DecodeSse(dst, in, in_size);
+    return ret < 0 ? -1 : (int)(dst - out) + ret;
+}
+
+#elif defined(__aarch64__)
+#define BASE64_NEON 1
+#include <arm_neon.h>
+
+/*
+ * aarch64上NEON为基础指令集，无需运行时检测
+ * 编码：vld3按3字节交织读取48字节，拆分为4组6bit索引后用vqtbl4q一次查64字节的字符表
+ * 解码：vld4按4字符交织读取64字符，用vqtbl4q/vqtbx4q查两张64字节的反查表，任一字符非法(0xff)时交给标量实现
+ * NEON is part of the baseline instruction set on aarch64, no runtime detection is needed
+ * Encoding: vld3 reads 48 bytes deinterleaved by 3, they are split into 4 groups of 6-bit indexes and vqtbl4q looks up the 64 byte alphabet at once
+ * Decoding: vld4 reads 64 characters deinterleaved by 4, vqtbl4q/vqtbx4q look up two 64 byte reverse tables, blocks with any invalid character (0xff) are left to the scalar implementation
+ */
+
+static size_t base64EncodeNeon(char *out, const uint8_t *in, size_t in_size) {
+    auto dst = out;
+    uint8x16x4_t table;
+    for (int i = 0; i < 4; ++i) {
+        table.val[i] = vld1q_u8((const uint8_t *)s_b64_chars + 16 * i);
+    }
+    for (; in_size >= 48; in_size -= 48, in += 48, dst += 64) {
+        auto data = vld3q_u8(in);
+        uint8x16x4_t result;
+        result.val[0] = vshrq_n_u8(data.val[0], 2);
+        result.val[1] = vandq_u8(vorrq_u8(vshrq_n_u8(data.val[1], 4), vshlq_n_u8(data.val[0], 4)), vdupq_n_u8(0x3f));
+        result.val[2] = vandq_u8(vorrq_u8(vshrq_n_u8(data.val[2], 6), vshlq_n_u8(data.val[1], 2)), vdupq_n_u8(0x3f));
+        result.val[3] = vandq_u8(data.val[2], vdupq_n_u8(0x3f));
+        for (int i = 0; i < 4; ++i) {
+            result.val[i] = vqtbl4q_u8(table, result.val[i]);
+        }
+        vst4q_u8((uint8_t *)dst, result);
+    }
+    return (dst - out) + base64EncodeScalar(dst, in, in_size);
+}
+
+static int base64DecodeNeon(uint8_t *out, const char *in, size_t in_size) {
+    // 字符0..127的反查表，非法字符为0xff
+    // Reverse table of characters 0..127, invalid characters are 0xff
+    static const uint8_t *s_lut = []() {
+        static uint8_t table[128];
+        memset(table, 0xff, sizeof(table));
+        for (int i = 0; i < 64; ++i) {
+            table[(uint8_t)s_b64_chars[i]] = i;
+        }
+        return table;
+    }();
+
+    uint8x16x4_t lo_table, hi_table;
+    for (int i = 0; i < 4; ++i) {
+        lo_table.val[i] = vld1q_u8(s_lut + 16 * i);
+        hi_table.val[i] = vld1q_u8(s_lut + 64 + 16 * i);
+    }
+    auto dst = out;
+    for (; in_size >= 64; in_size -= 64, in += 64, dst += 48) {
+        auto data = vld4q_u8((const uint8_t *)in);
+        uint8x16x4_t values;
+        uint8x16_t invalid = vdupq_n_u8(0);
+        for (int i = 0; i < 4; ++i) {
+            // 0..63查lo_table，64..127查hi_table，128以上两张表都查不到，保持为0xff
+            // 0..63 look up lo_table, 64..127 look up hi_table, 128 and above miss both tables and stay 0xff
+            auto v = vqtbx4q_u8(vdupq_n_u8(0xff), lo_table, data.val[i]);
+            v = vqtbx4q_u8(v, hi_table, vsubq_u8(data.val[i], vdupq_n_u8(64)));
+            values.val[i] = v;
+            invalid = vorrq_u8(invalid, v);
+        }
+        if (vmaxvq_u8(invalid) & 0x80) {
+            break;
+        }
+        uint8x16x3_t result;
+        result.val[0] = vorrq_u8(vshlq_n_u8(values.val[0], 2), vshrq_n_u8(values.val[1], 4));
+        result.val[1] = vorrq_u8(vshlq_n_u8(values.val[1], 4), vshrq_n_u8(values.val[2], 2));
+        result.val[2] = vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+        vst3q_u8(dst, result);
+    }
+    auto ret = base64DecodeScalar(dst, in, in_size);
+    return ret < 0 ? -1 : (int)(dst - out) + ret;
+}
+
+#endif
+
+using EncodeFunc = size_t (*)(char *out, const uint8_t *in, size_t in_size);
+using DecodeFunc = int (*)(uint8_t *out, const char *in, size_t in_size);
+
+// 根据cpu支持的指令集选择实现，只在首次使用时检测一次
+// Pick the implementation supported by the cpu, detected only once on first use
+static EncodeFunc getEncodeFunc() {
+    static EncodeFunc s_func = []() -> EncodeFunc {
+#if defined(BASE64_X86_SIMD)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return base64EncodeAvx2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return base64EncodeSse;
+        }
+#elif defined(BASE64_NEON)
+        return base64EncodeNeon;
+#endif
+        return base64EncodeScalar;
+    }();
+    return s_func;
+}
+
+static DecodeFunc getDecodeFunc() {
+    static DecodeFunc s_func = []() -> DecodeFunc {
+#if defined(BASE64_X86_SIMD)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return base64DecodeAvx2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return base64DecodeSse;
+        }
+#elif defined(BASE64_NEON)
+        return base64DecodeNeon;
+#endif
+        return base64DecodeScalar;
+    }();
+    return s_func;
+}
+
+size_t base64Encode(char *out, const uint8_t *in, size_t in_size) {
+    return getEncodeFunc()(out, in, in_size);
+}
+
+int base64Decode(uint8_t *out, const char *in, size_t in_size) {
+    return getDecodeFunc()(out, in, in_size);
+}
+
 string encodeBase64(const string &txt) {
     if (txt.empty()) {
         return "";
     }
-    int size = AV_BASE64_SIZE(txt.size()) + 10;
     string ret;
-    ret.resize(size);
-
-    if (!av_base64_encode_l((char *) ret.data(), &size, (const uint8_t *) txt.data(), txt.size())) {
-        return "";
-    }
-    ret.resize(size);
+    ret.resize(AV_BASE64_SIZE(txt.size()));
+    ret.resize(base64Encode((char *)ret.data(), (const uint8_t *)txt.data(), txt.size()));
     return ret;
 }
 
-string decodeBase64(const string &txt){
+string decodeBase64(const string &txt) {
     if (txt.empty()) {
         return "";
     }
     string ret;
-    ret.resize(txt.size() * 3 / 4 + 10);
-    auto size = av_base64_decode((uint8_t *) ret.data(), txt.data(), ret.size());
-
+    ret.resize(BASE64_DECODE_SIZE(txt.size()));
+    auto size = base64Decode((uint8_t *)ret.data(), txt.data(), txt.size());
     if (size <= 0) {
         return "";
     }
@@ -137,6 +453,25 @@ string decodeBase64(const string &txt){
     return ret;
 }
 
+void encodeBase64(const char *data, size_t size, toolkit::BufferRaw &out) {
+    out.setCapacity(AV_BASE64_SIZE(size));
+    out.setSize(base64Encode(out.data(), (const uint8_t *)data, size));
+}
+
+bool decodeBase64(const char *data, size_t size, toolkit::BufferRaw &out) {
+    // 多留1字节写入'\0'
+    // One more byte for '\0'
+    out.setCapacity(BASE64_DECODE_SIZE(size) + 1);
+    auto ret = base64Decode((uint8_t *)out.data(), data, size);
+    if (ret < 0) {
+        out.setSize(0);
+        return false;
+    }
+    out.data()[ret] = '\0';
+    out.setSize(ret);
+    return true;
+}
+
 #ifdef TEST
 
 #undef printf
@@ -25,6 +25,10 @@
 #include <cstdint>
 #include <string>
 
+namespace toolkit {
+class BufferRaw;
+}
+
 /**
  * Decode a base64-encoded string.
  *
@@ -53,6 +57,32 @@ char *av_base64_encode(char *out, int out_size, const uint8_t *in, int in_size);
  */
 #define AV_BASE64_SIZE(x)  (((x)+2) / 3 * 4 + 1)
 
+/**
+ * 解码x个字符所需的最大输出长度
+ * Maximum output size needed to decode x characters
+ */
+#define BASE64_DECODE_SIZE(x)  ((x) / 4 * 3 + 3)
+
+/**
+ * 编码base64，根据cpu选择AVX2/SSE4.1/NEON向量化实现，结果与av_base64_encode一致
+ * @param out 输出缓存，至少AV_BASE64_SIZE(in_size)字节，结果以'\0'结尾
+ * @return 编码后的长度(不含'\0')
+ * Encode base64 with the AVX2/SSE4.1/NEON vectorized implementation picked by the cpu, the output is the same as av_base64_encode
+ * @param out Output buffer of at least AV_BASE64_SIZE(in_size) bytes, the result is null-terminated
+ * @return Encoded length (without '\0')
+ */
+size_t base64Encode(char *out, const uint8_t *in, size_t in_size);
+
+/**
+ * 解码base64，根据cpu选择AVX2/SSE4.1/NEON向量化实现，结果与av_base64_decode一致(遇到'='或'\0'结束)
+ * @param out 输出缓存，至少BASE64_DECODE_SIZE(in_size)字节
+ * @return 解码后的长度，输入非法时返回-1
+ * Decode base64 with the AVX2/SSE4.1/NEON vectorized implementation picked by the cpu, the output is the same as av_base64_decode (stops at '=' or '\0')
+ * @param out Output buffer of at least BASE64_DECODE_SIZE(in_size) bytes
+ * @return Decoded length, or -1 for invalid input
+ */
+int base64Decode(uint8_t *out, const char *in, size_t in_size);
+
 
 /**
  * 编码base64
@@ -78,4 +108,18 @@ std::string encodeBase64(const std::string &txt);
  */
 std::string decodeBase64(const std::string &txt);
 
+/**
+ * 编码base64并直接写入buffer(覆盖原有数据)，复用buffer的内存，不经过std::string
+ * Encode base64 directly into the buffer (overwriting its data), reusing the buffer memory without going through std::string
+ */
+void encodeBase64(const char *data, size_t size, toolkit::BufferRaw &out);
+
+/**
+ * 解码base64并直接写入buffer(覆盖原有数据)，复用buffer的内存，不经过std::string
+ * @return 输入是否合法
+ * Decode base64 directly into the buffer (overwriting its data), reusing the buffer memory without going through std::string
+ * @return Whether the input is valid
+ */
+bool decodeBase64(const char *data, size_t size, toolkit::BufferRaw &out);
+
 #endif /* AVUTIL_BASE64_H */
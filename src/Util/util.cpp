@@ -23,6 +23,7 @@
 #include "onceToken.h"
 #include "logger.h"
 #include "uv_errno.h"
+#include "TscClock.h"
 #include "Network/sockutil.h"
 
 #if defined(_WIN32)
@@ -426,68 +427,20 @@ static inline uint64_t getCurrentMicrosecondOrigin() {
 #endif
 }
 
-static atomic<uint64_t> s_currentMicrosecond(0);
-static atomic<uint64_t> s_currentMillisecond(0);
-static atomic<uint64_t> s_currentMicrosecond_system(getCurrentMicrosecondOrigin());
-static atomic<uint64_t> s_currentMillisecond_system(getCurrentMicrosecondOrigin() / 1000);
-
-static inline bool initMillisecondThread() {
-    auto running = std::make_shared<bool>(true);
-    auto lam = [running]() {
-        // 确该保线程退出前日志打印可用
-        auto logger = Logger::Instance().shared_from_this();
-        setThreadName("stamp thread");
-        DebugL << "Stamp thread started";
-        uint64_t last = getCurrentMicrosecondOrigin();
-        uint64_t now;
-        uint64_t microsecond = 0;
-        while (*running) {
-            now = getCurrentMicrosecondOrigin();
-            //记录系统时间戳，可回退  [AUTO-TRANSLATED:495a0114]
-            //Record system timestamp, can be rolled back
-            s_currentMicrosecond_system.store(now, memory_order_release);
-            s_currentMillisecond_system.store(now / 1000, memory_order_release);
-
-            //记录流逝时间戳，不可回退  [AUTO-TRANSLATED:7f3a9da3]
-            //Record elapsed timestamp, cannot be rolled back
-            int64_t expired = now - last;
-            last = now;
-            if (expired > 0 && expired < 1000 * 1000) {
-                //流逝时间处于0~1000ms之间，那么是合理的，说明没有调整系统时间  [AUTO-TRANSLATED:566e1001]
-                //If the elapsed time is between 0~1000ms, it is reasonable, indicating that the system time has not been adjusted
-                microsecond += expired;
-                s_currentMicrosecond.store(microsecond, memory_order_release);
-                s_currentMillisecond.store(microsecond / 1000, memory_order_release);
-            } else if (expired != 0) {
-                WarnL << "Stamp expired is abnormal: " << expired;
-            }
-            //休眠0.5 ms  [AUTO-TRANSLATED:5e20acdd]
-            //Sleep for 0.5 ms
-            usleep(500);
-        }
-    };
-    static std::shared_ptr<std::thread> s_thread(new std::thread(lam), [running](std::thread *t) {
-        *running = false;
-        t->join();
-        delete t;
-    });
-    return true;
-}
-
+// 流逝时间戳由TscClock提供(TSC或vDSO clock_gettime)，不再需要每0.5ms唤醒一次的时间戳线程
+// The elapsed timestamp comes from TscClock (TSC or vDSO clock_gettime), the stamp thread waking up every 0.5ms is no longer needed
 uint64_t getCurrentMillisecond(bool system_time) {
-    static bool flag = initMillisecondThread();
     if (system_time) {
-        return s_currentMillisecond_system.load(memory_order_acquire);
+        return getCurrentMicrosecondOrigin() / 1000;
     }
-    return s_currentMillisecond.load(memory_order_acquire);
+    return TscClock::now() / 1000000;
 }
 
 uint64_t getCurrentMicrosecond(bool system_time) {
-    static bool flag = initMillisecondThread();
     if (system_time) {
-        return s_currentMicrosecond_system.load(memory_order_acquire);
+        return getCurrentMicrosecondOrigin();
     }
-    return s_currentMicrosecond.load(memory_order_acquire);
+    return TscClock::now() / 1000;
 }
 
 string getTimeStr(const char *fmt, time_t time) {
@@ -0,0 +1,116 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <random>
+#include <cstring>
+#include "Util/base64.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Network/Buffer.h"
+
+using namespace std;
+using namespace toolkit;
+
+static const char kChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 随机数据与随机(可能非法的)base64字符串，与标量实现av_base64_encode/av_base64_decode比对结果
+// Compare random data and random (possibly invalid) base64 strings with the scalar av_base64_encode/av_base64_decode
+static bool fuzzTest(int rounds) {
+    mt19937 rng(0);
+    string data, expect, actual;
+    for (int i = 0; i < rounds; ++i) {
+        size_t size = rng() % 300;
+        data.resize(size);
+        for (auto &ch : data) {
+            ch = (char)rng();
+        }
+        expect.resize(AV_BASE64_SIZE(size));
+        av_base64_encode((char *)expect.data(), expect.size(), (const uint8_t *)data.data(), size);
+        expect.resize(strlen(expect.data()));
+        if (encodeBase64(data) != (size ? expect : "")) {
+            ErrorL << "encode mismatch, size:" << size;
+            return false;
+        }
+
+        // 在合法字符串中随机插入非法字符、'='或'\0'
+        // Randomly insert invalid characters, '=' or '\0' into a valid string
+        string text = expect;
+        while (!text.empty() && text.back() == '=') {
+            text.pop_back();
+        }
+        if (!text.empty() && rng() % 2) {
+            static const char kInvalid[] = { '=', '\0', '-', '_', ' ', '\n', '@', '[', '`', '{', ':', (char)0x80, (char)0xff };
+            text[rng() % text.size()] = kInvalid[rng() % sizeof(kInvalid)];
+        }
+        if (!text.empty() && rng() % 4 == 0) {
+            text[rng() % text.size()] = kChars[rng() % 64];
+        }
+
+        string expect_out(BASE64_DECODE_SIZE(text.size()), '\0');
+        auto expect_size = av_base64_decode((uint8_t *)expect_out.data(), text.c_str(), expect_out.size());
+        string actual_out(BASE64_DECODE_SIZE(text.size()), '\0');
+        auto actual_size = base64Decode((uint8_t *)actual_out.data(), text.data(), text.size());
+        if (expect_size != actual_size || (expect_size > 0 && memcmp(expect_out.data(), actual_out.data(), expect_size))) {
+            ErrorL << "decode mismatch, text:" << text << ", expect:" << expect_size << ", actual:" << actual_size;
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename FUNC>
+static void benchmark(const char *name, size_t bytes, int rounds, FUNC &&func) {
+    Ticker ticker;
+    for (int i = 0; i < rounds; ++i) {
+        func();
+    }
+    auto ms = ticker.elapsedTime();
+    InfoL << name << ": " << (ms ? bytes * rounds / 1024 / 1024 * 1000 / ms : 0) << " MB/s";
+}
+
+int main() {
+    //设置日志
+    // Set log
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    InfoL << "fuzz test " << (fuzzTest(200000) ? "passed" : "failed");
+
+    string data(1024 * 1024, '\0');
+    mt19937 rng(1);
+    for (auto &ch : data) {
+        ch = (char)rng();
+    }
+    auto text = encodeBase64(data);
+    string out(AV_BASE64_SIZE(data.size()), '\0');
+    const int rounds = 200;
+
+    benchmark("av_base64_encode", data.size(), rounds, [&]() {
+        av_base64_encode((char *)out.data(), out.size(), (const uint8_t *)data.data(), data.size());
+    });
+    benchmark("base64Encode", data.size(), rounds, [&]() {
+        base64Encode((char *)out.data(), (const uint8_t *)data.data(), data.size());
+    });
+    benchmark("av_base64_decode", text.size(), rounds, [&]() {
+        av_base64_decode((uint8_t *)out.data(), text.data(), out.size());
+    });
+    benchmark("base64Decode", text.size(), rounds, [&]() {
+        base64Decode((uint8_t *)out.data(), text.data(), text.size());
+    });
+
+    // 直接编解码到BufferRaw
+    // Encode and decode directly into BufferRaw
+    auto buffer = BufferRaw::create();
+    encodeBase64("abc:def", 7, *buffer);
+    InfoL << "encode into buffer: " << buffer->toString();
+    auto decoded = BufferRaw::create();
+    decodeBase64(buffer->data(), buffer->size(), *decoded);
+    InfoL << "decode into buffer: " << decoded->toString();
+    return 0;
+}
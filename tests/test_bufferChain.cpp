@@ -0,0 +1,81 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "Util/logger.h"
+#include "Util/uv_errno.h"
+#include "Network/Buffer.h"
+#include "Network/BufferSock.h"
+#include "Network/sockutil.h"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+int main() {
+    //设置日志
+    // Set log
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    // 多个包共享同一负载，各自加上不同的头部，不拷贝负载
+    // Several packets share one payload, each with its own header, without copying the payload
+    auto payload = std::make_shared<BufferString>(string(64 * 1024, 'p'));
+    auto packet = BufferChain::create();
+    packet->append(payload, 0, 1000);
+    packet->prepend("header|");
+    packet->append("|tailer");
+    InfoL << "packet size:" << packet->size() << " slices:" << packet->slices().size();
+
+    // 截取与拆分同样只复制分片描述，不复制数据
+    // Slicing and splitting only copy slice descriptors, not the data
+    auto body = packet->slice(7, 1000);
+    auto tail = packet->split(1007);
+    InfoL << "body size:" << body->size() << " head:" << packet->size() << " tail:" << tail->toString();
+
+#if !defined(_WIN32)
+    // BufferChain交给发送列队后，每个分片直接作为一段iovec发送
+    // Once handed to the send queue, each slice of a BufferChain is sent directly as one iovec
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+        ErrorL << "socketpair failed: " << get_uv_errmsg();
+        return -1;
+    }
+    SockUtil::setNoBlocked(fds[0]);
+
+    List<std::pair<Buffer::Ptr, bool> > list;
+    string expect;
+    for (int i = 0; i < 10; ++i) {
+        auto chain = BufferChain::create();
+        chain->append(payload, i * 100, 2000);
+        chain->prepend(to_string(i) + "|");
+        expect += chain->toString();
+        list.emplace_back(std::move(chain), false);
+    }
+    int success = 0;
+    auto send_list = BufferList::create(std::move(list), [&](const Buffer::Ptr &, bool ok) { success += ok; }, false);
+
+    string received;
+    char buf[16 * 1024];
+    while (!send_list->empty()) {
+        send_list->send(fds[0], 0);
+        ssize_t n;
+        while ((n = recv(fds[1], buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+            received.append(buf, n);
+        }
+    }
+    InfoL << "packets sent:" << success << ", data " << (received == expect ? "matches" : "mismatches");
+    close(fds[0]);
+    close(fds[1]);
+#endif
+    return 0;
+}
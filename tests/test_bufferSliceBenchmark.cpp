@@ -0,0 +1,87 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <vector>
+#include <cstring>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Network/Buffer.h"
+#include "Network/BufferSlice.h"
+
+using namespace std;
+using namespace toolkit;
+
+// 模拟每次读取64KB，拆分为50个包，每个包转发给若干个消费者
+// Simulate reading 64KB each time, splitting it into 50 packets and forwarding every packet to several consumers
+static constexpr size_t kReadSize = 64 * 1024;
+static constexpr size_t kPacketCount = 50;
+static constexpr size_t kPacketSize = kReadSize / kPacketCount;
+
+template <typename Packet, typename Read, typename Split>
+static void benchmarkDemux(const char *name, int rounds, int consumers, Read &&read, Split &&split) {
+    vector<vector<Packet>> queues(consumers);
+    for (auto &queue : queues) {
+        queue.reserve(kPacketCount);
+    }
+    size_t bytes = 0;
+    Ticker ticker;
+    for (int i = 0; i < rounds; ++i) {
+        auto buffer = read();
+        for (size_t j = 0; j < kPacketCount; ++j) {
+            auto packet = split(buffer, j * kPacketSize, kPacketSize);
+            for (auto &queue : queues) {
+                queue.emplace_back(packet);
+            }
+        }
+        // 消费者处理完毕，释放包
+        // Consumers are done, release the packets
+        for (auto &queue : queues) {
+            for (auto &packet : queue) {
+                bytes += packet->size();
+            }
+            queue.clear();
+        }
+    }
+    auto ms = ticker.elapsedTime();
+    auto packets = (uint64_t)rounds * kPacketCount;
+    InfoL << name << " consumers:" << consumers << " packets:" << packets << " cost:" << ms << "ms, "
+          << (ms ? packets * 1000 / ms : 0) << " packets/s, forwarded bytes:" << bytes;
+}
+
+// 让BufferSlice与Buffer::Ptr一样通过->访问
+// Let BufferSlice be accessed with -> just like Buffer::Ptr
+struct SlicePacket {
+    BufferSlice slice;
+    const BufferSlice *operator->() const { return &slice; }
+};
+
+int main() {
+    //设置日志
+    // Set log
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    const int rounds = 100000;
+    for (int consumers : { 1, 4 }) {
+        benchmarkDemux<Buffer::Ptr>("BufferOffset", rounds, consumers, []() {
+            auto buffer = BufferRaw::create(kReadSize);
+            buffer->setSize(kReadSize);
+            return buffer;
+        }, [](const BufferRaw::Ptr &buffer, size_t offset, size_t len) -> Buffer::Ptr {
+            return std::make_shared<BufferOffset<BufferRaw::Ptr>>(buffer, offset, len);
+        });
+
+        benchmarkDemux<SlicePacket>("BufferSlice", rounds, consumers, []() {
+            return BufferSlice::create(kReadSize);
+        }, [](const BufferSlice &buffer, size_t offset, size_t len) {
+            return SlicePacket { buffer.slice(offset, len) };
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cstring>
+#include <cstdlib>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Network/Buffer.h"
+#include "Network/BufferStream.h"
+
+using namespace std;
+using namespace toolkit;
+
+static const string kRequest = "GET /live/test.flv HTTP/1.1\r\n"
+                               "Host: 127.0.0.1\r\n"
+                               "User-Agent: ZLToolKit\r\n"
+                               "Connection: keep-alive\r\n\r\n";
+
+// 模拟解析器：按随机大小分片追加网络数据，每解析出一个完整请求头就从头部删除
+// Simulate a parser: append network data in chunks of random size, erase every complete request header from the head once parsed
+template <typename BUFFER, typename APPEND, typename ERASE>
+static void benchmarkParse(const char *name, int rounds, APPEND &&append, ERASE &&erase) {
+    string stream;
+    for (int i = 0; i < 64; ++i) {
+        stream.append(kRequest);
+    }
+    srand(0);
+    BUFFER buffer;
+    size_t parsed = 0;
+    Ticker ticker;
+    for (int i = 0; i < rounds; ++i) {
+        size_t pos = 0;
+        while (pos < stream.size()) {
+            auto len = std::min<size_t>(stream.size() - pos, 1 + rand() % 1460);
+            append(buffer, stream.data() + pos, len);
+            pos += len;
+            const char *end;
+            while ((end = strstr(buffer.data(), "\r\n\r\n"))) {
+                ++parsed;
+                erase(buffer, end + 4 - buffer.data());
+            }
+        }
+    }
+    InfoL << name << " parsed:" << parsed << " cost:" << ticker.elapsedTime() << "ms, left:" << buffer.size();
+}
+
+int main() {
+    //设置日志
+    // Set log
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    const int rounds = 20000;
+    benchmarkParse<BufferLikeString>("BufferLikeString", rounds, [](BufferLikeString &buffer, const char *data, size_t len) {
+        buffer.append(data, len);
+    }, [](BufferLikeString &buffer, size_t len) {
+        buffer.erase(0, len);
+    });
+
+    benchmarkParse<BufferStream>("BufferStream", rounds, [](BufferStream &buffer, const char *data, size_t len) {
+        buffer.append(data, len);
+    }, [](BufferStream &buffer, size_t len) {
+        buffer.consume(len);
+    });
+
+    // 直接接收到尾部空间，并检查内存块复用
+    // Receive into the tail space directly, and check that memory blocks are reused
+    BufferStream stream;
+    auto ptr = stream.prepare(kRequest.size());
+    memcpy(ptr, kRequest.data(), kRequest.size());
+    stream.commit(kRequest.size());
+    auto block = stream.data();
+    stream.release();
+    stream.append(kRequest);
+    InfoL << "block reused:" << (stream.data() == block) << ", capacity:" << stream.getCapacity() << ", data:\n" << stream.data();
+    return 0;
+}
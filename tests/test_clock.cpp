@@ -0,0 +1,113 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/TscClock.h"
+
+using namespace std;
+using namespace toolkit;
+
+// 测试单次调用耗时
+// Measure the cost of a single call
+template <typename FUNC>
+static void benchmarkCall(const char *name, FUNC &&func) {
+    const int count = 10 * 1000 * 1000;
+    uint64_t sum = 0;
+    auto start = TscClock::monotonicNanosecond();
+    for (int i = 0; i < count; ++i) {
+        sum += func();
+    }
+    auto cost = TscClock::monotonicNanosecond() - start;
+    InfoL << name << ": " << (double)cost / count << " ns/call (" << sum % 10 << ")";
+}
+
+int main() {
+    //设置日志
+    // Set log
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    InfoL << "tsc enabled:" << TscClock::isTscEnabled() << ", frequency:" << TscClock::getTscFrequency() << "Hz";
+
+    benchmarkCall("TscClock::now", []() { return TscClock::now(); });
+    benchmarkCall("clock_gettime(CLOCK_MONOTONIC)", []() { return TscClock::monotonicNanosecond(); });
+    benchmarkCall("steady_clock::now", []() { return (uint64_t)chrono::steady_clock::now().time_since_epoch().count(); });
+    benchmarkCall("getCurrentMicrosecond", []() { return getCurrentMicrosecond(); });
+    benchmarkCall("getCurrentMicrosecond(system_time)", []() { return getCurrentMicrosecond(true); });
+
+    // 与系统单调时钟比对误差，并检查时间不回退
+    // Compare with the system monotonic clock, and check that time never goes backwards
+    auto measureError = []() {
+        // 取前后两次单调时钟间隔最小的一次，排除被调度的干扰
+        // Keep the sample with the smallest gap between the two monotonic reads, which filters out preemption
+        uint64_t min_gap = UINT64_MAX;
+        int64_t error = 0;
+        for (int i = 0; i < 1000; ++i) {
+            auto begin = TscClock::monotonicNanosecond();
+            auto now = TscClock::now();
+            auto end = TscClock::monotonicNanosecond();
+            if (end - begin < min_gap) {
+                min_gap = end - begin;
+                error = (int64_t)now - (int64_t)(begin + (end - begin) / 2);
+            }
+        }
+        return error;
+    };
+    auto offset = measureError();
+    uint64_t last = 0;
+    for (int i = 1; i <= 10; ++i) {
+        this_thread::sleep_for(chrono::milliseconds(500));
+        for (int j = 0; j < 1000; ++j) {
+            auto now = TscClock::now();
+            if (now < last) {
+                WarnL << "time goes backwards: " << last << " -> " << now;
+            }
+            last = now;
+        }
+        InfoL << "elapsed:" << i * 500 << "ms, error:" << measureError() - offset << "ns, frequency:" << TscClock::getTscFrequency() << "Hz";
+    }
+
+    // 跨线程检查：一个线程读到的时间发布后，其他线程之后读到的时间不能更早
+    // Cross thread check: once a time read by one thread is published, a later read on another thread must not be earlier
+    atomic<uint64_t> published_ns { 0 };
+    atomic<uint64_t> published_ms { 0 };
+    atomic<uint64_t> backwards { 0 };
+    auto publishMax = [](atomic<uint64_t> &target, uint64_t value) {
+        auto old = target.load();
+        while (value > old && !target.compare_exchange_weak(old, value)) {
+        }
+    };
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&]() {
+            auto deadline = TscClock::monotonicNanosecond() + 2000 * 1000 * 1000ULL;
+            while (TscClock::monotonicNanosecond() < deadline) {
+                auto prev_ns = published_ns.load();
+                auto prev_ms = published_ms.load();
+                auto now_ns = TscClock::now();
+                auto now_ms = getCurrentMillisecond();
+                if (now_ns < prev_ns || now_ms < prev_ms) {
+                    ++backwards;
+                }
+                publishMax(published_ns, now_ns);
+                publishMax(published_ms, now_ms);
+            }
+        });
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+    InfoL << "cross thread backwards reads: " << backwards;
+    return backwards ? -1 : 0;
+}
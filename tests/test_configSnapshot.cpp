@@ -0,0 +1,175 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include <thread>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Util/ConfigSnapshot.h"
+
+using namespace std;
+using namespace toolkit;
+
+static constexpr int kReads = 2000000;
+
+static bool check(const char *name, bool ok) {
+    if (!ok) {
+        ErrorL << "check failed: " << name;
+    }
+    return ok;
+}
+
+int main() {
+    //初始化日志系统
+    // Initialize the logging system
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    auto &ini = mINI::Instance();
+    ini["general.maxStreamWaitMS"] = 15000;
+    ini["general.enableVhost"] = true;
+    ini["rtp.lowLatency"] = 0;
+    ini["rtp.videoMtuSize"] = "1400";
+    ini["http.rootPath"] = "./www";
+    for (int i = 0; i < 200; ++i) {
+        ini["filler.key" + to_string(i)] = i;
+    }
+
+    // 启动时把配置名转换为句柄
+    // Turn the config names into handles at startup
+    auto &store = ConfigStore::Instance();
+    auto kMaxWait = store.intern("general.maxStreamWaitMS");
+    auto kVhost = store.intern("general.enableVhost");
+    auto kMtu = store.intern("rtp.videoMtuSize");
+    auto kRoot = store.intern("http.rootPath");
+    auto kMissing = store.intern("rtp.notExist");
+    store.publish(ini);
+
+    bool ok = true;
+    ok &= check("int value", store.get<int>(kMaxWait) == 15000);
+    ok &= check("bool value", store.get<bool>(kVhost));
+    ok &= check("uint16_t value", store.get<uint16_t>(kMtu) == 1400);
+    ok &= check("string value", store.get<string>(kRoot) == "./www");
+    ok &= check("missing value", !(*store.current())[kMissing].exists());
+    ok &= check("intern again", store.intern("rtp.videoMtuSize") == kMtu);
+
+    // 重新加载时只通知变化的配置项
+    // Only the changed items are notified on reload
+    vector<ConfigKey> changed;
+    store.addListener(&changed, [&](const ConfigSnapshot::Ptr &snapshot, const vector<ConfigKey> &keys) {
+        changed = keys;
+        for (auto key : keys) {
+            InfoL << "config changed: " << store.keyName(key) << " = " << (*snapshot)[key].asString() << ", version:" << snapshot->version();
+        }
+    });
+    ini["rtp.videoMtuSize"] = 1200;
+    ini["rtp.notExist"] = "now exists";
+    store.publish(ini);
+    ok &= check("reload changed", changed.size() == 2 && store.get<int>(kMtu) == 1200 && (*store.current())[kMissing].exists());
+    changed.clear();
+    store.publish(ini);
+    ok &= check("reload unchanged", changed.empty());
+    store.delListener(&changed);
+
+    // 回调中添加/删除监听者
+    // Add and remove listeners from inside a callback
+    int self_removed = 0;
+    store.addListener(&self_removed, [&](const ConfigSnapshot::Ptr &, const vector<ConfigKey> &) {
+        ++self_removed;
+        store.delListener(&self_removed);
+        for (int i = 0; i < 64; ++i) {
+            store.addListener((char *)&self_removed + 1 + i, [](const ConfigSnapshot::Ptr &, const vector<ConfigKey> &) {});
+        }
+    });
+    ini["rtp.videoMtuSize"] = 1300;
+    store.publish(ini);
+    ini["rtp.videoMtuSize"] = 1200;
+    store.publish(ini);
+    ok &= check("listener changed in callback", self_removed == 1);
+    for (int i = 0; i < 64; ++i) {
+        store.delListener((char *)&self_removed + 1 + i);
+    }
+
+    // 持有的快照不受之后的发布与读取影响
+    // A held snapshot is not affected by later publishes and reads
+    auto held = store.current();
+    ini["rtp.videoMtuSize"] = 1000;
+    store.publish(ini);
+    ok &= check("read after publish", store.get<int>(kMtu) == 1000);
+    ok &= check("held snapshot", held->get<int>(kMtu) == 1200 && held->get<string>(kRoot) == "./www");
+    ini["rtp.videoMtuSize"] = 1200;
+    store.publish(ini);
+    held = nullptr;
+    if (!ok) {
+        return -1;
+    }
+
+    // 热路径读取：按字符串查找并转换 vs 句柄读取预解析的值
+    // Hot path read: string lookup plus conversion vs handle read of the pre-parsed value
+    {
+        Ticker ticker;
+        int64_t sum = 0;
+        for (int i = 0; i < kReads; ++i) {
+            sum += ini["general.maxStreamWaitMS"].as<int>();
+        }
+        auto ms = ticker.elapsedTime();
+        InfoL << "mINI lookup read: " << ms * 1e6 / kReads << "ns/op, sum:" << sum;
+    }
+    {
+        Ticker ticker;
+        int64_t sum = 0;
+        for (int i = 0; i < kReads; ++i) {
+            sum += store.get<int>(kMaxWait);
+        }
+        auto ms = ticker.elapsedTime();
+        InfoL << "ConfigStore snapshot read: " << ms * 1e6 / kReads << "ns/op, sum:" << sum;
+    }
+
+    // 多个线程读取的同时不断重新加载，读取方始终看到完整一致的快照
+    // Reload continuously while several threads read, readers always see a complete consistent snapshot
+    {
+        int publishes = 0;
+        ini["general.maxStreamWaitMS"] = publishes;
+        ini["rtp.videoMtuSize"] = publishes;
+        store.publish(ini);
+        atomic<bool> exit_flag { false };
+        atomic<uint64_t> reads { 0 };
+        vector<thread> readers;
+        for (int i = 0; i < 4; ++i) {
+            readers.emplace_back([&]() {
+                uint64_t count = 0;
+                while (!exit_flag) {
+                    auto snapshot = store.current();
+                    // 每次发布时两个配置同时修改为相同的值
+                    // Each publish sets both items to the same value
+                    if (snapshot->get<int>(kMaxWait) != snapshot->get<int>(kMtu)) {
+                        ErrorL << "inconsistent snapshot";
+                        abort();
+                    }
+                    ++count;
+                }
+                reads += count;
+            });
+        }
+        Ticker ticker;
+        while (ticker.elapsedTime() < 1000) {
+            ini["general.maxStreamWaitMS"] = publishes;
+            ini["rtp.videoMtuSize"] = publishes;
+            store.publish(ini);
+            ++publishes;
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        exit_flag = true;
+        for (auto &th : readers) {
+            th.join();
+        }
+        InfoL << "concurrent: " << publishes << " publishes, " << reads << " consistent snapshot reads";
+    }
+    return 0;
+}
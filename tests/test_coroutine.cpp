@@ -0,0 +1,128 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <csignal>
+#include "Util/logger.h"
+#include "Network/CoSocket.h"
+
+using namespace std;
+using namespace toolkit;
+
+#if defined(__cpp_impl_coroutine)
+
+// 回显会话，以顺序代码的方式编写，无需回调
+// Echo session, written as sequential code without callbacks
+static CoTask<void> echoSession(Socket::Ptr sock) {
+    CoSocket session(std::move(sock));
+    while (auto buf = co_await session.read()) {
+        if (!co_await session.write(std::move(buf))) {
+            break;
+        }
+    }
+    InfoL << "echo session closed: " << session.getError();
+}
+
+static CoTask<void> echoServer(EventPoller::Ptr poller, uint16_t port) {
+    CoSocket server(poller);
+    if (!server.listen(port, "127.0.0.1")) {
+        ErrorL << "listen failed";
+        co_return;
+    }
+    while (auto sock = co_await server.accept()) {
+        coSpawn(sock->getPoller(), echoSession(sock));
+    }
+}
+
+static CoTask<uint64_t> echoOnce(CoSocket &client, const string &msg) {
+    Ticker ticker;
+    if (!co_await client.write(msg)) {
+        throw SockException(Err_other, "write failed");
+    }
+    size_t received = 0;
+    while (received < msg.size()) {
+        auto buf = co_await client.read();
+        if (!buf) {
+            throw client.getError();
+        }
+        received += buf->size();
+    }
+    co_return ticker.elapsedTime();
+}
+
+static CoTask<void> echoClient(EventPoller::Ptr poller, uint16_t port) {
+    // 等待服务器启动
+    // Wait for the server to start
+    co_await coSleep(poller, 100);
+    CoSocket client(poller);
+    auto err = co_await client.connect("127.0.0.1", port);
+    if (err) {
+        ErrorL << "connect failed: " << err;
+        co_return;
+    }
+    for (int i = 0; i < 10; ++i) {
+        auto ms = co_await echoOnce(client, "hello coroutine " + to_string(i));
+        InfoL << "echo " << i << " round trip: " << ms << "ms";
+        // 切换到其他poller再切回来
+        // Switch to another poller and back
+        co_await EventPollerPool::Instance().getPoller(false);
+        co_await poller;
+        co_await coYield(poller);
+    }
+    InfoL << "echo client done";
+}
+
+// 在read()中等待，返回后不再访问CoSocket，因为它可能已被其他协程销毁
+// Wait in read(), the CoSocket is not touched after it returns because another coroutine may have destroyed it
+static CoTask<void> readUntilDestroyed(CoSocket *client) {
+    auto buf = co_await client->read();
+    InfoL << "read woken up after the socket was destroyed, result: " << (buf ? "data" : "nullptr");
+}
+
+// 一个协程销毁CoSocket时，另一个挂起在read()中的协程会以错误结束等待，而不是永久挂起
+// When one coroutine destroys a CoSocket, another coroutine suspended in read() finishes its wait with an error instead of hanging forever
+static CoTask<void> destroyWhileReading(EventPoller::Ptr poller, uint16_t port) {
+    co_await coSleep(poller, 100);
+    auto client = std::make_shared<CoSocket>(poller);
+    auto err = co_await client->connect("127.0.0.1", port);
+    if (err) {
+        ErrorL << "connect failed: " << err;
+        co_return;
+    }
+    coSpawn(poller, readUntilDestroyed(client.get()));
+    co_await coSleep(poller, 50);
+    client = nullptr;
+    InfoL << "socket destroyed while another coroutine was reading";
+}
+
+int main() {
+    //初始化日志系统
+    // Initialize the logging system
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    static semaphore sem;
+    signal(SIGINT, [](int) { sem.post(); });
+
+    auto poller = EventPollerPool::Instance().getPoller();
+    coSpawn(poller, echoServer(poller, 9100));
+    coSpawn(poller, echoClient(poller, 9100));
+    coSpawn(poller, destroyWhileReading(poller, 9100));
+    sem.wait();
+    return 0;
+}
+
+#else
+
+int main() {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    WarnL << "C++20 coroutine is not enabled, please build with -DENABLE_CXX20_COROUTINE=ON";
+    return 0;
+}
+
+#endif // defined(__cpp_impl_coroutine)
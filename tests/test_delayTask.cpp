@@ -65,6 +65,10 @@ int main() {
     tag1->cancel();
     WarnL << "取消task 0、1";
 
+    // 定时任务实际执行时间相对截止时间的延迟分布
+    // Distribution of how late the delay tasks ran relative to their deadlines
+    InfoL << "timer late: " << EventPollerPool::Instance().getLatency(EventPoller::Latency_TimerLate).toString();
+
     //退出程序事件处理  [AUTO-TRANSLATED:80065cb7]
     // Exit program event handling
     static semaphore sem;
@@ -0,0 +1,103 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include <thread>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Poller/EventPoller.h"
+#include "Poller/EventWakeup.h"
+#include "Poller/PipeWrap.h"
+#include "Network/sockutil.h"
+
+#if !defined(_WIN32)
+#include <poll.h>
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+#if !defined(_WIN32)
+// 对端线程poll等待唤醒fd，被唤醒后通过信号量通知本线程，统计跨线程唤醒的往返延时
+// The peer thread polls the wakeup fd and notifies this thread through a semaphore when woken up, measure the round trip latency of cross-thread wakeups
+template<typename Wake, typename Drain>
+static void benchmarkLatency(const char *name, int fd, int rounds, Wake &&wake, Drain &&drain) {
+    semaphore sem;
+    thread peer([&]() {
+        for (int i = 0; i < rounds; ++i) {
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            while (poll(&pfd, 1, -1) <= 0) {}
+            drain();
+            sem.post();
+        }
+    });
+    auto start = getCurrentMicrosecond();
+    for (int i = 0; i < rounds; ++i) {
+        wake();
+        sem.wait();
+    }
+    auto us = getCurrentMicrosecond() - start;
+    peer.join();
+    InfoL << name << " rounds:" << rounds << " avg wakeup round trip:" << (double)us / rounds << "us";
+}
+#endif
+
+int main() {
+    //初始化日志系统
+    // Initialize the logging system
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+#if !defined(_WIN32)
+    {
+        PipeWrap pipe;
+        SockUtil::setNoBlocked(pipe.readFD());
+        benchmarkLatency("PipeWrap", pipe.readFD(), 50000, [&]() { pipe.write("", 1); }, [&]() {
+            char buf[1024];
+            while (pipe.read(buf, sizeof(buf)) > 0) {}
+        });
+    }
+    {
+        EventWakeup wakeup;
+        benchmarkLatency("EventWakeup", wakeup.readFD(), 50000, [&]() { wakeup.wakeup(); }, [&]() { wakeup.drain(); });
+    }
+#endif
+
+    // 大量async()时，合并后的唤醒次数远小于任务数
+    // Under heavy async() posting, the number of coalesced wakeups is far less than the number of tasks
+    {
+        EventWakeup wakeup;
+        size_t syscalls = 0;
+        for (int i = 0; i < 1000000; ++i) {
+            syscalls += wakeup.wakeup();
+            if (i % 1000 == 0) {
+                wakeup.drain();
+            }
+        }
+        InfoL << "EventWakeup wakeups:1000000 drains:1000 syscalls:" << syscalls;
+    }
+
+    auto poller = EventPollerPool::Instance().getPoller();
+    atomic_llong count(0);
+    semaphore sem;
+    const long long total = 1000 * 1000;
+    Ticker ticker;
+    for (long long i = 0; i < total; ++i) {
+        poller->async([&]() {
+            if (++count == total) {
+                sem.post();
+            }
+        }, false);
+    }
+    auto post_ms = ticker.elapsedTime();
+    sem.wait();
+    InfoL << "EventPoller async tasks:" << total << " post cost:" << post_ms << "ms, total cost:" << ticker.elapsedTime() << "ms";
+    return 0;
+}
@@ -0,0 +1,151 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Util/logger.h"
+#include "Util/FlatHashMap.h"
+
+using namespace std;
+using namespace toolkit;
+
+// 与UdpServer::PeerIdType(C++11下)相同的18字节key
+// 18 bytes key, same as UdpServer::PeerIdType (under C++11)
+static vector<string> makeKeys(size_t count, uint32_t seed) {
+    mt19937_64 engine(seed);
+    vector<string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        string key(18, '\0');
+        auto port = static_cast<uint16_t>(engine());
+        auto ip = static_cast<uint32_t>(engine());
+        memcpy(&key[0], &port, sizeof(port));
+        key[12] = key[13] = (char)0xFF;
+        memcpy(&key[14], &ip, sizeof(ip));
+        keys.emplace_back(std::move(key));
+    }
+    return keys;
+}
+
+static double elapsedNs(const chrono::steady_clock::time_point &start) {
+    return (double)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+template <typename Map>
+static void benchmark(const char *name, const vector<string> &keys, const vector<string> &misses) {
+    Map map;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        map.emplace(keys[i], i);
+    }
+    auto insert_ns = elapsedNs(start);
+
+    size_t found = 0;
+    start = chrono::steady_clock::now();
+    for (int round = 0; round < 4; ++round) {
+        for (auto &key : keys) {
+            found += map.find(key) != map.end();
+        }
+    }
+    auto hit_ns = elapsedNs(start);
+
+    start = chrono::steady_clock::now();
+    for (auto &key : misses) {
+        found += map.find(key) != map.end();
+    }
+    auto miss_ns = elapsedNs(start);
+
+    start = chrono::steady_clock::now();
+    for (auto &key : keys) {
+        map.erase(key);
+    }
+    auto erase_ns = elapsedNs(start);
+
+    InfoL << name << " entries:" << keys.size()
+          << " insert:" << insert_ns / keys.size() << "ns/op"
+          << " hit:" << hit_ns / (keys.size() * 4) << "ns/op"
+          << " miss:" << miss_ns / misses.size() << "ns/op"
+          << " erase:" << erase_ns / keys.size() << "ns/op"
+          << " (found:" << found << ")";
+}
+
+// 与std::unordered_map做随机操作对比，验证行为一致
+// Compare random operations with std::unordered_map to verify the behavior is identical
+static bool checkEquivalence() {
+    FlatHashMap<uint64_t, uint64_t> flat;
+    unordered_map<uint64_t, uint64_t> stl;
+    mt19937_64 engine(1);
+    for (int i = 0; i < 1000000; ++i) {
+        auto key = engine() % 5000;
+        switch (engine() % 4) {
+            case 0:
+            case 1: {
+                auto ret0 = flat.emplace(key, i).second;
+                auto ret1 = stl.emplace(key, i).second;
+                if (ret0 != ret1) {
+                    return false;
+                }
+                break;
+            }
+            case 2: {
+                if (flat.erase(key) != stl.erase(key)) {
+                    return false;
+                }
+                break;
+            }
+            default: {
+                auto it0 = flat.find(key);
+                auto it1 = stl.find(key);
+                if ((it0 == flat.end()) != (it1 == stl.end()) || (it1 != stl.end() && it0->second != it1->second)) {
+                    return false;
+                }
+                break;
+            }
+        }
+    }
+    if (flat.size() != stl.size()) {
+        return false;
+    }
+    // 遍历时删除
+    // Erase while iterating
+    size_t count = 0;
+    for (auto it = flat.begin(); it != flat.end();) {
+        if (stl.find(it->first) == stl.end()) {
+            return false;
+        }
+        ++count;
+        it = flat.erase(it);
+    }
+    return count == stl.size() && flat.empty();
+}
+
+int main() {
+    //初始化日志系统  [AUTO-TRANSLATED:25c549de]
+    // Initialize the logging system
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    if (!checkEquivalence()) {
+        ErrorL << "FlatHashMap behaves differently from std::unordered_map";
+        return -1;
+    }
+    InfoL << "FlatHashMap equivalence check passed";
+
+    for (size_t count : { 10000, 100000, 1000000 }) {
+        auto keys = makeKeys(count, 2);
+        auto misses = makeKeys(count, 3);
+        benchmark<unordered_map<string, size_t>>("std::unordered_map", keys, misses);
+        benchmark<FlatHashMap<string, size_t>>("toolkit::FlatHashMap", keys, misses);
+    }
+    return 0;
+}
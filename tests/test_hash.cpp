@@ -0,0 +1,119 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <random>
+#include "Util/MD5.h"
+#include "Util/SHA1.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Network/Buffer.h"
+
+using namespace std;
+using namespace toolkit;
+
+static bool check(const char *name, const string &actual, const string &expect) {
+    if (actual != expect) {
+        ErrorL << name << " mismatch: " << actual << " != " << expect;
+        return false;
+    }
+    return true;
+}
+
+// 标准测试向量，以及分段update/BufferChain/多路计算与一次性计算的结果比对
+// Standard test vectors, and comparing chunked update/BufferChain/multi-buffer results with one-shot hashing
+static bool verify() {
+    bool ok = true;
+    ok &= check("sha1 abc", SHA1::encode("abc"), "a9993e364706816aba3e25717850c26c9cd0d89d");
+    ok &= check("sha1 448 bits", SHA1::encode("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"), "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+    ok &= check("sha1 million a", SHA1::encode(string(1000000, 'a')), "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+    ok &= check("md5 abc", MD5("abc").hexdigest(), "900150983cd24fb0d6963f7d28e17f72");
+    ok &= check("md5 million a", MD5(string(1000000, 'a')).hexdigest(), "7707d6ae4e027c70eea2a935c2296f21");
+
+    mt19937 rng(0);
+    vector<string> texts;
+    for (int i = 0; i < 2000; ++i) {
+        string text(rng() % 1000, '\0');
+        for (auto &ch : text) {
+            ch = (char)rng();
+        }
+        texts.emplace_back(std::move(text));
+    }
+    auto multi = MD5::hexdigestMulti(texts);
+    for (size_t i = 0; i < texts.size() && ok; ++i) {
+        auto &text = texts[i];
+        ok &= check("md5 multi", multi[i], MD5(text).hexdigest());
+
+        // 随机切分为多个slice放入BufferChain
+        // Split randomly into slices of a BufferChain
+        BufferChain chain;
+        for (size_t pos = 0; pos < text.size();) {
+            auto len = std::min<size_t>(text.size() - pos, 1 + rng() % 100);
+            chain.append(text.substr(pos, len));
+            pos += len;
+        }
+        SHA1 sha1;
+        sha1.update(chain);
+        ok &= check("sha1 chain", sha1.final(), SHA1::encode(text));
+        MD5 md5;
+        md5.update(chain);
+        ok &= check("md5 chain", md5.finalize().hexdigest(), MD5(text).hexdigest());
+    }
+    return ok;
+}
+
+template <typename FUNC>
+static void benchmark(const char *name, size_t bytes, int rounds, FUNC &&func) {
+    Ticker ticker;
+    for (int i = 0; i < rounds; ++i) {
+        func();
+    }
+    auto ms = ticker.elapsedTime();
+    InfoL << name << ": " << (ms ? bytes * rounds * 1000 / 1024 / 1024 / ms : 0) << " MB/s, "
+          << (ms ? (uint64_t)rounds * 1000 / ms : 0) << " calls/s";
+}
+
+int main() {
+    //设置日志
+    // Set log
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    InfoL << "sha-ni:" << SHA1::isHardwareAccelerated() << ", md5 lanes:" << MD5::multiLanes();
+    InfoL << "verify " << (verify() ? "passed" : "failed");
+
+    string big(1024 * 1024, 'x');
+    benchmark("SHA1 1MB", big.size(), 100, [&]() { SHA1::encode_bin(big); });
+    // WebSocket握手: base64(sha1(key + GUID))
+    // WebSocket handshake: base64(sha1(key + GUID))
+    string key = "dGhlIHNhbXBsZSBub25jZQ==258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    benchmark("SHA1 websocket key", key.size(), 500000, [&]() { SHA1::encode_bin(key); });
+    benchmark("MD5 1MB", big.size(), 100, [&]() { MD5 md5(big); });
+
+    // 大量独立的短消息(如摘要认证)与分片指纹
+    // Many independent short messages (such as digest auth) and segment fingerprints
+    for (size_t size : { 64, 4096 }) {
+        vector<string> texts(1024, string(size, 'y'));
+        vector<const char *> data;
+        vector<size_t> sizes;
+        for (auto &text : texts) {
+            data.emplace_back(text.data());
+            sizes.emplace_back(text.size());
+        }
+        vector<uint8_t> digests(texts.size() * 16);
+        benchmark(size == 64 ? "MD5 one by one 1024x64B" : "MD5 one by one 1024x4KB", size * texts.size(), 50, [&]() {
+            for (auto &text : texts) {
+                MD5(text).rawdigest();
+            }
+        });
+        benchmark(size == 64 ? "MD5 multi-buffer 1024x64B" : "MD5 multi-buffer 1024x4KB", size * texts.size(), 50, [&]() {
+            MD5::digestMulti(data.data(), sizes.data(), texts.size(), (uint8_t (*)[16])digests.data());
+        });
+    }
+    return 0;
+}
@@ -12,6 +12,8 @@
 #include "Util/util.h"
 #include "Util/logger.h"
 #include "Util/NoticeCenter.h"
+#include "Poller/EventPoller.h"
+#include "Thread/ThreadPool.h"
 using namespace std;
 using namespace toolkit;
 
@@ -21,6 +23,15 @@ using namespace toolkit;
 //广播名称2  [AUTO-TRANSLATED:50cd7f16]
 // Broadcast Name 2
 #define NOTICE_NAME2 "NOTICE_NAME2"
+//类型化事件，参数签名在编译期确定
+// Typed event, the argument signature is fixed at compile time
+NOTICE_EVENT_DECLARE(kNoticeTyped, void(int a, const string &d));
+//演示在类型化事件中中断广播
+// Demonstrates stopping the broadcast of a typed event
+NOTICE_EVENT_DECLARE(kNoticeInterrupt, void(int a));
+//演示异步监听绑定多线程执行器
+// Demonstrates an asynchronous listener bound to a multi-threaded executor
+NOTICE_EVENT_DECLARE(kNoticeOrdered, void(int seq));
 
 //程序退出标记  [AUTO-TRANSLATED:2fc12083]
 // Program Exit Flag
@@ -65,6 +76,55 @@ int main() {
                                              });
 
     });
+    //监听类型化事件，参数类型不匹配时编译报错
+    // Listen to the typed event, mismatched argument types fail to compile
+    NoticeChannel<kNoticeTyped>::addListener(0, [](int a, const string &d) {
+        TraceL << kNoticeTyped::eventName() << " " << a << " " << d;
+    });
+
+    //异步监听，回调在指定的EventPoller线程中批量执行，返回的队列可获取积压统计
+    // Asynchronous listener, the callback runs in batches in the given EventPoller thread, the returned queue provides backlog statistics
+    auto poller = EventPollerPool::Instance().getPoller();
+    auto queue = NoticeChannel<kNoticeTyped>::addAsyncListener(0, poller, [poller](int a, const string &d) {
+        TraceL << "async " << kNoticeTyped::eventName() << " " << a << " " << d << " in poller:" << poller->isCurrentThread();
+    });
+
+    //第一个监听者抛出InterruptException，后续监听者不再触发
+    // The first listener throws InterruptException, the following listeners are not triggered
+    NoticeChannel<kNoticeInterrupt>::addListener(0, [](int a) {
+        throw EventDispatcher::InterruptException();
+    });
+    NoticeChannel<kNoticeInterrupt>::addListener(0, [](int a) {
+        ErrorL << "should not be triggered";
+    });
+    InfoL << kNoticeInterrupt::eventName() << " triggered listeners:" << NoticeChannel<kNoticeInterrupt>::emit(1);
+
+    //绑定ThreadPool等多线程执行器时，监听者也不会并发执行，事件保持顺序
+    // Bound to a multi-threaded executor such as ThreadPool, the listener still never runs concurrently and events stay in order
+    {
+        auto pool = std::make_shared<ThreadPool>(4, ThreadPool::PRIORITY_NORMAL, true, false);
+        atomic<int> running { 0 };
+        atomic<int> disorder { 0 };
+        int expected = 0;
+        auto ordered = NoticeChannel<kNoticeOrdered>::addAsyncListener(0, pool, [&](int seq) {
+            if (++running != 1 || seq != expected) {
+                ++disorder;
+            }
+            expected = seq + 1;
+            --running;
+        });
+        for (int i = 0; i < 100000; ++i) {
+            NoticeChannel<kNoticeOrdered>::emit(i);
+        }
+        while (ordered->delivered() < 100000) {
+            usleep(1000);
+        }
+        NoticeChannel<kNoticeOrdered>::delListener(0);
+        InfoL << kNoticeOrdered::eventName() << " delivered:" << ordered->delivered() << " batches:" << ordered->batches()
+              << " concurrent or out of order:" << disorder;
+        pool->sync([]() {});
+    }
+
     int a = 0;
     while(!g_bExitFlag){
         const char *b = "b";
@@ -74,6 +134,9 @@ int main() {
         // Broadcast the Event Every 1 Second, If the Parameter Type is Uncertain, a Forced Conversion Can be Added
         NoticeCenter::Instance().emitEvent(NOTICE_NAME1,++a,(const char *)"b",c,d);
         NoticeCenter::Instance().emitEvent(NOTICE_NAME2,d,c,b,a);
+        NoticeChannel<kNoticeTyped>::emit(a, d);
+        InfoL << "async queue depth:" << queue->depth() << " max:" << queue->maxDepth()
+              << " delivered:" << queue->delivered() << " batches:" << queue->batches();
         sleep(1); // sleep 1 second
     }
     return 0;
@@ -13,8 +13,16 @@
 #include "Util/logger.h"
 #include "Util/util.h"
 #include "Util/RingBuffer.h"
+#include "Util/TimeTicker.h"
 #include "Thread/threadgroup.h"
+#include "Util/uv_errno.h"
+#include "Network/Buffer.h"
 #include <list>
+#if !defined(_WIN32)
+#include <limits.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#endif
 
 using namespace std;
 using namespace toolkit;
@@ -53,6 +61,129 @@ void doWrite(){
     }
 
 }
+#if !defined(_WIN32)
+//批量读取测试的帧数与帧大小
+// Frame count and frame size of the batch read test
+static constexpr int kFrames = 20000;
+static constexpr int kGopFrames = 500;
+static constexpr size_t kFrameSize = 1024;
+//媒体源每次解析出的帧数
+// Frames produced by the media source at a time
+static constexpr int kFramesPerWrite = 32;
+
+//模拟会话发送：每次writev最多IOV_MAX帧，返回系统调用次数
+// Simulate the session send: at most IOV_MAX frames per writev, returns the number of system calls
+static size_t sendFrames(int fd, const Buffer::Ptr *frames, size_t count) {
+    size_t calls = 0;
+    struct iovec iov[IOV_MAX];
+    for (size_t i = 0; i < count;) {
+        int n = 0;
+        for (; i < count && n < IOV_MAX; ++i, ++n) {
+            iov[n].iov_base = frames[i]->data();
+            iov[n].iov_len = frames[i]->size();
+        }
+        int idx = 0;
+        while (idx < n) {
+            auto ret = writev(fd, iov + idx, n - idx);
+            ++calls;
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return calls;
+            }
+            //跳过已发送部分
+            // Skip what has been sent
+            while (idx < n && (size_t)ret >= iov[idx].iov_len) {
+                ret -= iov[idx].iov_len;
+                ++idx;
+            }
+            if (idx < n) {
+                iov[idx].iov_base = (char *)iov[idx].iov_base + ret;
+                iov[idx].iov_len -= ret;
+            }
+        }
+    }
+    return calls;
+}
+
+//逐帧回调(每帧一次send)与批量回调(每批一次writev)对比
+// Per frame callback (one send per frame) vs batch callback (one writev per batch)
+static bool benchmarkReadCB(bool batch) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        WarnL << "socketpair failed: " << get_uv_errmsg();
+        return false;
+    }
+    //对端线程读取并丢弃数据，模拟播放器
+    // The peer thread reads and drops the data, simulating the player
+    thread drainer([&]() {
+        char buf[64 * 1024];
+        while (read(fds[1], buf, sizeof(buf)) > 0) {}
+    });
+
+    auto frame = BufferRaw::create();
+    frame->assign(string(kFrameSize, 'x').data(), kFrameSize);
+    auto poller = EventPollerPool::Instance().getPoller();
+    auto ring = std::make_shared<RingBuffer<Buffer::Ptr>>(1024);
+    //先缓存一个gop，attach时回放
+    // Cache a gop first, it is replayed on attach
+    for (int i = 0; i < kGopFrames; ++i) {
+        ring->write(frame, i == 0);
+    }
+
+    RingBuffer<Buffer::Ptr>::RingReader::Ptr reader;
+    size_t callbacks = 0, send_calls = 0, frames = 0, frames_at_msg = 0;
+    poller->sync([&]() {
+        reader = ring->attach(poller, true);
+        reader->setMessageCB([&](const Any &) { frames_at_msg = frames; });
+        if (batch) {
+            reader->setReadBatchCB([&](const vector<Buffer::Ptr> &pkts) {
+                ++callbacks;
+                frames += pkts.size();
+                send_calls += sendFrames(fds[0], pkts.data(), pkts.size());
+            });
+        } else {
+            reader->setReadCB([&](const Buffer::Ptr &pkt) {
+                ++callbacks;
+                ++frames;
+                send_calls += sendFrames(fds[0], &pkt, 1);
+            });
+        }
+    });
+
+    Ticker ticker;
+    for (int i = 0; i < kFrames; i += kFramesPerWrite) {
+        //媒体源在poller线程中每次解析出多帧，读取器在之后的一次唤醒中收到这些帧
+        // The media source produces several frames at a time in the poller thread, the reader gets them in one later wake
+        poller->sync([&]() {
+            for (int j = 0; j < kFramesPerWrite; ++j) {
+                ring->write(frame, j == 0);
+            }
+        });
+    }
+    //消息必须在此前写入的数据之后到达
+    // The message must arrive after the data written before it
+    ring->sendMessage(Any());
+    poller->sync([]() {});
+    auto ms = ticker.elapsedTime();
+
+    poller->sync([&]() { reader = nullptr; });
+    ::close(fds[0]);
+    drainer.join();
+    ::close(fds[1]);
+
+    size_t expected = kGopFrames + (kFrames + kFramesPerWrite - 1) / kFramesPerWrite * kFramesPerWrite;
+    InfoL << (batch ? "batch" : "per frame") << " read callback: " << frames << " frames, " << callbacks << " callbacks, "
+          << send_calls << " send calls, " << ms << "ms";
+    if (frames != expected || frames_at_msg != expected) {
+        ErrorL << "frames mismatch, expected:" << expected << ", received:" << frames << ", before message:" << frames_at_msg;
+        return false;
+    }
+    return true;
+}
+#endif
+
 int main() {
     //初始化日志  [AUTO-TRANSLATED:371bb4e5]
     // Initialize log
@@ -108,7 +239,15 @@ int main() {
     // Remove reference to EventPoller object
     ringReader.reset();
     sleep(1);
+
+#if !defined(_WIN32)
+    bool ok = benchmarkReadCB(false);
+    ok &= benchmarkReadCB(true);
+    sleep(1);
+    return ok ? 0 : -1;
+#else
     return 0;
+#endif
 }
 
 
@@ -0,0 +1,109 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include <thread>
+#include "Util/logger.h"
+#include "Util/uv_errno.h"
+#include "Network/Socket.h"
+#include "Network/sockutil.h"
+#include "Thread/semaphore.h"
+
+using namespace std;
+using namespace toolkit;
+
+//发送的块数与块大小，远大于内核socket缓存，使发送缓存积压
+// Number and size of the blocks sent, far larger than the kernel socket buffer so the send buffer backs up
+static constexpr int kBlocks = 256;
+static constexpr size_t kBlockSize = 64 * 1024;
+
+static bool check(const char *name, bool ok) {
+    if (!ok) {
+        ErrorL << "check failed: " << name;
+    }
+    return ok;
+}
+
+int main() {
+    //初始化日志系统
+    // Initialize the logging system
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+#if defined(_WIN32)
+    return 0;
+#else
+    //对端只接受连接不读取数据
+    // The peer only accepts the connection and never reads
+    auto listen_fd = SockUtil::listen(0, "127.0.0.1");
+    if (listen_fd == -1) {
+        ErrorL << "listen failed: " << get_uv_errmsg();
+        return -1;
+    }
+    auto port = SockUtil::get_local_port(listen_fd);
+    SockUtil::setNoBlocked(listen_fd, false);
+
+    auto poller = EventPollerPool::Instance().getPoller();
+    auto sock = Socket::createSocket(poller);
+    semaphore connected;
+    atomic<bool> errored { false };
+    sock->connect("127.0.0.1", port, [&](const SockException &err) {
+        if (err) {
+            ErrorL << "connect failed: " << err;
+        }
+        connected.post();
+    });
+    auto peer_fd = ::accept(listen_fd, nullptr, nullptr);
+    connected.wait();
+    sock->setOnErr([&](const SockException &err) {
+        InfoL << "socket error: " << err;
+        errored = true;
+    });
+
+    poller->sync([&]() {
+        //不监听读事件，使连接重置由可写事件中的发送失败发现
+        // Do not listen for read events, so the reset is found by the failed send in the writable event
+        sock->enableRecv(false);
+        for (int i = 0; i < kBlocks; ++i) {
+            auto buf = BufferRaw::create();
+            buf->setCapacity(kBlockSize);
+            buf->setSize(kBlockSize);
+            sock->send(std::move(buf));
+        }
+    });
+    this_thread::sleep_for(chrono::milliseconds(200));
+    bool ok = true;
+    InfoL << "backlog: socket " << sock->getSendBufferBytes() << ", poller " << poller->getSendBufferBytes() << ", total " << Socket::getTotalSendBufferBytes();
+    ok &= check("backlog", sock->getSendBufferBytes() > 0 && Socket::getTotalSendBufferBytes() == sock->getSendBufferBytes());
+
+    //对端以RST方式断开，发送缓存仍有积压
+    // The peer resets the connection while the send buffer still has a backlog
+    struct linger so_linger = { 1, 0 };
+    setsockopt(peer_fd, SOL_SOCKET, SO_LINGER, (char *)&so_linger, sizeof(so_linger));
+    ::close(peer_fd);
+    for (int i = 0; i < 100 && !errored; ++i) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    //等待emitErr中异步的closeSock完成
+    // Wait for the asynchronous closeSock of emitErr
+    poller->sync([]() {});
+
+    InfoL << "after reset: socket " << sock->getSendBufferBytes() << ", poller " << poller->getSendBufferBytes() << ", total " << Socket::getTotalSendBufferBytes();
+    ok &= check("socket error", errored);
+    ok &= check("socket bytes", sock->getSendBufferBytes() == 0);
+    ok &= check("poller bytes", poller->getSendBufferBytes() == 0);
+    ok &= check("total bytes", Socket::getTotalSendBufferBytes() == 0);
+
+    poller->sync([&]() { sock = nullptr; });
+    ok &= check("total bytes after release", Socket::getTotalSendBufferBytes() == 0);
+    ::close(listen_fd);
+    return ok ? 0 : -1;
+#endif
+}
@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include "Util/logger.h"
+#include "Util/TimeTicker.h"
 #if defined(ENABLE_MYSQL)
 #include "Util/SqlPool.h"
 #endif
@@ -98,6 +99,32 @@ int main() {
         DebugL << "unordered_map<string,string> user_id:" << line["user_id"] << ",user_pwd:"<<  line["user_pwd"];
     }
 
+    //预处理语句，参数无需转义，语句缓存在连接中
+    // Prepared statement, the parameters need no escaping, the statement is cached in the connection
+    int64_t rowID;
+    SqlPool::Instance().syncExecute(rowID, "insert into test_db.test_table(user_name,user_pwd) values(?,?);", { "zltoolkit", "654321" });
+    DebugL << "prepared insert RowID:" << rowID;
+
+    //批量写入：异步insert按表合并为多行insert，每1000行或每100毫秒提交一次
+    // Batch write: asynchronous inserts are merged per table into multi-row inserts, committed every 1000 rows or every 100 milliseconds
+    SqlPool::Instance().setBatchWrite(1000, 0.1f);
+    Ticker ticker;
+    for (int i = 0; i < 10000; ++i) {
+        SqlWriter("insert into test_db.test_table(user_name,user_pwd) values('?','?');") << "batch_user" << i << endl;
+    }
+    while (true) {
+        auto stat = SqlPool::Instance().getStatistic();
+        if (!stat.pending_rows && !stat.pending_tasks) {
+            DebugL << "batch insert 10000 rows cost " << ticker.elapsedTime() << "ms"
+                   << ", executed:" << stat.executed << ", failed:" << stat.failed << ", batched rows:" << stat.batched_rows
+                   << ", wait latency:" << stat.wait_latency.toString() << ", exec latency:" << stat.exec_latency.toString();
+            break;
+        }
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    SqlWriter("delete from test_db.test_table where user_name='?';") << "batch_user" << sqlRet;
+    SqlPool::Instance().setBatchWrite(0);
+
     //异步删除  [AUTO-TRANSLATED:4359ab91]
     // Asynchronous deletion
     SqlWriter insertDel("delete from test_db.test_table where user_name='?';");
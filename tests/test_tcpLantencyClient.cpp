@@ -56,6 +56,9 @@ protected:
                     << "ms, usetime: " << now - clock_time
                     << "ms, " << ((uint64_t)(all_len - _recv_len) * 100 / all_len)
                     << "% loss";
+                auto stat = getPoller()->getSpinStatistic();
+                InfoL << "busy poll: " << getPoller()->getBusyPollUsec() << "us, spin hit: " << stat.spin_hit
+                      << ", spin miss: " << stat.spin_miss << ", sleep: " << stat.sleep << ", spin time: " << stat.spin_usec / 1000 << "ms";
             }
         }
     }
@@ -80,13 +83,18 @@ private:
     bool _report = false;
 };
 
-int main() {
+int main(int argc, char *argv[]) {
     // 设置日志系统  [AUTO-TRANSLATED:45646031]
     // Set up the logging system
     Logger::Instance().add(std::make_shared<ConsoleChannel>());
     Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
 
     TestClient::Ptr client(new TestClient());//必须使用智能指针
+    // 第一个参数为忙轮询自旋时长(微秒)，用于对比开启忙轮询前后的延时
+    // The first argument is the busy poll spin time (microseconds), used to compare latency with and without busy poll
+    if (argc > 1) {
+        client->getPoller()->setBusyPoll(atoi(argv[1]));
+    }
     client->startConnect("127.0.0.1", 9000);//连接服务器
     client->setSendFlushFlag(true);
     connect_sem.wait();
@@ -10,6 +10,8 @@
 
 #include <csignal>
 #include <atomic>
+#include <thread>
+#include <vector>
 #include <iostream>
 #include "Util/logger.h"
 #include "Util/TimeTicker.h"
@@ -18,6 +20,85 @@
 using namespace std;
 using namespace toolkit;
 
+// 多生产者单消费者任务吞吐量对比
+// Compare multi-producer single-consumer task throughput
+template<typename Queue>
+static void benchmarkQueue(const char *name, int producers, int tasks_per_producer) {
+    Queue queue;
+    atomic_llong count(0);
+    Ticker ticker;
+    thread consumer([&]() {
+        function<void()> task;
+        while (queue.get_task(task)) {
+            task();
+        }
+    });
+    vector<thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < tasks_per_producer; ++j) {
+                queue.push_task([&count]() { ++count; });
+            }
+        });
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+    queue.push_exit(1);
+    consumer.join();
+    auto ms = ticker.elapsedTime();
+    InfoL << name << " producers:" << producers << " tasks:" << count.load() << " cost:" << ms << "ms, "
+          << (ms ? count.load() / ms * 1000 : 0) << " tasks/s";
+}
+
+// 两个线程通过一对信号量来回唤醒，统计单次唤醒延时
+// Two threads wake each other up through a pair of semaphores, measure the latency of one wakeup
+template<typename Sem>
+static void benchmarkWakeup(const char *name, int rounds) {
+    Sem ping, pong;
+    thread peer([&]() {
+        for (int i = 0; i < rounds; ++i) {
+            ping.wait();
+            pong.post();
+        }
+    });
+    auto start = getCurrentMicrosecond();
+    for (int i = 0; i < rounds; ++i) {
+        ping.post();
+        pong.wait();
+    }
+    auto us = getCurrentMicrosecond() - start;
+    peer.join();
+    InfoL << name << " rounds:" << rounds << " avg wakeup latency:" << (double)us / (rounds * 2) << "us";
+}
+
+// 对比可取消的async与不可取消的post投递执行100万任务的耗时
+// Compare the time to post and run 1 million tasks with cancelable async and non-cancelable post
+static void benchmarkPost(bool use_post) {
+    ThreadPool pool(1, ThreadPool::PRIORITY_HIGHEST, false);
+    atomic_llong count(0);
+    semaphore sem;
+    const long long total = 1000 * 1000;
+    Ticker ticker;
+    for (long long i = 0; i < total; ++i) {
+        auto task = [&count, &sem, total]() {
+            if (++count == total) {
+                sem.post();
+            }
+        };
+        if (use_post) {
+            pool.post(task);
+        } else {
+            pool.async(task);
+        }
+    }
+    auto post_ms = ticker.elapsedTime();
+    pool.start();
+    sem.wait();
+    InfoL << (use_post ? "ThreadPool::post" : "ThreadPool::async") << " tasks:" << total << " post cost:" << post_ms
+          << "ms, total cost:" << ticker.elapsedTime() << "ms";
+}
+
 int main() {
     signal(SIGINT,[](int ){
         exit(0);
@@ -26,6 +107,15 @@ int main() {
     // Initialize the logging system
     Logger::Instance().add(std::make_shared<ConsoleChannel> ());
 
+    for (int producers : { 1, 4 }) {
+        benchmarkQueue<TaskQueue<function<void()>>>("TaskQueue", producers, 1000 * 1000 / producers);
+        benchmarkQueue<LockFreeTaskQueue<function<void()>>>("LockFreeTaskQueue", producers, 1000 * 1000 / producers);
+    }
+    benchmarkWakeup<semaphore>("semaphore", 100 * 1000);
+    benchmarkWakeup<fast_semaphore>("fast_semaphore", 100 * 1000);
+    benchmarkPost(false);
+    benchmarkPost(true);
+
     atomic_llong count(0);
     ThreadPool pool(1,ThreadPool::PRIORITY_HIGHEST, false);
 
@@ -0,0 +1,181 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include "Thread/semaphore.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/uv_errno.h"
+#include "Network/sockutil.h"
+#include "Network/UdpServer.h"
+#include "Network/Session.h"
+#if defined(__linux__) || defined(__linux)
+#include <dirent.h>
+#include <linux/filter.h>
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+//客户端个数，每个客户端向两个不同的server fd各发一个包
+// Number of clients, each client sends one packet to each of two different server fds
+static constexpr int kClients = 64;
+static constexpr int kPollers = 4;
+
+//每个peer创建的会话个数
+// Number of sessions created for each peer
+static mutex s_mtx;
+static map<string, int> s_sessions;
+static int s_packets = 0;
+
+class CountSession : public Session {
+public:
+    CountSession(const Socket::Ptr &sock) : Session(sock) {}
+
+    void onRecv(const Buffer::Ptr &buf) override {
+        lock_guard<mutex> lck(s_mtx);
+        ++s_packets;
+        if (!_counted) {
+            //首包时登记，同一peer出现两个会话时计数为2
+            // Register on the first packet, a peer with two sessions counts 2
+            _counted = true;
+            ++s_sessions[get_peer_ip() + ":" + to_string(get_peer_port())];
+        }
+    }
+    void onError(const SockException &err) override {}
+    void onManager() override {}
+
+private:
+    bool _counted = false;
+};
+
+#if defined(__linux__) || defined(__linux)
+//找到本进程中绑定在该端口且未connect的udp socket，即各server fd
+// Find the unconnected udp sockets of this process bound to the port, that is the server fds
+static vector<int> findServerFds(uint16_t port) {
+    vector<int> ret;
+    auto dir = opendir("/proc/self/fd");
+    if (!dir) {
+        return ret;
+    }
+    while (auto entry = readdir(dir)) {
+        int fd = atoi(entry->d_name);
+        int type = 0;
+        socklen_t len = sizeof(type);
+        if (fd <= 2 || getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) != 0 || type != SOCK_DGRAM) {
+            continue;
+        }
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        if (SockUtil::get_local_port(fd) == port && getpeername(fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+            ret.emplace_back(fd);
+        }
+    }
+    closedir(dir);
+    return ret;
+}
+
+//给reuseport分组挂载cbpf程序，以包的首字节作为分组内socket的下标，从而指定数据落到哪个server fd
+// Attach a cbpf program to the reuseport group, using the first byte of the packet as the socket index in the group, so the test decides which server fd receives the data
+static bool steerByFirstByte(int fd) {
+    struct sock_filter code[] = {
+        { BPF_LD | BPF_B | BPF_ABS, 0, 0, 0 },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    struct sock_fprog prog = { (unsigned short)(sizeof(code) / sizeof(code[0])), code };
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
+}
+#endif
+
+int main() {
+    //初始化日志模块
+    // Initialize the log module
+    Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", LInfo));
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+#if defined(__linux__) || defined(__linux)
+    //多个poller，使reuseport分组中有多个server fd
+    // Several pollers so the reuseport group has several server fds
+    EventPollerPool::setPoolSize(kPollers);
+
+    UdpServer::Ptr server(new UdpServer());
+    server->setSessionPerPoller(true);
+    server->start<CountSession>(0, "127.0.0.1");
+    auto port = server->getPort();
+
+    auto server_fds = findServerFds(port);
+    if (server_fds.size() != (size_t)kPollers || !steerByFirstByte(server_fds[0])) {
+        ErrorL << "can not steer packets between server fds, found " << server_fds.size() << " server fds: " << get_uv_errmsg();
+        return -1;
+    }
+
+    vector<int> fds;
+    auto addr = SockUtil::make_sockaddr("127.0.0.1", port);
+    for (int i = 0; i < kClients; ++i) {
+        auto fd = SockUtil::bindUdpSock(0, "127.0.0.1", false);
+        if (fd == -1) {
+            ErrorL << "create udp socket failed: " << get_uv_errmsg();
+            return -1;
+        }
+        fds.emplace_back(fd);
+    }
+
+    //阻塞全部poller，每个peer的两个包分别落到reuseport分组中下标不同的两个server fd(即两个poller)上；
+    //释放后先处理的poller创建会话，另一个poller本地会话表未命中，必须通过共享的peer目录找到该会话，不能再创建第二个
+    //分组中的server fd先于所有peer socket加入，因此下标0~kPollers-1都是server fd
+    // Block all the pollers, the two packets of each peer land on two server fds (two pollers) with different indexes in the reuseport group;
+    // after the release the poller that runs first creates the session, the other one misses its local session table and must find the session through the shared peer directory instead of creating a second one
+    // The server fds joined the group before any peer socket, so indexes 0~kPollers-1 are all server fds
+    semaphore blocked, release;
+    EventPollerPool::Instance().for_each([&](const TaskExecutor::Ptr &executor) {
+        executor->async([&]() {
+            blocked.post();
+            release.wait();
+        });
+    });
+    for (int i = 0; i < kPollers; ++i) {
+        blocked.wait();
+    }
+    for (int i = 0; i < kClients; ++i) {
+        char first = (char)(i % kPollers);
+        char second = (char)((i + 1) % kPollers);
+        ::sendto(fds[i], &first, 1, 0, (struct sockaddr *)&addr, SockUtil::get_sock_len((struct sockaddr *)&addr));
+        ::sendto(fds[i], &second, 1, 0, (struct sockaddr *)&addr, SockUtil::get_sock_len((struct sockaddr *)&addr));
+    }
+    this_thread::sleep_for(chrono::milliseconds(100));
+    release.post(kPollers);
+    this_thread::sleep_for(chrono::seconds(1));
+
+    int duplicated = 0;
+    {
+        lock_guard<mutex> lck(s_mtx);
+        for (auto &pr : s_sessions) {
+            if (pr.second > 1) {
+                ErrorL << "peer " << pr.first << " has " << pr.second << " sessions";
+                ++duplicated;
+            }
+        }
+        InfoL << "peers:" << s_sessions.size() << ", packets:" << s_packets << ", duplicated peers:" << duplicated;
+        if (s_sessions.size() != (size_t)kClients || s_packets != 2 * kClients) {
+            ErrorL << "expect " << kClients << " peers and " << 2 * kClients << " packets";
+            duplicated = -1;
+        }
+    }
+    for (auto fd : fds) {
+        close(fd);
+    }
+    server = nullptr;
+    this_thread::sleep_for(chrono::milliseconds(100));
+    return duplicated ? -1 : 0;
+#else
+    return 0;
+#endif
+}
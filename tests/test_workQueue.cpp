@@ -0,0 +1,128 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include <thread>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Thread/semaphore.h"
+#include "Thread/ThreadPool.h"
+#include "Thread/WorkThreadPool.h"
+
+using namespace std;
+using namespace toolkit;
+
+// 模拟耗cpu的任务
+// Simulate a cpu heavy task
+static void busy(uint64_t ns) {
+    auto start = LatencyHistogram::now();
+    while (LatencyHistogram::now() - start < ns) {}
+}
+
+// 每隔10毫秒投递一批共20毫秒的耗cpu任务(两倍过载)及一个探测任务，统计探测任务的排队时长
+// Every 10 milliseconds post a burst of cpu heavy tasks worth 20 milliseconds (2x overload) and a probe task, measure the queueing time of the probes
+template<typename PostHeavy, typename PostProbe>
+static void flood(const char *name, PostHeavy &&post_heavy, PostProbe &&post_probe) {
+    static constexpr int kRounds = 30;
+    static constexpr int kBurst = 100;
+    LatencyHistogram probe_wait;
+    atomic<int> probes { 0 };
+    semaphore sem;
+    Ticker ticker;
+    for (int i = 0; i < kRounds; ++i) {
+        for (int j = 0; j < kBurst; ++j) {
+            post_heavy([]() { busy(200 * 1000); });
+        }
+        auto enqueue = LatencyHistogram::now();
+        post_probe([&, enqueue]() {
+            probe_wait.record(LatencyHistogram::now() - enqueue);
+            if (++probes == kRounds) {
+                sem.post();
+            }
+        });
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    sem.wait();
+    InfoL << name << ": probes done after " << ticker.elapsedTime() << "ms, probe wait:" << probe_wait.snapshot().toString();
+}
+
+int main() {
+    //初始化日志系统
+    // Initialize the logging system
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    // 单个工作线程，便于观察积压
+    // A single work thread, so the backlog is easy to observe
+    WorkThreadPool::setPoolSize(1);
+    // 投递线程优先级高于工作线程，使每批任务同时到达，单核机器上也能形成积压
+    // The posting thread has a higher priority than the work thread so each burst arrives at once, which builds a backlog even on a single cpu machine
+    ThreadPool::setPriority(ThreadPool::PRIORITY_HIGHEST);
+    auto poller = WorkThreadPool::Instance().getPoller();
+
+    // 直接投递到poller：列队无界，探测任务要排在全部积压之后
+    // Post to the poller directly: the queue is unbounded, probes wait behind the whole backlog
+    flood("unbounded poller", [&](TaskIn task) { poller->async(std::move(task), false); },
+          [&](TaskIn task) { poller->async(std::move(task), false); });
+    // 等待积压的任务执行完
+    // Wait for the backlog to finish
+    poller->sync([]() {});
+
+    // 有界列队：满时丢弃最旧的低优先级任务，探测任务以高优先级插队
+    // Bounded queue: drop the oldest low priority task when full, the probes jump ahead with the high priority
+    WorkThreadPool::Instance().setQueueLimit(64, WorkQueue::Overflow_ShedOldest);
+    auto queue = WorkThreadPool::Instance().getWorkQueue();
+    // 等待列队中剩余的任务执行完
+    // Wait for the remaining tasks in the queue to finish
+    auto wait_queue = [&]() {
+        while (queue->size()) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+    };
+    flood("bounded shed-oldest", [&](TaskIn task) { queue->async(std::move(task), WorkQueue::Priority_Low, false); },
+          [&](TaskIn task) { queue->async(std::move(task), WorkQueue::Priority_High, false); });
+    wait_queue();
+    InfoL << "bounded shed-oldest: " << queue->getStatistic(true).toString();
+
+    // 满时拒绝新任务
+    // Reject new tasks when full
+    WorkThreadPool::Instance().setQueueLimit(64, WorkQueue::Overflow_Reject);
+    size_t rejected = 0;
+    flood("bounded reject", [&](TaskIn task) {
+        auto ret = queue->async(std::move(task), WorkQueue::Priority_Low, false);
+        if (ret && !*ret) {
+            ++rejected;
+        }
+    }, [&](TaskIn task) { queue->async(std::move(task), WorkQueue::Priority_High, false); });
+    wait_queue();
+    InfoL << "bounded reject: rejected by caller:" << rejected << ", " << queue->getStatistic(true).toString();
+
+    // 满时在投递线程中执行，投递方被反压
+    // Run in the posting thread when full, the poster is pushed back
+    WorkThreadPool::Instance().setQueueLimit(64, WorkQueue::Overflow_RunInline);
+    flood("bounded run-inline", [&](TaskIn task) { queue->async(std::move(task), WorkQueue::Priority_Low, false); },
+          [&](TaskIn task) { queue->async(std::move(task), WorkQueue::Priority_High, false); });
+    wait_queue();
+    InfoL << "bounded run-inline: " << queue->getStatistic(true).toString();
+
+    // 任务抛出非std::exception的异常后，列队仍能继续调度后续任务
+    // After a task throws something that is not a std::exception, the queue still schedules the following tasks
+    atomic<bool> executed { false };
+    queue->async([]() { throw 1; }, WorkQueue::Priority_Normal, false);
+    queue->async([&]() { executed = true; }, WorkQueue::Priority_Normal, false);
+    for (int i = 0; i < 100 && !executed; ++i) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    if (!executed) {
+        ErrorL << "work queue stalled after a task threw an unknown exception";
+        return -1;
+    }
+    InfoL << "work queue kept running after a task threw an unknown exception";
+    return 0;
+}